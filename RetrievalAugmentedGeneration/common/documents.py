@@ -0,0 +1,160 @@
+# SPDX-FileCopyrightText: Copyright (c) 2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Bookkeeping for the documents in the knowledge base and the uploads still in flight."""
+import asyncio
+import json
+import logging
+import os
+import re
+import threading
+import time
+from pathlib import Path
+from typing import Any, Dict
+
+UPLOAD_FOLDER = "uploaded_files"
+# partial uploads that have not grown for this long are removed
+PARTIAL_MAX_AGE = 24 * 60 * 60
+_STATUS_FILE = ".status.json"
+# statuses that survive a restart, a document that was being ingested is not
+_FINAL_STATUSES = ("ingested", "failed")
+_UPLOAD_ID = re.compile(r"^[A-Za-z0-9_-]{1,128}$")
+
+logger = logging.getLogger(__name__)
+
+
+class DocumentRegistry:
+    """The documents of the knowledge base and their ingestion status.
+
+    The final status of each document is saved in the upload folder. After a restart, files whose ingestion did not
+    finish, or that were put into the folder by other means, are listed as unknown. Partial uploads are kept in a
+    hidden subfolder under the id the client chose for them, so an interrupted upload resumes where it stopped, and are
+    removed once they are abandoned for PARTIAL_MAX_AGE seconds. Every change bumps a version that watchers wait on,
+    so clients learn about new documents without polling.
+    """
+
+    def __init__(self, folder: str = UPLOAD_FOLDER) -> None:
+        """Initialize the registry from the upload folder."""
+        self._folder = Path(folder)
+        self._partial = self._folder / ".partial"
+        self._partial.mkdir(parents=True, exist_ok=True)
+        saved = self._load_status()
+        self._status = {
+            entry.name: saved.get(entry.name, "unknown")
+            for entry in self._folder.iterdir()
+            if entry.is_file() and not entry.name.startswith(".")
+        }
+        self.expire_partials()
+        self._version = 0
+        self._changed = asyncio.Condition()
+        self._lock = threading.Lock()
+
+    def path(self, filename: str) -> Path:
+        """Return where a document is stored."""
+        name = os.path.basename(filename)
+        if not name or name.startswith("."):
+            raise ValueError(f"Invalid document name {filename}.")
+        return self._folder / name
+
+    def page(self, offset: int = 0, limit: int = 100) -> Dict[str, Any]:
+        """Return a page of the documents, ordered by name."""
+        names = sorted(self._status)
+        return {
+            "version": self._version,
+            "total": len(names),
+            "offset": offset,
+            "documents": [
+                {"filename": name, "status": self._status[name]}
+                for name in names[offset : offset + limit]
+            ],
+        }
+
+    async def set_status(self, filename: str, status: str) -> None:
+        """Record the status of a document and wake up the watchers."""
+        async with self._changed:
+            self._status[os.path.basename(filename)] = status
+            self._save_status()
+            self._version += 1
+            self._changed.notify_all()
+
+    def _load_status(self) -> Dict[str, str]:
+        """Read the saved statuses of the documents whose ingestion finished."""
+        try:
+            with open(self._folder / _STATUS_FILE, "r", encoding="UTF-8") as status_file:
+                saved = json.load(status_file)
+            return {name: status for name, status in saved.items() if status in _FINAL_STATUSES}
+        except FileNotFoundError:
+            return {}
+        except (OSError, ValueError) as e:
+            logger.warning(f"Ignoring unreadable document statuses in {self._folder}. Error details: {e}")
+            return {}
+
+    def _save_status(self) -> None:
+        """Save the document statuses, replacing the previous file at once so a crash cannot leave it half written."""
+        tmp_path = self._folder / f"{_STATUS_FILE}.tmp"
+        with open(tmp_path, "w", encoding="UTF-8") as status_file:
+            json.dump(self._status, status_file)
+        os.replace(tmp_path, self._folder / _STATUS_FILE)
+
+    def expire_partials(self, max_age: float = PARTIAL_MAX_AGE) -> None:
+        """Remove the partial uploads that have not received a chunk for max_age seconds."""
+        cutoff = time.time() - max_age
+        for entry in self._partial.iterdir():
+            try:
+                if entry.is_file() and entry.stat().st_mtime < cutoff:
+                    entry.unlink()
+                    logger.info(f"Removed abandoned partial upload {entry.name}.")
+            except FileNotFoundError:
+                # completed or expired concurrently
+                continue
+
+    async def wait(self, version: int) -> int:
+        """Wait until the documents differ from the given version and return the new version."""
+        async with self._changed:
+            await self._changed.wait_for(lambda: self._version != version)
+            return self._version
+
+    def _partial_path(self, upload_id: str) -> Path:
+        """Return where the received part of an upload is kept."""
+        if not _UPLOAD_ID.match(upload_id):
+            raise ValueError(f"Invalid upload id {upload_id}.")
+        return self._partial / upload_id
+
+    def received(self, upload_id: str) -> int:
+        """Return how many bytes of an upload have been received."""
+        path = self._partial_path(upload_id)
+        return path.stat().st_size if path.exists() else 0
+
+    def append(self, upload_id: str, offset: int, data: bytes) -> int:
+        """Append a chunk to an upload and return how many bytes have been received.
+
+        A chunk that does not start where the received part ends is ignored, the caller resends from the returned size.
+        """
+        path = self._partial_path(upload_id)
+        with self._lock:
+            if offset == 0:
+                self.expire_partials()
+            received = self.received(upload_id)
+            if offset != received:
+                return received
+            with open(path, "ab") as partial:
+                partial.write(data)
+            return received + len(data)
+
+    def complete(self, upload_id: str, filename: str) -> Path:
+        """Move a finished upload to the document folder and return its path."""
+        path = self.path(filename)
+        os.replace(self._partial_path(upload_id), path)
+        return path
@@ -14,23 +14,29 @@
 # limitations under the License.
 
 """The definition of the Llama Index chain server."""
+import asyncio
 import base64
+import itertools
+import json
 import os
 import shutil
 import logging
-from pathlib import Path
-from typing import Any, Dict, List
+import re
+from typing import Any, AsyncGenerator, Dict, Iterable, List, Optional
 
-from fastapi import FastAPI, File, UploadFile
+from fastapi import FastAPI, File, Query, Request, UploadFile
+from fastapi.concurrency import run_in_threadpool
 from fastapi.responses import JSONResponse, StreamingResponse
 from pydantic import BaseModel, Field
 from pymilvus.exceptions import MilvusException, MilvusUnavailableException
 
 from RetrievalAugmentedGeneration.common import utils
+from RetrievalAugmentedGeneration.common.documents import DocumentRegistry
 from RetrievalAugmentedGeneration.examples.developer_rag import chains
 
 logging.basicConfig(level=logging.INFO)
 logger = logging.getLogger(__name__)
+_LINE_BREAK = re.compile(r"\r\n|\r|\n")
 
 # create the FastAPI server
 app = FastAPI()
@@ -38,6 +44,9 @@ app = FastAPI()
 _ = utils.get_embedding_model()
 # set the global service context for Llama Index
 utils.set_service_context()
+# the documents in the knowledge base, ingested one at a time
+documents = DocumentRegistry()
+_INGEST_LOCK = asyncio.Lock()
 
 
 class Prompt(BaseModel):
@@ -56,6 +65,19 @@ class DocumentSearch(BaseModel):
     num_docs: int = Field(description="The maximum number of documents to return in the response.", default=4)
 
 
+async def ingest_document(file_path: str, filename: str) -> str:
+    """Ingest an uploaded document off the event loop and return its final status."""
+    await documents.set_status(filename, "ingesting")
+    try:
+        async with _INGEST_LOCK:
+            await run_in_threadpool(chains.ingest_docs, file_path, filename)
+    except Exception:
+        await documents.set_status(filename, "failed")
+        raise
+    await documents.set_status(filename, "ingested")
+    return "ingested"
+
+
 @app.post("/uploadDocument")
 async def upload_document(file: UploadFile = File(...)) -> JSONResponse:
     """Upload a document to the vector store."""
@@ -64,18 +86,15 @@ async def upload_document(file: UploadFile = File(...)) -> JSONResponse:
 
     try:
 
-        upload_folder = "uploaded_files"
         upload_file = os.path.basename(file.filename)
         if not upload_file:
             raise RuntimeError("Error parsing uploaded filename.")
-        file_path = os.path.join(upload_folder, upload_file)
-        uploads_dir = Path(upload_folder)
-        uploads_dir.mkdir(parents=True, exist_ok=True)
+        file_path = documents.path(upload_file)
 
         with open(file_path, "wb") as f:
             shutil.copyfileobj(file.file, f)
 
-        chains.ingest_docs(file_path, upload_file)
+        await ingest_document(str(file_path), upload_file)
 
         return JSONResponse(
             content={"message": "File uploaded successfully"}, status_code=200
@@ -88,26 +107,126 @@ async def upload_document(file: UploadFile = File(...)) -> JSONResponse:
         )
 
 
+@app.get("/uploads/{upload_id}")
+def upload_status(upload_id: str) -> JSONResponse:
+    """Report how much of a resumable upload the server has received."""
+    try:
+        return JSONResponse(content={"received": documents.received(upload_id)})
+    except ValueError as e:
+        return JSONResponse(content={"message": str(e)}, status_code=400)
+
+
+@app.put("/uploads/{upload_id}")
+async def upload_chunk(
+    upload_id: str,
+    request: Request,
+    filename: str = Query(description="The name of the uploaded document."),
+    offset: int = Query(description="The position of this chunk in the document.", ge=0),
+    total: int = Query(description="The size of the whole document.", ge=0),
+) -> JSONResponse:
+    """Receive a chunk of a resumable upload and ingest the document once it is complete.
+
+    A chunk that does not continue the received part is rejected with 409 and the size received so far.
+    """
+    try:
+        documents.path(filename)
+        data = await request.body()
+        received = await run_in_threadpool(documents.append, upload_id, offset, data)
+    except ValueError as e:
+        return JSONResponse(content={"message": str(e)}, status_code=400)
+    if received != offset + len(data):
+        return JSONResponse(content={"received": received}, status_code=409)
+    if received < total:
+        return JSONResponse(content={"received": received, "status": "uploading"})
+
+    upload_file = os.path.basename(filename)
+    try:
+        file_path = await run_in_threadpool(documents.complete, upload_id, upload_file)
+        status = await ingest_document(str(file_path), upload_file)
+        return JSONResponse(content={"received": received, "status": status})
+    except Exception as e:
+        logger.error("Error from /uploads endpoint. Ingestion of file: " + upload_file + " failed with error: " + str(e))
+        return JSONResponse(
+            content={"received": received, "status": "failed", "message": f"Ingestion of file: {upload_file} failed with error: {e}"}, status_code=500
+        )
+
+
+@app.get("/documents")
+def list_documents(
+    offset: int = Query(default=0, ge=0), limit: int = Query(default=100, ge=1, le=1000)
+) -> Dict[str, Any]:
+    """List a page of the documents in the knowledge base with their ingestion status."""
+    return documents.page(offset, limit)
+
+
+@app.get("/documents/events")
+async def document_events(
+    offset: int = Query(default=0, ge=0), limit: int = Query(default=100, ge=1, le=1000)
+) -> StreamingResponse:
+    """Stream the requested page of documents as a documents event now and whenever the documents change."""
+
+    async def pages() -> AsyncGenerator[str, None]:
+        while True:
+            page = documents.page(offset, limit)
+            yield format_event(json.dumps(page), "documents")
+            await documents.wait(page["version"])
+
+    return StreamingResponse(pages(), media_type="text/event-stream")
+
+
+def format_event(data: str, event: Optional[str] = None) -> str:
+    """Frame data as a server-sent event, one data field per line."""
+    fields = [f"event: {event}"] if event else []
+    fields += [f"data: {line}" for line in _LINE_BREAK.split(data)]
+    return "\n".join(fields) + "\n\n"
+
+
+def describe_nodes(nodes: Iterable[Any]) -> List[Dict[str, Any]]:
+    """Describe retrieved nodes by their score, source file and content."""
+    output = []
+    for node in nodes:
+        file_name = node.metadata["filename"]
+        decoded_filename = base64.b64decode(file_name.encode("utf-8")).decode("utf-8")
+        output.append({"score": node.score, "source": decoded_filename, "content": node.text})
+    return output
+
+
+def stream_response(
+    chunks: Iterable[str], events: bool, sources: Optional[List[Dict[str, Any]]] = None
+) -> StreamingResponse:
+    """Stream the chunks, framed as server-sent events if the client accepts them and as plain text otherwise.
+
+    Event clients receive the sources, if any, as a sources event ahead of the answer.
+    """
+    if events:
+        chunks = (format_event(chunk) for chunk in chunks)
+        if sources is not None:
+            chunks = itertools.chain([format_event(json.dumps(sources), "sources")], chunks)
+    return StreamingResponse(chunks, media_type="text/event-stream")
+
+
 @app.post("/generate")
-async def generate_answer(prompt: Prompt) -> StreamingResponse:
+async def generate_answer(prompt: Prompt, request: Request) -> StreamingResponse:
     """Generate and stream the response to the provided prompt."""
 
+    # older clients read the body as raw text, so the answer is only framed as events on request
+    events = "text/event-stream" in request.headers.get("accept", "")
     try:
         if prompt.use_knowledge_base:
             logger.info("Knowledge base is enabled. Using rag chain for response generation.")
-            generator = chains.rag_chain(prompt.question, prompt.num_tokens)
-            return StreamingResponse(generator, media_type="text/event-stream")
+            nodes, generator = chains.rag_chain_with_sources(prompt.question, prompt.num_tokens)
+            return stream_response(generator, events, describe_nodes(nodes))
 
         generator = chains.llm_chain(prompt.context, prompt.question, prompt.num_tokens)
-        return StreamingResponse(generator, media_type="text/event-stream")
+        return stream_response(generator, events)
 
     except (MilvusException, MilvusUnavailableException) as e:
         logger.error(f"Error from Milvus database in /generate endpoint. Please ensure you have ingested some documents. Error details: {e}")
-        return StreamingResponse(iter(["Error from milvus server. Please ensure you have ingested some documents. Please check chain-server logs for more details."]), media_type="text/event-stream")
+        return stream_response(["Error from milvus server. Please ensure you have ingested some documents. Please check chain-server logs for more details."], events)
 
     except Exception as e:
         logger.error(f"Error from /generate endpoint. Error details: {e}")
-        return StreamingResponse(iter(["Error from chain server. Please check chain-server logs for more details."]), media_type="text/event-stream")
+        return stream_response(["Error from chain server. Please check chain-server logs for more details."], events)
 
 
 @app.post("/documentSearch")
@@ -117,14 +236,7 @@ def document_search(data: DocumentSearch) -> List[Dict[str, Any]]:
     try:
         retriever = utils.get_doc_retriever(num_nodes=data.num_docs)
         nodes = retriever.retrieve(data.content)
-        output = []
-        for node in nodes:
-            file_name = nodes[0].metadata["filename"]
-            decoded_filename = base64.b64decode(file_name.encode("utf-8")).decode("utf-8")
-            entry = {"score": node.score, "source": decoded_filename, "content": node.text}
-            output.append(entry)
-
-        return output
+        return describe_nodes(nodes)
 
     except Exception as e:
         logger.error(f"Error from /documentSearch endpoint. Error details: {e}")
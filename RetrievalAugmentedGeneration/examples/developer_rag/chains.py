@@ -18,7 +18,7 @@ import base64
 import os
 import logging
 from pathlib import Path
-from typing import Generator
+from typing import TYPE_CHECKING, Generator, List, Tuple
 
 from llama_index import Prompt, download_loader
 from llama_index.query_engine import RetrieverQueryEngine
@@ -36,6 +36,9 @@ from RetrievalAugmentedGeneration.common.utils import (
     set_service_context,
 )
 
+if TYPE_CHECKING:
+    from llama_index.schema import NodeWithScore
+
 logger = logging.getLogger(__name__)
 
 def llm_chain(
@@ -55,8 +58,10 @@ def llm_chain(
     return gen_response
 
 
-def rag_chain(prompt: str, num_tokens: int) -> Generator[str, None, None]:
-    """Execute a Retrieval Augmented Generation chain using the components defined above."""
+def rag_chain_with_sources(
+    prompt: str, num_tokens: int
+) -> Tuple[List["NodeWithScore"], Generator[str, None, None]]:
+    """Execute a Retrieval Augmented Generation chain, returning the nodes it answers from and the streamed answer."""
 
     logger.info("Using rag to generate response from document")
 
@@ -79,10 +84,16 @@ def rag_chain(prompt: str, num_tokens: int) -> Generator[str, None, None]:
 
     # Properly handle an empty response
     if isinstance(response, StreamingResponse):
-        return response.response_gen
+        return response.source_nodes, response.response_gen
 
     logger.warning("No response generated from LLM, make sure you've ingested document.")
-    return StreamingResponse(iter(["No response generated from LLM, make sure you have ingested document from the Knowledge Base Tab."])).response_gen  # type: ignore
+    return [], StreamingResponse(iter(["No response generated from LLM, make sure you have ingested document from the Knowledge Base Tab."])).response_gen  # type: ignore
+
+
+def rag_chain(prompt: str, num_tokens: int) -> Generator[str, None, None]:
+    """Execute a Retrieval Augmented Generation chain using the components defined above."""
+    _, response_gen = rag_chain_with_sources(prompt, num_tokens)
+    return response_gen
 
 
 def ingest_docs(data_dir: str, filename: str) -> None:
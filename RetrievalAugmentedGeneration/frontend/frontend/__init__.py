@@ -81,12 +81,14 @@ def main() -> "APIServer":
 
     # connect to other services
     client = chat_client.ChatClient(
-        f"{config.server_url}:{config.server_port}", config.model_name
+        f"{config.server_url}:{config.server_port}",
+        config.model_name,
+        config.max_connections,
     )
 
     # create api server
     _LOGGER.info("Instantiating the API Server.")
-    server = api.APIServer(client)
+    server = api.APIServer(client, config)
     server.configure_routes()
 
     # run until complete
@@ -18,9 +18,10 @@ import os
 
 import gradio as gr
 from fastapi import FastAPI
-from fastapi.responses import FileResponse
+from fastapi.responses import FileResponse, StreamingResponse
 from fastapi.staticfiles import StaticFiles
 from frontend.chat_client import ChatClient
+from frontend.configuration import AppConfig
 
 from frontend import pages
 
@@ -39,24 +40,37 @@ class APIServer(FastAPI):
     title = "Chat"
     desc = "This service provides a sample conversation frontend flow."
 
-    def __init__(self, client: ChatClient) -> None:
+    def __init__(self, client: ChatClient, config: AppConfig) -> None:
         """Initialize the API server."""
         self._client = client
-        super().__init__(title=self.title, description=self.desc)
+        self._config = config
+        super().__init__(
+            title=self.title, description=self.desc, on_shutdown=[client.aclose]
+        )
 
     def configure_routes(self) -> None:
         """Configure the routes in the API Server."""
         _ = gr.mount_gradio_app(
             self,
-            blocks=pages.converse.build_page(self._client),
+            blocks=pages.converse.build_page(
+                self._client, self._config.stream_fps, self._config.stream_batch
+            ),
             path=f"/content{pages.converse.PATH}",
         )
         _ = gr.mount_gradio_app(
             self,
-            blocks=pages.kb.build_page(self._client),
+            blocks=pages.kb.build_page(
+                self._client, self._config.upload_concurrency
+            ),
             path=f"/content{pages.kb.PATH}",
         )
 
+        feed = pages.kb.DocumentFeed(self._client)
+
+        @self.get(pages.kb.EVENTS_PATH)
+        async def kb_documents() -> StreamingResponse:
+            return StreamingResponse(feed.events(), media_type="text/event-stream")
+
         @self.get("/")
         async def root_redirect() -> FileResponse:
             return FileResponse(os.path.join(STATIC_DIR, "converse.html"))
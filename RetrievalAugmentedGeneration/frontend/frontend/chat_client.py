@@ -14,99 +14,227 @@
 # limitations under the License.
 
 """The API client for the langchain-esque service."""
+import asyncio
+import hashlib
+import json
 import logging
-import mimetypes
+import os
 import typing
+from dataclasses import dataclass
 
-import requests
+import httpx
 
 _LOGGER = logging.getLogger(__name__)
+# answers stream for a long time, so only the wait for each chunk is bounded
+_TIMEOUT = httpx.Timeout(30.0, connect=10.0, read=120.0)
+# the last chunk of an upload returns once the document is ingested
+_UPLOAD_TIMEOUT = httpx.Timeout(30.0, connect=10.0, read=600.0)
+_WATCH_TIMEOUT = httpx.Timeout(30.0, connect=10.0, read=None)
+_UPLOAD_CHUNK = 4 * 1024 * 1024
+_UPLOAD_RETRIES = 5
+_RECONNECT_SECONDS = 5.0
+
+
+@dataclass
+class ServerEvent:
+    """A server-sent event from the chat server."""
+
+    event: str = "message"
+    data: str = ""
+
+
+async def parse_events(
+    lines: typing.AsyncIterator[str],
+) -> typing.AsyncGenerator[ServerEvent, None]:
+    """Parse a stream of server-sent event lines into events."""
+    event, data = "message", []
+    async for line in lines:
+        line = line.rstrip("\r\n")
+        if not line:
+            # a blank line ends the event
+            if data:
+                yield ServerEvent(event, "\n".join(data))
+            event, data = "message", []
+            continue
+        if line.startswith(":"):
+            continue
+        field, _, value = line.partition(":")
+        value = value[1:] if value.startswith(" ") else value
+        if field == "event":
+            event = value
+        elif field == "data":
+            data.append(value)
+    if data:
+        yield ServerEvent(event, "\n".join(data))
 
 
 class ChatClient:
     """A client for connecting the the lanchain-esque service."""
 
-    def __init__(self, server_url: str, model_name: str) -> None:
+    def __init__(
+        self, server_url: str, model_name: str, max_connections: int = 100
+    ) -> None:
         """Initialize the client."""
         self.server_url = server_url
         self._model_name = model_name
         self.default_model = "llama2-7B-chat"
+        self._limits = httpx.Limits(
+            max_connections=max_connections, max_keepalive_connections=max_connections
+        )
+        self._session: typing.Optional[httpx.AsyncClient] = None
+
+    @property
+    def session(self) -> httpx.AsyncClient:
+        """Return the pooled HTTP client that every chat shares."""
+        if self._session is None or self._session.is_closed:
+            self._session = httpx.AsyncClient(
+                base_url=self.server_url, limits=self._limits, timeout=_TIMEOUT
+            )
+        return self._session
+
+    async def aclose(self) -> None:
+        """Close the pooled connections."""
+        if self._session is not None:
+            await self._session.aclose()
 
     @property
     def model_name(self) -> str:
         """Return the friendly model name."""
         return self._model_name
 
-    def search(
+    async def search(
         self, prompt: str
     ) -> typing.List[typing.Dict[str, typing.Union[str, float]]]:
         """Search for relevant documents and return json data."""
         data = {"content": prompt, "num_docs": 4}
         headers = {"accept": "application/json", "Content-Type": "application/json"}
-        url = f"{self.server_url}/documentSearch"
+        url = "/documentSearch"
         _LOGGER.debug(
-            "looking up documents - %s", str({"server_url": url, "post_data": data})
+            "looking up documents - %s",
+            str({"server_url": self.server_url + url, "post_data": data}),
         )
 
         try:
-            with requests.post(url, headers=headers, json=data, timeout=30) as req:
-                    req.raise_for_status()
-                    response = req.json()
-                    return typing.cast(
-                        typing.List[typing.Dict[str, typing.Union[str, float]]], response
-                    )
+            resp = await self.session.post(url, headers=headers, json=data)
+            resp.raise_for_status()
+            return typing.cast(
+                typing.List[typing.Dict[str, typing.Union[str, float]]], resp.json()
+            )
         except Exception as e:
             _LOGGER.error(f"Failed to get response from /documentSearch endpoint of chain-server. Error details: {e}. Refer to chain-server logs for details.")
             return typing.cast(
                 typing.List[typing.Dict[str, typing.Union[str, float]]], []
             )
 
-
-    def predict(
+    async def predict(
         self, query: str, use_knowledge_base: bool, num_tokens: int
-    ) -> typing.Generator[str, None, None]:
-        """Make a model prediction."""
+    ) -> typing.AsyncGenerator[ServerEvent, None]:
+        """Make a model prediction, yielding the answer chunks as message events as they stream in.
+
+        With the knowledge base, the documents the answer is based on arrive first as a sources event.
+        """
         data = {
             "question": query,
             "context": "",
             "use_knowledge_base": use_knowledge_base,
             "num_tokens": num_tokens,
         }
-        url = f"{self.server_url}/generate"
+        url = "/generate"
         _LOGGER.debug(
-            "making inference request - %s", str({"server_url": url, "post_data": data})
+            "making inference request - %s",
+            str({"server_url": self.server_url + url, "post_data": data}),
         )
 
         try:
-            with requests.post(url, stream=True, json=data, timeout=10) as req:
-
-                    req.raise_for_status()
-                    for chunk in req.iter_content(16):
-                        yield chunk.decode("UTF-8")
+            async with self.session.stream(
+                "POST", url, json=data, headers={"accept": "text/event-stream"}
+            ) as resp:
+                resp.raise_for_status()
+                async for event in parse_events(resp.aiter_lines()):
+                    yield event
         except Exception as e:
             _LOGGER.error(f"Failed to get response from /generate endpoint of chain-server. Error details: {e}. Refer to chain-server logs for details.")
-            yield str("Failed to get response from /generate endpoint of chain-server. Check if the fastapi server in chain-server is up. Refer to chain-server logs for details.")
-
-    def upload_documents(self, file_paths: typing.List[str]) -> None:
-        """Upload documents to the kb."""
-        url = f"{self.server_url}/uploadDocument"
-        headers = {
-            "accept": "application/json",
-        }
+            yield ServerEvent(data="Failed to get response from /generate endpoint of chain-server. Check if the fastapi server in chain-server is up. Refer to chain-server logs for details.")
+
+    async def upload_document(
+        self,
+        file_path: str,
+        on_progress: typing.Optional[typing.Callable[[int, int], None]] = None,
+    ) -> str:
+        """Upload a document to the kb in resumable chunks and return its ingestion status.
+
+        The upload id is derived from the name, size and first chunk of the file, so uploading the same file again
+        continues where an interrupted upload stopped.
+        """
+        name = os.path.basename(file_path)
+        total = os.path.getsize(file_path)
+        url = f"/uploads/{self._upload_id(file_path, name, total)}"
+        _LOGGER.debug(
+            "uploading file - %s",
+            str({"server_url": self.server_url + url, "file": file_path}),
+        )
 
         try:
-            for fpath in file_paths:
-                mime_type, _ = mimetypes.guess_type(fpath)
-                # pylint: disable-next=consider-using-with # with pattern is not intuitive here
-                files = {"file": (fpath, open(fpath, "rb"), mime_type)}
-
-                _LOGGER.debug(
-                    "uploading file - %s",
-                    str({"server_url": url, "file": fpath}),
-                )
-
-                _ = requests.post(
-                    url, headers=headers, files=files, timeout=600  # type: ignore [arg-type]
-                )
+            resp = await self.session.get(url)
+            resp.raise_for_status()
+            received = resp.json()["received"]
+            retries = 0
+            with open(file_path, "rb") as src:
+                while True:
+                    src.seek(received)
+                    chunk = src.read(_UPLOAD_CHUNK)
+                    params = {"filename": name, "offset": received, "total": total}
+                    try:
+                        resp = await self.session.put(
+                            url, params=params, content=chunk, timeout=_UPLOAD_TIMEOUT
+                        )
+                    except httpx.TransportError:
+                        # the last chunk may have been ingested, so only earlier ones are resumed
+                        retries += 1
+                        if retries > _UPLOAD_RETRIES or received + len(chunk) >= total:
+                            raise
+                        await asyncio.sleep(2**retries)
+                        resp = await self.session.get(url)
+                        resp.raise_for_status()
+                        received = resp.json()["received"]
+                        continue
+
+                    if resp.status_code == 409:
+                        received = resp.json()["received"]
+                        continue
+                    resp.raise_for_status()
+                    result = resp.json()
+                    received, retries = result["received"], 0
+                    if on_progress is not None:
+                        on_progress(received, total)
+                    if received >= total:
+                        return typing.cast(str, result["status"])
         except Exception as e:
-            _LOGGER.error(f"Failed to get response from /uploadDocument endpoint of chain-server. Error details: {e}. Refer to chain-server logs for details.")
\ No newline at end of file
+            _LOGGER.error(f"Failed to get response from /uploads endpoint of chain-server. Error details: {e}. Refer to chain-server logs for details.")
+            return "failed"
+
+    @staticmethod
+    def _upload_id(file_path: str, name: str, total: int) -> str:
+        """Identify an upload by the document's name, size and first chunk."""
+        digest = hashlib.sha256(f"{name}:{total}:".encode("UTF-8"))
+        with open(file_path, "rb") as src:
+            digest.update(src.read(_UPLOAD_CHUNK))
+        return digest.hexdigest()[:32]
+
+    async def watch_documents(
+        self, offset: int = 0, limit: int = 100
+    ) -> typing.AsyncGenerator[typing.Dict[str, typing.Any], None]:
+        """Yield a page of the kb documents now and again whenever the documents change."""
+        params = {"offset": offset, "limit": limit}
+        while True:
+            try:
+                async with self.session.stream(
+                    "GET", "/documents/events", params=params, timeout=_WATCH_TIMEOUT
+                ) as resp:
+                    resp.raise_for_status()
+                    async for event in parse_events(resp.aiter_lines()):
+                        if event.event == "documents":
+                            yield json.loads(event.data)
+            except Exception as e:
+                _LOGGER.error(f"Failed to get response from /documents/events endpoint of chain-server. Error details: {e}. Refer to chain-server logs for details.")
+            await asyncio.sleep(_RECONNECT_SECONDS)
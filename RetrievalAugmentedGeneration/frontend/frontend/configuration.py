@@ -42,3 +42,23 @@ class AppConfig(ConfigWizard):
         default="llama2-7B-chat",
         help_txt="The name of the hosted LLM model.",
     )
+    max_connections: int = configfield(
+        "maxConnections",
+        default=100,
+        help_txt="The maximum number of concurrent connections to the chat server.",
+    )
+    stream_fps: float = configfield(
+        "streamFps",
+        default=10.0,
+        help_txt="The maximum number of times a second a streaming answer is redrawn, 0 to redraw on every chunk.",
+    )
+    stream_batch: int = configfield(
+        "streamBatch",
+        default=0,
+        help_txt="Redraw a streaming answer after this many chunks even if the frame interval has not passed, 0 to disable.",
+    )
+    upload_concurrency: int = configfield(
+        "uploadConcurrency",
+        default=4,
+        help_txt="The number of files the Knowledge Base page uploads at once.",
+    )
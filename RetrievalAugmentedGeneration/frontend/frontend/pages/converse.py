@@ -15,7 +15,9 @@
 
 """This module contains the frontend gui for having a conversation."""
 import functools
+import json
 import logging
+import time
 from typing import Any, Dict, List, Tuple, Union
 
 import gradio as gr
@@ -37,7 +39,41 @@ _LOCAL_CSS = """
 """
 
 
-def build_page(client: chat_client.ChatClient) -> gr.Blocks:
+class Throttle:
+    """Decide when a streaming answer is worth redrawing.
+
+    Every redraw sends the whole chat history to the browser, so the answer is redrawn at most fps times a second,
+    or after batch chunks if that comes first. Either limit is disabled by setting it to 0.
+    """
+
+    def __init__(self, fps: float = 0, batch: int = 0) -> None:
+        """Initialize the throttle."""
+        self._interval = 1 / fps if fps > 0 else 0.0
+        self._batch = batch
+        self._last = 0.0
+        self._pending = 0
+
+    def ready(self) -> bool:
+        """Count a chunk and return whether the answer should be redrawn now."""
+        self._pending += 1
+        now = time.monotonic()
+        if (
+            now - self._last < self._interval
+            and not 0 < self._batch <= self._pending
+        ):
+            return False
+        self._last, self._pending = now, 0
+        return True
+
+    @property
+    def pending(self) -> bool:
+        """Return whether chunks have arrived since the last redraw."""
+        return self._pending > 0
+
+
+def build_page(
+    client: chat_client.ChatClient, stream_fps: float = 0, stream_batch: int = 0
+) -> gr.Blocks:
     """Buiild the gradio page to be mounted in the frame."""
     kui_theme, kui_styles = assets.load_theme("kaizen")
 
@@ -93,7 +129,9 @@ def build_page(client: chat_client.ChatClient) -> gr.Blocks:
         ctx_hide.click(_toggle_context, [ctx_hide], [context, ctx_show, ctx_hide])
 
         # form actions
-        _my_build_stream = functools.partial(_stream_predict, client)
+        _my_build_stream = functools.partial(
+            _stream_predict, client, stream_fps, stream_batch
+        )
         msg.submit(
             _my_build_stream, [kb_checkbox, msg, chatbot], [msg, chatbot, context]
         )
@@ -105,8 +143,10 @@ def build_page(client: chat_client.ChatClient) -> gr.Blocks:
     return page
 
 
-def _stream_predict(
+async def _stream_predict(
     client: chat_client.ChatClient,
+    stream_fps: float,
+    stream_batch: int,
     use_knowledge_base: bool,
     question: str,
     chat_history: List[Tuple[str, str]],
@@ -119,10 +159,16 @@ def _stream_predict(
         str({"prompt": question, "use_knowledge_base": use_knowledge_base}),
     )
 
+    # the sources come with the answer, so the knowledge base is only searched once
     documents: Union[None, List[Dict[str, Union[str, float]]]] = None
-    if use_knowledge_base:
-        documents = client.search(question)
-
-    for chunk in client.predict(question, use_knowledge_base, OUTPUT_TOKENS):
-        chunks += chunk
+    throttle = Throttle(stream_fps, stream_batch)
+    async for event in client.predict(question, use_knowledge_base, OUTPUT_TOKENS):
+        if event.event == "sources":
+            documents = json.loads(event.data)
+            yield "", chat_history + [[question, chunks]], documents
+        elif event.event == "message":
+            chunks += event.data
+            if throttle.ready():
+                yield "", chat_history + [[question, chunks]], documents
+    if throttle.pending:
         yield "", chat_history + [[question, chunks]], documents
@@ -14,24 +14,90 @@
 # limitations under the License.
 
 """This module contains the frontend gui for chat."""
+import asyncio
+import functools
+import json
+import os
 from pathlib import Path
-from typing import List
+from typing import Any, AsyncGenerator, Dict, List, Optional
 
-import os
 import gradio as gr
 
 from frontend import assets, chat_client
 
 PATH = "/kb"
+# where open pages receive the document list, outside of the mounted gradio app
+EVENTS_PATH = "/kb/documents/events"
 TITLE = "Knowledge Base Management"
-STATE_FILE = '/tmp/uploaded_files.txt'
-
-
-def build_page(client: chat_client.ChatClient) -> gr.Blocks:
+PAGE_SIZE = 100
+# how often the upload progress is redrawn
+_PROGRESS_INTERVAL = 0.5
+# uploads hold a queue worker until their last file is ingested, so several pages can upload at once
+_QUEUE_CONCURRENCY = 16
+_FEED_ID = "documents-feed"
+# the browser subscribes to the document list itself and hands each page to the hidden feed textbox, so no queue
+# worker is held while a page is open
+_SUBSCRIBE_JS = f"""
+() => {{
+    const source = new EventSource("{EVENTS_PATH}");
+    source.addEventListener("documents", (event) => {{
+        const feed = document.querySelector("#{_FEED_ID} textarea");
+        if (feed) {{
+            feed.value = event.data;
+            feed.dispatchEvent(new Event("input"));
+        }}
+    }});
+}}
+"""
+_FEED_CSS = f"#{_FEED_ID} {{ display: none; }}"
+
+
+class DocumentFeed:
+    """The document list pushed by the chain server, fanned out to every open page.
+
+    A single stream to the chain server is opened when the first page subscribes and is kept open, however many
+    pages are open.
+    """
+
+    def __init__(self, client: chat_client.ChatClient) -> None:
+        """Initialize the feed."""
+        self._client = client
+        self._page: Optional[Dict[str, Any]] = None
+        self._version = 0
+        self._changed: Optional[asyncio.Condition] = None
+        self._watcher: Optional["asyncio.Task[None]"] = None
+
+    async def _watch(self, changed: asyncio.Condition) -> None:
+        """Keep the latest document list from the chain server."""
+        async for page in self._client.watch_documents(limit=PAGE_SIZE):
+            async with changed:
+                self._page = page
+                self._version += 1
+                changed.notify_all()
+
+    async def events(self) -> AsyncGenerator[str, None]:
+        """Yield the document list as server-sent events now and whenever it changes."""
+        if self._changed is None:
+            self._changed = asyncio.Condition()
+        changed = self._changed
+        if self._watcher is None or self._watcher.done():
+            self._watcher = asyncio.create_task(self._watch(changed))
+
+        version = 0
+        while True:
+            async with changed:
+                await changed.wait_for(lambda: self._version != version)
+                version, page = self._version, self._page
+            yield f"event: documents\ndata: {json.dumps(page)}\n\n"
+
+
+def build_page(
+    client: chat_client.ChatClient, upload_concurrency: int = 4
+) -> gr.Blocks:
     """Buiild the gradio page to be mounted in the frame."""
     kui_theme, kui_styles = assets.load_theme("kaizen")
 
-    with gr.Blocks(title=TITLE, theme=kui_theme, css=kui_styles) as page:
+    with gr.Blocks(title=TITLE, theme=kui_theme, css=kui_styles + _FEED_CSS) as page:
         # create the page header
         gr.Markdown(f"# {TITLE}")
 
@@ -40,45 +106,68 @@ def build_page(client: chat_client.ChatClient) -> gr.Blocks:
                 "Add File", file_types=["pdf"], file_count="multiple"
             )
         with gr.Row():
-            file_output = gr.File()
+            upload_progress = gr.Dataframe(
+                headers=["File", "Progress"],
+                datatype=["str", "str"],
+                col_count=(2, "fixed"),
+                label="Uploads",
+            )
 
         with gr.Row():
-            gr.Dataframe(
-                headers=["File Uploaded"],
-                datatype=["str"],
-                col_count=(1, "fixed"),
-                value=get_uploaded_files,
-                every=1,
+            summary = gr.Markdown()
+        with gr.Row():
+            uploaded_files = gr.Dataframe(
+                headers=["File Uploaded", "Status"],
+                datatype=["str", "str"],
+                col_count=(2, "fixed"),
             )
+        feed = gr.Textbox(elem_id=_FEED_ID, show_label=False)
 
         # form actions
         upload_button.upload(
-            lambda files: upload_file(files, client), upload_button, file_output
+            functools.partial(upload_files, client, upload_concurrency),
+            upload_button,
+            upload_progress,
         )
+        # the document list is pushed to the browser, see DocumentFeed
+        feed.change(show_uploaded_files, feed, [summary, uploaded_files], queue=False)
+        page.load(None, None, None, _js=_SUBSCRIBE_JS)
 
-    page.queue()
+    page.queue(concurrency_count=max(_QUEUE_CONCURRENCY, upload_concurrency))
     return page
 
 
-def upload_file(files: List[Path], client: chat_client.ChatClient) -> List[str]:
-    """Use the client to upload a file to the knowledge base."""
-    file_paths = [file.name for file in files]
-    client.upload_documents(file_paths)
-
-  # Save the uploaded file names to the state file
-    with open(STATE_FILE, 'a') as file:
-        for file_path in file_paths:
-            file_path = os.path.basename(file_path)
-            file.write(file_path + '\n')
-
-    return file_paths
-
-def get_uploaded_files():
-    """Load previously uploaded files if the file exists"""
-    uploaded_files = [["No Files uploaded"]]
-    if os.path.exists(STATE_FILE):
-        uploaded_files = []
-        with open(STATE_FILE, 'r') as file:
-            for line in file.read().splitlines():
-                uploaded_files.append([line])
-    return uploaded_files
+async def upload_files(
+    client: chat_client.ChatClient, concurrency: int, files: List[Path]
+) -> AsyncGenerator[List[List[str]], None]:
+    """Use the client to upload files to the knowledge base, a few at a time, reporting the progress of each."""
+    progress: Dict[str, str] = {os.path.basename(file.name): "queued" for file in files}
+    semaphore = asyncio.Semaphore(max(1, concurrency))
+
+    async def upload(file_path: str) -> None:
+        name = os.path.basename(file_path)
+
+        def on_progress(received: int, total: int) -> None:
+            progress[name] = f"{100 * received // max(total, 1)}%"
+
+        async with semaphore:
+            progress[name] = "0%"
+            progress[name] = await client.upload_document(file_path, on_progress)
+
+    pending = {asyncio.create_task(upload(file.name)) for file in files}
+    while pending:
+        _, pending = await asyncio.wait(pending, timeout=_PROGRESS_INTERVAL)
+        yield [[name, state] for name, state in progress.items()]
+
+
+def show_uploaded_files(feed: str) -> List[Any]:
+    """Show the documents in the knowledge base from a document list pushed by the chain server."""
+    if not feed:
+        return [gr.update(), gr.update()]
+    page = json.loads(feed)
+    rows = [[doc["filename"], doc["status"]] for doc in page["documents"]]
+    total = page["total"]
+    summary = f"{total} documents" + (
+        f", showing the first {len(rows)}" if len(rows) < total else ""
+    )
+    return [summary, rows or [["No Files uploaded", ""]]]
@@ -0,0 +1,175 @@
+# SPDX-FileCopyrightText: Copyright (c) 2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Benchmark the weight loading of build.py on the checkpoints written by synthetic_checkpoint.py.
+
+Only the CPU side of the conversion runs: the rank's model is created and its weights are loaded, no engine is
+built. Each rank is loaded in a fresh process, one after another, and the wall time and peak RSS of the slowest and
+largest rank are reported for every format and TP x PP mapping.
+
+    python3 synthetic_checkpoint.py --output_dir /tmp/tiny-llama
+    python3 benchmark_conversion.py --checkpoint_dir /tmp/tiny-llama --mappings 1x1 2x1 1x2
+"""
+import argparse
+import json
+import multiprocessing
+import resource
+import time
+from pathlib import Path
+
+from build import build_rank_model, load_weights
+from build import parse_arguments as parse_build_arguments
+from synthetic_checkpoint import FORMATS
+
+_STATUS = "/proc/self/status"
+
+
+def parse_arguments():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--checkpoint_dir", type=str, required=True)
+    parser.add_argument(
+        "--formats", type=str, nargs="+", default=FORMATS, choices=FORMATS
+    )
+    parser.add_argument(
+        "--mappings",
+        type=str,
+        nargs="+",
+        default=["1x1", "2x1", "1x2"],
+        help="The tensor x pipeline parallel sizes to load the checkpoints for.",
+    )
+    parser.add_argument(
+        "--dtype",
+        type=str,
+        default="float16",
+        choices=["float32", "bfloat16", "float16"],
+    )
+    parser.add_argument(
+        "--all_ranks",
+        default=False,
+        action="store_true",
+        help="Load every rank of a mapping instead of only the first and the last.",
+    )
+    parser.add_argument(
+        "--output", type=str, default=None, help="Also write the results as JSON."
+    )
+    return parser.parse_args()
+
+
+def build_argv(checkpoint_dir, fmt, tp_size, pp_size, dtype):
+    """Return the build.py arguments that load the given format, or None if it was not generated."""
+    fmt_dir = Path(checkpoint_dir) / fmt
+    argv = [
+        "--world_size",
+        str(tp_size * pp_size),
+        "--tp_size",
+        str(tp_size),
+        "--pp_size",
+        str(pp_size),
+        "--dtype",
+        dtype,
+    ]
+    if fmt == "ft":
+        fmt_dir = fmt_dir / f"{tp_size}-gpu"
+        argv += ["--ft_model_dir", str(fmt_dir)]
+    elif fmt == "meta":
+        argv += ["--meta_ckpt_dir", str(fmt_dir)]
+    else:
+        argv += ["--model_dir", str(fmt_dir)]
+    if fmt in ("gptq", "awq"):
+        quant_ckpt = sorted(fmt_dir.glob("*.safetensors")) + sorted(
+            fmt_dir.glob("*.pt")
+        )
+        if not quant_ckpt:
+            return None
+        argv += [
+            "--quant_ckpt_path",
+            str(quant_ckpt[0]),
+            "--use_weight_only",
+            "--weight_only_precision",
+            f"int4_{fmt}",
+            "--per_group",
+        ]
+    return argv if fmt_dir.is_dir() else None
+
+
+def _peak_rss():
+    """Return the peak RSS of this process in bytes."""
+    try:
+        with open(_STATUS, "r", encoding="ASCII") as status:
+            for line in status:
+                if line.startswith("VmHWM:"):
+                    return int(line.split()[1]) * 1024
+    except OSError:
+        pass
+    return resource.getrusage(resource.RUSAGE_SELF).ru_maxrss * 1024
+
+
+def load_rank(argv, rank):
+    """Create a rank's model and load its weights, returning the load time and the peak RSS before and after."""
+    args = parse_build_arguments(argv)
+    tensorrt_llm_llama, mapping = build_rank_model(rank, args)
+    rss_before = _peak_rss()
+    tik = time.time()
+    load_weights(tensorrt_llm_llama, mapping, args)
+    return time.time() - tik, rss_before, _peak_rss()
+
+
+def main():
+    args = parse_arguments()
+    # a fresh process per rank, so each peak RSS belongs to a single load
+    ctx = multiprocessing.get_context("spawn")
+    results = []
+
+    for fmt in args.formats:
+        for mapping in args.mappings:
+            tp_size, pp_size = (int(size) for size in mapping.split("x"))
+            argv = build_argv(args.checkpoint_dir, fmt, tp_size, pp_size, args.dtype)
+            if argv is None:
+                print(f"{fmt:>15} {mapping:>5}: no checkpoint, skipped")
+                continue
+
+            world_size = tp_size * pp_size
+            ranks = range(world_size) if args.all_ranks else sorted({0, world_size - 1})
+            runs = []
+            try:
+                for rank in ranks:
+                    with ctx.Pool(1) as pool:
+                        runs.append(pool.apply(load_rank, (argv, rank)))
+            # pylint: disable-next=broad-exception-caught; report the failure and benchmark the rest
+            except Exception as err:
+                print(f"{fmt:>15} {mapping:>5}: failed, {err}")
+                continue
+
+            result = {
+                "format": fmt,
+                "mapping": mapping,
+                "ranks": list(ranks),
+                "seconds": max(run[0] for run in runs),
+                "model_rss_bytes": max(run[1] for run in runs),
+                "peak_rss_bytes": max(run[2] for run in runs),
+            }
+            results.append(result)
+            print(
+                f"{fmt:>15} {mapping:>5}: {result['seconds']:8.2f}s "
+                f"peak RSS {result['peak_rss_bytes'] / 2**20:9.1f} MiB "
+                f"(+{(result['peak_rss_bytes'] - result['model_rss_bytes']) / 2**20:.1f} MiB loading)"
+            )
+
+    if args.output:
+        with open(args.output, "w") as fp:
+            json.dump(results, fp, indent=2)
+
+
+if __name__ == "__main__":
+    main()
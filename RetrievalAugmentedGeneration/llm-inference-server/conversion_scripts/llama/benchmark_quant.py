@@ -0,0 +1,148 @@
+# SPDX-FileCopyrightText: Copyright (c) 2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Benchmark the CPU side of GPTQ and AWQ weight preprocessing on a synthetic quantized checkpoint.
+
+Every layer of the synthetic checkpoint is preprocessed the way load_from_gptq_llama and load_from_awq_llama do it,
+once for each worker count, and the wall time and the speedup over a single worker are printed.
+"""
+import argparse
+import os
+import time
+
+import torch
+from weight import (
+    AWQ_quantize_pack_preprocess,
+    int4_kernels,
+    map_layers,
+    preprocess_groupwise_weight_params,
+    reSmooth_and_get_scale,
+)
+
+
+def parse_arguments():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--n_layer", type=int, default=8)
+    parser.add_argument("--n_embd", type=int, default=4096)
+    parser.add_argument("--inter_size", type=int, default=11008)
+    parser.add_argument("--group_size", type=int, default=128)
+    parser.add_argument(
+        "--workers",
+        type=int,
+        nargs="+",
+        default=None,
+        help="The worker counts to compare, by default powers of two up to the number of cores.",
+    )
+    parser.add_argument(
+        "--precision",
+        type=str,
+        nargs="+",
+        default=["gptq", "awq"],
+        choices=["gptq", "awq"],
+    )
+    return parser.parse_args()
+
+
+def linear_shapes(args):
+    """Return the (input, output) sizes of a decoder layer's linear layers."""
+    return [
+        (args.n_embd, 3 * args.n_embd),
+        (args.n_embd, args.n_embd),
+        (args.n_embd, args.inter_size),
+        (args.inter_size, args.n_embd),
+        (args.n_embd, args.inter_size),
+    ]
+
+
+def synthetic_gptq_layer(args):
+    """Return random GPTQ qweight, qzeros and scales for each linear layer of a decoder layer."""
+    int32 = torch.iinfo(torch.int32)
+    return [
+        (
+            torch.randint(int32.min, int32.max, (k // 8, n), dtype=torch.int32),
+            torch.randint(
+                int32.min, int32.max, (k // args.group_size, n // 8), dtype=torch.int32
+            ),
+            torch.rand(k // args.group_size, n, dtype=torch.float16),
+        )
+        for k, n in linear_shapes(args)
+    ]
+
+
+def synthetic_awq_layer(args):
+    """Return a random AWQ weight, pre quant scale and averaged pre quant scale for each linear layer."""
+    return [
+        (
+            torch.randn(k, n, dtype=torch.float16),
+            torch.rand(1, k, dtype=torch.float16) + 0.5,
+            torch.rand(1, k, dtype=torch.float16) + 0.5,
+        )
+        for k, n in linear_shapes(args)
+    ]
+
+
+def main():
+    args = parse_arguments()
+    try:
+        kernels = int4_kernels()
+    except (AttributeError, RuntimeError):
+        # without the TensorRT LLM torch extension only the unpacking and quantization are timed
+        kernels = (lambda w: w, lambda w, _: w)
+        print("TensorRT LLM int4 kernels are not available, skipping them.")
+
+    workers = args.workers or [
+        1 << i for i in range((os.cpu_count() or 1).bit_length())
+    ]
+    layers = range(args.n_layer)
+    print(
+        f"{args.n_layer} layers, hidden size {args.n_embd}, intermediate size {args.inter_size}, "
+        f"group size {args.group_size}, {torch.get_num_threads()} torch threads"
+    )
+
+    for precision in args.precision:
+        if precision == "gptq":
+            params = [synthetic_gptq_layer(args) for _ in layers]
+
+            def process_layer(l):
+                for qweight, qzeros, scales in params[l]:
+                    preprocess_groupwise_weight_params(
+                        qweight, qzeros, scales, kernels=kernels
+                    )
+
+        else:
+            params = [synthetic_awq_layer(args) for _ in layers]
+
+            def process_layer(l):
+                for weight, pre_quant_scale, avg_pre_quant_scale in params[l]:
+                    weight, scale = reSmooth_and_get_scale(
+                        weight, pre_quant_scale, avg_pre_quant_scale, args.group_size
+                    )
+                    AWQ_quantize_pack_preprocess(
+                        weight, scale, args.group_size, kernels
+                    )
+
+        baseline = None
+        for count in workers:
+            tik = time.time()
+            map_layers(process_layer, layers, count)
+            seconds = time.time() - tik
+            baseline = baseline or seconds
+            print(
+                f"{precision}: {count:3d} workers {seconds:8.2f}s "
+                f"{args.n_layer / seconds:8.2f} layers/s {baseline / seconds:6.2f}x"
+            )
+
+
+if __name__ == "__main__":
+    main()
@@ -38,12 +38,22 @@ from tensorrt_llm.plugin.plugin import ContextFMHAType
 from tensorrt_llm.quantization import QuantMode
 from transformers import LlamaConfig, LlamaForCausalLM
 from weight import (
+    PROGRESS,
+    SharedWeightPool,
+    default_load_workers,
     get_scaling_factors,
+    has_safetensors,
     load_from_awq_llama,
     load_from_binary,
     load_from_gptq_llama,
+    load_from_hf_checkpoint,
     load_from_hf_llama,
+    load_from_hf_safetensors_llama,
     load_from_meta_llama,
+    load_presharded,
+    presharded_manifest,
+    presharded_settings,
+    save_presharded,
 )
 
 from weight import parse_ft_config  # isort:skip
@@ -134,7 +144,7 @@ def serialize_engine(engine, path):
     logger.info(f"Engine serialized. Total time: {t}")
 
 
-def parse_arguments():
+def parse_arguments(argv=None):
     parser = argparse.ArgumentParser()
     parser.add_argument("--world_size", type=int, default=1)
     parser.add_argument("--tp_size", type=int, default=1)
@@ -143,6 +153,25 @@ def parse_arguments():
     parser.add_argument("--ft_model_dir", type=str, default=None)
     parser.add_argument("--meta_ckpt_dir", type=str, default=None)
     parser.add_argument("--quant_ckpt_path", type=str, default=None)
+    parser.add_argument(
+        "--load_workers",
+        type=int,
+        default=None,
+        help="How many layers, or HF tensors, of a checkpoint to convert at once. Defaults to an even share of the cores.",
+    )
+    parser.add_argument(
+        "--presharded_dir",
+        type=str,
+        default=None,
+        help="Where to cache the per-rank, fully transformed weights. Builds that only change engine options, "
+        "such as the batch size or sequence lengths, load them from here instead of converting the checkpoint again.",
+    )
+    parser.add_argument(
+        "--progress_dir",
+        type=str,
+        default=None,
+        help="Where each rank writes its conversion progress, as rank<N>.json, while the engines are built.",
+    )
     parser.add_argument(
         "--dtype",
         type=str,
@@ -344,8 +373,9 @@ def parse_arguments():
         help="Activates latency-optimized algorithm for all-reduce instead of NCCL.",
     )
 
-    args = parser.parse_args()
+    args = parser.parse_args(argv)
     tensorrt_llm.logger.set_level(args.log_level)
+    args.weight_pool = None
 
     assert not (
         args.use_smooth_quant and args.use_weight_only
@@ -495,18 +525,73 @@ def parse_arguments():
     return args
 
 
-def build_rank_engine(
-    builder: Builder,
-    builder_config: tensorrt_llm.builder.BuilderConfig,
-    engine_name,
-    rank,
-    args,
-):
+def load_weights(tensorrt_llm_llama, mapping, args):
+    """Load and transform the rank local weights from the source checkpoint."""
+    workers = args.load_workers or default_load_workers(
+        args.world_size if args.parallel_build else 1
+    )
+    if args.per_group:
+        load_func = (
+            load_from_awq_llama
+            if args.weight_only_precision == "int4_awq"
+            else load_from_gptq_llama
+        )
+        load_func(
+            tensorrt_llm_llama=tensorrt_llm_llama,
+            quant_ckpt_path=args.quant_ckpt_path,
+            mapping=mapping,
+            dtype=args.dtype,
+            workers=workers,
+        )
+    elif args.meta_ckpt_dir is not None:
+        load_from_meta_llama(
+            tensorrt_llm_llama, args.meta_ckpt_dir, mapping, args.dtype
+        )
+    elif args.model_dir is not None and args.weight_pool is not None:
+        logger.info("Loading HF LLaMA ... from the shared weight pool")
+        load_from_hf_checkpoint(
+            tensorrt_llm_llama, args.weight_pool, mapping=mapping, dtype=args.dtype
+        )
+    elif args.model_dir is not None and has_safetensors(args.model_dir):
+        logger.info(f"Loading HF LLaMA safetensors ... from {args.model_dir}")
+        load_from_hf_safetensors_llama(
+            tensorrt_llm_llama, args.model_dir, mapping=mapping, dtype=args.dtype
+        )
+    elif args.model_dir is not None:
+        logger.info(f"Loading HF LLaMA ... from {args.model_dir}")
+        tik = time.time()
+        hf_llama = LlamaForCausalLM.from_pretrained(
+            args.model_dir,
+            device_map={"model": "cpu", "lm_head": "cpu"},  # Load to CPU memory
+            torch_dtype="auto",
+        )
+        tok = time.time()
+        t = time.strftime("%H:%M:%S", time.gmtime(tok - tik))
+        logger.info(f"HF LLaMA loaded. Total time: {t}")
+        load_from_hf_llama(
+            tensorrt_llm_llama,
+            hf_llama,
+            mapping=mapping,
+            dtype=args.dtype,
+            workers=workers,
+        )
+        del hf_llama
+    elif args.ft_model_dir is not None:
+        load_from_binary(
+            tensorrt_llm_llama,
+            args.ft_model_dir,
+            mapping,
+            fp16=(args.dtype == "float16"),
+            multi_query_mode=(args.n_kv_head != args.n_head),
+        )
+
+
+def build_rank_model(rank, args):
     """
-    @brief: Build the engine on the given rank.
-    @param rank: The rank to build the engine.
+    @brief: Create the quantized, but still empty, TensorRT LLM model of the given rank.
+    @param rank: The rank to create the model for.
     @param args: The cmd line arguments.
-    @return: The built engine.
+    @return: The model and the rank's mapping.
     """
     dtype = str_dtype_to_trt(args.dtype)
     mapping = Mapping(
@@ -578,45 +663,35 @@ def build_rank_engine(
         tensorrt_llm_llama = fp8_quantize(
             tensorrt_llm_llama, quant_mode=args.quant_mode, quant_scales=quant_scales
         )
-    if args.per_group:
-        load_func = (
-            load_from_awq_llama
-            if args.weight_only_precision == "int4_awq"
-            else load_from_gptq_llama
-        )
-        load_func(
-            tensorrt_llm_llama=tensorrt_llm_llama,
-            quant_ckpt_path=args.quant_ckpt_path,
-            mapping=mapping,
-            dtype=args.dtype,
-        )
-    elif args.meta_ckpt_dir is not None:
-        load_from_meta_llama(
-            tensorrt_llm_llama, args.meta_ckpt_dir, mapping, args.dtype
-        )
-    elif args.model_dir is not None:
-        logger.info(f"Loading HF LLaMA ... from {args.model_dir}")
-        tik = time.time()
-        hf_llama = LlamaForCausalLM.from_pretrained(
-            args.model_dir,
-            device_map={"model": "cpu", "lm_head": "cpu"},  # Load to CPU memory
-            torch_dtype="auto",
-        )
-        tok = time.time()
-        t = time.strftime("%H:%M:%S", time.gmtime(tok - tik))
-        logger.info(f"HF LLaMA loaded. Total time: {t}")
-        load_from_hf_llama(
-            tensorrt_llm_llama, hf_llama, mapping=mapping, dtype=args.dtype
-        )
-        del hf_llama
-    elif args.ft_model_dir is not None:
-        load_from_binary(
-            tensorrt_llm_llama,
-            args.ft_model_dir,
-            mapping,
-            fp16=(args.dtype == "float16"),
-            multi_query_mode=(args.n_kv_head != args.n_head),
+    return tensorrt_llm_llama, mapping
+
+
+def build_rank_engine(
+    builder: Builder,
+    builder_config: tensorrt_llm.builder.BuilderConfig,
+    engine_name,
+    rank,
+    args,
+):
+    """
+    @brief: Build the engine on the given rank.
+    @param rank: The rank to build the engine.
+    @param args: The cmd line arguments.
+    @return: The built engine.
+    """
+    dtype = str_dtype_to_trt(args.dtype)
+    with PROGRESS.step("create_model"):
+        tensorrt_llm_llama, mapping = build_rank_model(rank, args)
+    settings = presharded_settings(args)
+    with PROGRESS.step("load_weights"):
+        loaded = args.presharded_dir is not None and load_presharded(
+            tensorrt_llm_llama, args.presharded_dir, rank, settings
         )
+        if not loaded:
+            load_weights(tensorrt_llm_llama, mapping, args)
+    if not loaded and args.presharded_dir is not None:
+        with PROGRESS.step("save_presharded"):
+            save_presharded(tensorrt_llm_llama, args.presharded_dir, rank, settings)
 
     # Module -> Network
     network = builder.create_network()
@@ -685,7 +760,8 @@ def build_rank_engine(
     engine = None
 
     # Network -> Engine
-    engine = builder.build_engine(network, builder_config)
+    with PROGRESS.step("build_engine"):
+        engine = builder.build_engine(network, builder_config)
     if rank == 0:
         config_path = os.path.join(args.output_dir, "config.json")
         builder.save_config(builder_config, config_path)
@@ -706,6 +782,7 @@ def build(rank, args):
         # skip other ranks if parallel_build is enabled
         if args.parallel_build and cur_rank != rank:
             continue
+        PROGRESS.configure(args.progress_dir, cur_rank)
         # NOTE: when only int8 kv cache is used together with paged kv cache no int8 tensors are exposed to TRT
         int8_trt_flag = args.quant_mode.has_act_and_weight_quant() or (
             not args.paged_kv_cache and args.quant_mode.has_int8_kv_cache()
@@ -745,7 +822,8 @@ def build(rank, args):
             if not args.parallel_build:
                 cache = builder_config.trt_builder_config.get_timing_cache()
 
-        serialize_engine(engine, os.path.join(args.output_dir, engine_name))
+        with PROGRESS.step("serialize_engine"):
+            serialize_engine(engine, os.path.join(args.output_dir, engine_name))
 
     if rank == 0:
         ok = builder.save_timing_cache(
@@ -765,6 +843,26 @@ if __name__ == "__main__":
         logger.warning(
             f"Parallelly build TensorRT engines. Please make sure that all of the {args.world_size} GPUs are totally free."
         )
+        presharded = args.presharded_dir is not None and all(
+            presharded_manifest(args.presharded_dir, rank, presharded_settings(args))
+            for rank in range(args.world_size)
+        )
+        if (
+            args.model_dir is not None
+            and not args.per_group
+            and not has_safetensors(args.model_dir)
+            and not presharded
+        ):
+            # read the HF checkpoint once and share it with every rank
+            try:
+                args.weight_pool = SharedWeightPool.from_hf_llama(
+                    args.model_dir, args.dtype
+                )
+                logger.info("Loaded HF LLaMA into the shared weight pool.")
+            except RuntimeError as err:
+                logger.warning(
+                    f"Not using a shared weight pool, each rank will load the model: {err}"
+                )
         mp.spawn(build, nprocs=args.world_size, args=(args,))
     else:
         args.parallel_build = False
@@ -0,0 +1,430 @@
+# SPDX-FileCopyrightText: Copyright (c) 2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+"""Write random weight Llama checkpoints in every format that weight.py loads.
+
+Each format is written to its own directory below the output directory:
+
+    hf_bin/            config.json and sharded pytorch_model-*.bin files with their index
+    hf_safetensors/    config.json and sharded model-*.safetensors files with their index
+    meta/              params.json and consolidated.XX.pth files, one per model parallel shard
+    ft/<N>-gpu/        config.ini and FasterTransformer .bin files split for N way tensor parallelism
+    gptq/              config.json and a groupwise int4 GPTQ .safetensors checkpoint
+    awq/               config.json and an AWQ .pt checkpoint
+
+The weights are generated one tensor at a time from a seed, so every format holds the same values and checkpoints
+larger than memory can be written. The values are random, the checkpoints are only useful to exercise and time the
+conversion.
+"""
+import argparse
+import configparser
+import json
+import zlib
+from pathlib import Path
+
+import numpy as np
+import torch
+from safetensors.torch import save_file
+from weight import meta_tp_dim
+
+FORMATS = ["hf_bin", "hf_safetensors", "meta", "ft", "gptq", "awq"]
+
+
+def parse_arguments():
+    parser = argparse.ArgumentParser()
+    parser.add_argument("--output_dir", type=str, required=True)
+    parser.add_argument(
+        "--formats", type=str, nargs="+", default=FORMATS, choices=FORMATS
+    )
+    parser.add_argument("--n_layer", type=int, default=4)
+    parser.add_argument("--n_embd", type=int, default=512)
+    parser.add_argument("--n_head", type=int, default=8)
+    parser.add_argument("--n_kv_head", type=int, default=None)
+    parser.add_argument("--multiple_of", type=int, default=256)
+    parser.add_argument("--ffn_dim_multiplier", type=float, default=1.0)
+    parser.add_argument("--vocab_size", type=int, default=32000)
+    parser.add_argument("--n_positions", type=int, default=2048)
+    parser.add_argument("--rms_norm_eps", type=float, default=1e-06)
+    parser.add_argument(
+        "--dtype",
+        type=str,
+        default="float16",
+        choices=["float32", "bfloat16", "float16"],
+    )
+    parser.add_argument(
+        "--shards",
+        type=int,
+        default=2,
+        help="The number of files the Hugging Face checkpoints are split into.",
+    )
+    parser.add_argument(
+        "--meta_shards",
+        type=int,
+        default=2,
+        help="The model parallel size of the Meta checkpoint.",
+    )
+    parser.add_argument(
+        "--ft_tp_sizes",
+        type=int,
+        nargs="+",
+        default=[1, 2],
+        help="The tensor parallel sizes to write FasterTransformer checkpoints for.",
+    )
+    parser.add_argument("--group_size", type=int, default=128)
+    parser.add_argument("--seed", type=int, default=0)
+    return parser.parse_args()
+
+
+class SyntheticLlama:
+    """The shapes and the deterministic random weights of a Llama model, using the Hugging Face tensor names."""
+
+    def __init__(self, args):
+        self.args = args
+        self.n_kv_head = args.n_kv_head or args.n_head
+        self.head_size = args.n_embd // args.n_head
+        # the Meta formula, so that every format describes the same model
+        n_embd = int(4 * args.n_embd * 2 / 3)
+        self.inter_size = args.multiple_of * (
+            (int(n_embd * args.ffn_dim_multiplier) + args.multiple_of - 1)
+            // args.multiple_of
+        )
+        self.dtype = getattr(torch, args.dtype)
+
+    def linear_shapes(self):
+        """Return the [out, in] shape of each linear layer in a decoder layer."""
+        n_embd, kv_dim = self.args.n_embd, self.n_kv_head * self.head_size
+        return {
+            "self_attn.q_proj": (n_embd, n_embd),
+            "self_attn.k_proj": (kv_dim, n_embd),
+            "self_attn.v_proj": (kv_dim, n_embd),
+            "self_attn.o_proj": (n_embd, n_embd),
+            "mlp.gate_proj": (self.inter_size, n_embd),
+            "mlp.up_proj": (self.inter_size, n_embd),
+            "mlp.down_proj": (n_embd, self.inter_size),
+        }
+
+    def layer_names(self, layer_idx):
+        prefix = f"model.layers.{layer_idx}."
+        names = [prefix + "input_layernorm.weight"]
+        names += [prefix + "post_attention_layernorm.weight"]
+        names += [prefix + name + ".weight" for name in self.linear_shapes()]
+        return names
+
+    def names(self):
+        """Return the names of all tensors, grouped by the layer they belong to."""
+        yield ["model.embed_tokens.weight"]
+        for layer_idx in range(self.args.n_layer):
+            yield self.layer_names(layer_idx)
+        yield ["model.norm.weight", "lm_head.weight"]
+
+    def shape(self, name):
+        if name.endswith("norm.weight"):
+            return (self.args.n_embd,)
+        if name in ("model.embed_tokens.weight", "lm_head.weight"):
+            return (self.args.vocab_size, self.args.n_embd)
+        for linear, shape in self.linear_shapes().items():
+            if name.endswith(linear + ".weight"):
+                return shape
+        raise KeyError(name)
+
+    def generator(self, name):
+        seed = self.args.seed * 1000003 + zlib.crc32(name.encode())
+        return torch.Generator().manual_seed(seed)
+
+    def tensor(self, name):
+        """Return the weight of the given name, the same on every call."""
+        shape = self.shape(name)
+        if len(shape) == 1:
+            weight = 1.0 + 0.1 * torch.randn(shape, generator=self.generator(name))
+        else:
+            weight = torch.randn(shape, generator=self.generator(name)) / np.sqrt(
+                shape[1]
+            )
+        return weight.to(self.dtype)
+
+    def hf_config(self):
+        return {
+            "architectures": ["LlamaForCausalLM"],
+            "model_type": "llama",
+            "hidden_act": "silu",
+            "hidden_size": self.args.n_embd,
+            "intermediate_size": self.inter_size,
+            "max_position_embeddings": self.args.n_positions,
+            "num_attention_heads": self.args.n_head,
+            "num_hidden_layers": self.args.n_layer,
+            "num_key_value_heads": self.n_kv_head,
+            "rms_norm_eps": self.args.rms_norm_eps,
+            "tie_word_embeddings": False,
+            "torch_dtype": self.args.dtype,
+            "vocab_size": self.args.vocab_size,
+        }
+
+
+def write_hf_config(model, out_dir):
+    out_dir.mkdir(parents=True, exist_ok=True)
+    with open(out_dir / "config.json", "w") as fp:
+        json.dump(model.hf_config(), fp, indent=2)
+
+
+def shard_groups(model):
+    """Split the tensor names into the configured number of shards, keeping layers together."""
+    groups = list(model.names())
+    shards = max(1, min(model.args.shards, len(groups)))
+    per_shard = (len(groups) + shards - 1) // shards
+    return [
+        sum(groups[i : i + per_shard], []) for i in range(0, len(groups), per_shard)
+    ]
+
+
+def write_hf(model, out_dir, safetensors):
+    write_hf_config(model, out_dir)
+    shards = shard_groups(model)
+    weight_map = {}
+    total_size = 0
+    for idx, names in enumerate(shards):
+        if safetensors:
+            file_name = f"model-{idx + 1:05d}-of-{len(shards):05d}.safetensors"
+        else:
+            file_name = f"pytorch_model-{idx + 1:05d}-of-{len(shards):05d}.bin"
+        tensors = {name: model.tensor(name) for name in names}
+        if safetensors:
+            save_file(tensors, out_dir / file_name, metadata={"format": "pt"})
+        else:
+            torch.save(tensors, out_dir / file_name)
+        for name, tensor in tensors.items():
+            weight_map[name] = file_name
+            total_size += tensor.numel() * tensor.element_size()
+
+    index_name = (
+        "model.safetensors.index.json"
+        if safetensors
+        else "pytorch_model.bin.index.json"
+    )
+    with open(out_dir / index_name, "w") as fp:
+        json.dump(
+            {"metadata": {"total_size": total_size}, "weight_map": weight_map},
+            fp,
+            indent=2,
+        )
+
+
+def meta_names(model, layer_idx):
+    """Map the Meta names of a decoder layer to the Hugging Face names."""
+    meta = f"layers.{layer_idx}."
+    hf = f"model.layers.{layer_idx}."
+    return {
+        meta + "attention_norm.weight": hf + "input_layernorm.weight",
+        meta + "ffn_norm.weight": hf + "post_attention_layernorm.weight",
+        meta + "attention.wq.weight": hf + "self_attn.q_proj.weight",
+        meta + "attention.wk.weight": hf + "self_attn.k_proj.weight",
+        meta + "attention.wv.weight": hf + "self_attn.v_proj.weight",
+        meta + "attention.wo.weight": hf + "self_attn.o_proj.weight",
+        meta + "feed_forward.w1.weight": hf + "mlp.gate_proj.weight",
+        meta + "feed_forward.w2.weight": hf + "mlp.down_proj.weight",
+        meta + "feed_forward.w3.weight": hf + "mlp.up_proj.weight",
+    }
+
+
+def write_meta(model, out_dir):
+    args = model.args
+    out_dir.mkdir(parents=True, exist_ok=True)
+    with open(out_dir / "params.json", "w") as fp:
+        json.dump(
+            {
+                "dim": args.n_embd,
+                "n_heads": args.n_head,
+                "n_kv_heads": model.n_kv_head,
+                "n_layers": args.n_layer,
+                "multiple_of": args.multiple_of,
+                "ffn_dim_multiplier": args.ffn_dim_multiplier,
+                "norm_eps": args.rms_norm_eps,
+                "vocab_size": args.vocab_size,
+            },
+            fp,
+            indent=2,
+        )
+
+    names = {
+        "tok_embeddings.weight": "model.embed_tokens.weight",
+        "norm.weight": "model.norm.weight",
+        "output.weight": "lm_head.weight",
+    }
+    for layer_idx in range(args.n_layer):
+        names.update(meta_names(model, layer_idx))
+
+    # the Hugging Face q and k weights are permuted for rotary embeddings, random weights do not need the inverse
+    shards = [{} for _ in range(args.meta_shards)]
+    for meta_name, hf_name in names.items():
+        tensor = model.tensor(hf_name)
+        dim = meta_tp_dim(meta_name)
+        if dim is None:
+            parts = [tensor] * args.meta_shards
+        else:
+            parts = tensor.chunk(args.meta_shards, dim=dim)
+        for shard, part in zip(shards, parts):
+            shard[meta_name] = part.clone()
+    for idx, shard in enumerate(shards):
+        torch.save(shard, out_dir / f"consolidated.{idx:02d}.pth")
+
+
+def write_ft(model, out_dir, tp_size):
+    args = model.args
+    out_dir.mkdir(parents=True, exist_ok=True)
+    config = configparser.ConfigParser()
+    config["llama"] = {
+        "hidden_size": str(args.n_embd),
+        "num_attention_heads": str(args.n_head),
+        "num_key_value_heads": str(model.n_kv_head),
+        "num_hidden_layers": str(args.n_layer),
+        "max_position_embeddings": str(args.n_positions),
+        "vocab_size": str(args.vocab_size),
+        "hidden_act": "silu",
+        "intermediate_size": str(model.inter_size),
+        "weight_data_type": "fp16" if args.dtype == "float16" else "fp32",
+    }
+    with open(out_dir / "config.ini", "w") as fp:
+        config.write(fp)
+
+    # load_from_binary reads float16 files for float16 models and float32 files otherwise
+    np_dtype = np.float16 if args.dtype == "float16" else np.float32
+
+    def save(name, tensor):
+        tensor.float().numpy().astype(np_dtype).tofile(out_dir / name)
+
+    def transposed(hf_name):
+        return model.tensor(hf_name).T
+
+    save("vocab_embedding.weight.bin", model.tensor("model.embed_tokens.weight"))
+    save("ln_f.weight.bin", model.tensor("model.norm.weight"))
+    save("lm_head.weight.bin", model.tensor("lm_head.weight"))
+
+    for layer_idx in range(args.n_layer):
+        hf = f"model.layers.{layer_idx}."
+        ft = f"model.layers.{layer_idx}."
+        save(
+            ft + "input_layernorm.weight.bin",
+            model.tensor(hf + "input_layernorm.weight"),
+        )
+        save(
+            ft + "post_layernorm.weight.bin",
+            model.tensor(hf + "post_attention_layernorm.weight"),
+        )
+
+        # the weights are stored as [in, out] and split along the dimension tensor parallelism splits
+        qkv = [
+            transposed(hf + f"self_attn.{proj}.weight").chunk(tp_size, dim=1)
+            for proj in ("q_proj", "k_proj", "v_proj")
+        ]
+        dense = transposed(hf + "self_attn.o_proj.weight").chunk(tp_size, dim=0)
+        fc = transposed(hf + "mlp.gate_proj.weight").chunk(tp_size, dim=1)
+        gate = transposed(hf + "mlp.up_proj.weight").chunk(tp_size, dim=1)
+        proj = transposed(hf + "mlp.down_proj.weight").chunk(tp_size, dim=0)
+        for rank in range(tp_size):
+            save(
+                ft + f"attention.query_key_value.weight.{rank}.bin",
+                torch.cat([part[rank] for part in qkv], dim=1),
+            )
+            save(ft + f"attention.dense.weight.{rank}.bin", dense[rank])
+            save(ft + f"mlp.fc.weight.{rank}.bin", fc[rank])
+            save(ft + f"mlp.gate.weight.{rank}.bin", gate[rank])
+            save(ft + f"mlp.proj.weight.{rank}.bin", proj[rank])
+
+
+def write_gptq(model, out_dir):
+    args = model.args
+    write_hf_config(model, out_dir)
+    int32 = torch.iinfo(torch.int32)
+    tensors = {}
+    for names in model.names():
+        for name in names:
+            if not name.startswith("model.layers.") or "norm" in name:
+                tensors[name] = model.tensor(name).half()
+                continue
+            # groupwise int4 weights packed eight to an int32, with int4 zeros packed the same way
+            prefix = name[: -len("weight")]
+            n, k = model.shape(name)
+            generator = model.generator(name)
+            tensors[prefix + "qweight"] = torch.randint(
+                int32.min,
+                int32.max,
+                (k // 8, n),
+                dtype=torch.int32,
+                generator=generator,
+            )
+            tensors[prefix + "qzeros"] = torch.randint(
+                int32.min,
+                int32.max,
+                (k // args.group_size, n // 8),
+                dtype=torch.int32,
+                generator=generator,
+            )
+            tensors[prefix + "scales"] = (
+                torch.rand((k // args.group_size, n), generator=generator) / 64
+            ).half()
+    save_file(tensors, out_dir / f"llama-4bit-gs{args.group_size}.safetensors")
+
+
+def write_awq(model, out_dir):
+    args = model.args
+    write_hf_config(model, out_dir)
+    tensors = {}
+    for names in model.names():
+        for name in names:
+            weight = model.tensor(name).half()
+            tensors[name] = weight
+            if "norm" in name or name == "model.embed_tokens.weight":
+                continue
+            prefix = name[: -len("weight")]
+            n, k = weight.shape
+            # the group maxima the AWQ exporter writes, flattened like its amax buffers
+            tensors[prefix + "weight_quantizer._amax"] = (
+                weight.float()
+                .reshape(n, k // args.group_size, args.group_size)
+                .abs()
+                .amax(dim=2)
+                .reshape(-1)
+                .half()
+            )
+            tensors[prefix + "input_quantizer._pre_quant_scale"] = (
+                0.5 + torch.rand(k, generator=model.generator(prefix))
+            ).half()
+    torch.save(tensors, out_dir / "llama_tp1.pt")
+
+
+def main():
+    args = parse_arguments()
+    if args.n_embd % args.group_size:
+        raise ValueError("The hidden size must be a multiple of the group size.")
+    model = SyntheticLlama(args)
+    output_dir = Path(args.output_dir)
+
+    for fmt in args.formats:
+        if fmt == "hf_bin":
+            write_hf(model, output_dir / fmt, safetensors=False)
+        elif fmt == "hf_safetensors":
+            write_hf(model, output_dir / fmt, safetensors=True)
+        elif fmt == "meta":
+            write_meta(model, output_dir / fmt)
+        elif fmt == "ft":
+            for tp_size in args.ft_tp_sizes:
+                write_ft(model, output_dir / fmt / f"{tp_size}-gpu", tp_size)
+        elif fmt == "gptq":
+            write_gptq(model, output_dir / fmt)
+        elif fmt == "awq":
+            write_awq(model, output_dir / fmt)
+        print(f"Wrote the {fmt} checkpoint to {output_dir / fmt}")
+
+
+if __name__ == "__main__":
+    main()
@@ -12,8 +12,17 @@
 # WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
 # See the License for the specific language governing permissions and
 # limitations under the License.
+import collections
 import configparser
+import contextlib
+import json
+import os
+import re
+import resource
+import shutil
+import threading
 import time
+from concurrent.futures import ThreadPoolExecutor
 from operator import attrgetter
 from pathlib import Path
 from typing import Dict, List, Optional, Union
@@ -23,7 +32,8 @@ import tensorrt_llm
 import tensorrt_llm.logger as logger
 import torch
 from safetensors import safe_open
-from tensorrt_llm._utils import str_dtype_to_torch, torch_to_numpy
+from safetensors.numpy import save_file
+from tensorrt_llm._utils import np_bfloat16, str_dtype_to_torch, torch_to_numpy
 from tensorrt_llm.mapping import Mapping
 from tensorrt_llm.models import LLaMAForCausalLM
 from tensorrt_llm.models.quantized.quant import get_dummy_quant_scales
@@ -157,6 +167,312 @@ def dup_kv_weight(v, num_head, tp_size):
     return v.reshape(num_head * reps * head_size, -1).clone()
 
 
+def prefetch_file(path, chunk_size=16 * 1024 * 1024):
+    """Read a file into the page cache so later memory-mapped reads of it do not wait on storage."""
+    try:
+        with open(path, "rb", buffering=0) as f:
+            buf = bytearray(chunk_size)
+            while f.readinto(buf):
+                pass
+    except OSError:
+        pass
+
+
+def _bytes_read():
+    """Return the bytes this process has read from storage, including page faults on memory-mapped files."""
+    try:
+        with open("/proc/self/io") as fp:
+            for line in fp:
+                if line.startswith("read_bytes:"):
+                    return int(line.split()[1])
+    except (OSError, ValueError):
+        pass
+    return 0
+
+
+def _peak_rss():
+    """Return the peak RSS of this process in bytes."""
+    try:
+        with open("/proc/self/status") as fp:
+            for line in fp:
+                if line.startswith("VmHWM:"):
+                    return int(line.split()[1]) * 1024
+    except (OSError, ValueError):
+        pass
+    return resource.getrusage(resource.RUSAGE_SELF).ru_maxrss * 1024
+
+
+class ConversionProgress:
+    """The steps of a rank's conversion and the layers of the current step, with their time and bytes read.
+
+    Every update rewrites rank<N>.json in the progress directory, so other processes, such as the model server, can
+    report how far a long conversion has come and estimate when it will finish.
+    """
+
+    def __init__(self):
+        self.path = None
+        self.rank = 0
+        self._lock = threading.Lock()
+        self._reset()
+
+    def _reset(self):
+        self._started = time.time()
+        self._bytes_started = _bytes_read()
+        self._steps = []
+        self._step = None
+
+    def configure(self, progress_dir, rank):
+        """Start reporting the progress of a rank, writing it below progress_dir when it is set."""
+        with self._lock:
+            self.rank = rank
+            self.path = None
+            if progress_dir:
+                Path(progress_dir).mkdir(parents=True, exist_ok=True)
+                self.path = Path(progress_dir, f"rank{rank}.json")
+            self._reset()
+        self._write()
+
+    @contextlib.contextmanager
+    def step(self, name):
+        """Time the enclosed block as a conversion step."""
+        with self._lock:
+            self._step = {
+                "name": name,
+                "started": time.time(),
+                "bytes_started": _bytes_read(),
+                "unit": None,
+                "total": 0,
+                "items": [],
+            }
+        self._write()
+        try:
+            yield
+        finally:
+            with self._lock:
+                step = self._step
+                self._steps.append(
+                    {
+                        "name": step["name"],
+                        "seconds": time.time() - step["started"],
+                        "bytes_read": _bytes_read() - step["bytes_started"],
+                        "peak_rss_bytes": _peak_rss(),
+                        "unit": step["unit"],
+                        "items": step["items"],
+                    }
+                )
+                self._step = None
+            self._write()
+
+    def expect(self, total, unit="layers"):
+        """Announce how many layers, or other units, the current step will process, and start counting them."""
+        with self._lock:
+            if self._step is None:
+                return
+            now = time.time()
+            self._step.update(
+                total=total,
+                unit=unit,
+                items=[],
+                counting=now,
+                last=now,
+                bytes_last=_bytes_read(),
+            )
+        self._write()
+
+    def advance(self, name, seconds=None):
+        """Record that a layer of the current step is done, timed since the previous one unless seconds is given."""
+        with self._lock:
+            step = self._step
+            if step is None or step["unit"] is None:
+                return
+            now, bytes_read = time.time(), _bytes_read()
+            step["items"].append(
+                {
+                    "name": str(name),
+                    "seconds": now - step["last"] if seconds is None else seconds,
+                    "bytes_read": bytes_read - step["bytes_last"],
+                }
+            )
+            step.update(last=now, bytes_last=bytes_read)
+            done, total = len(step["items"]), step["total"]
+            eta = self._eta(step, now)
+        if step["unit"] == "layers":
+            tensorrt_llm.logger.info(
+                f"Layer {name} done ({done}/{total}), "
+                f"peak RSS {_peak_rss() / 2**30:.1f} GiB, ETA {eta:.0f}s"
+            )
+        self._write()
+
+    def track(self, items, unit="layers", name=str):
+        """Iterate over the items of the current step, recording each one as done when the next one is requested."""
+        items = list(items)
+        self.expect(len(items), unit)
+        for item in items:
+            yield item
+            self.advance(name(item))
+
+    @staticmethod
+    def _eta(step, now):
+        done = len(step["items"])
+        if not done:
+            return None
+        return (now - step["counting"]) / done * max(step["total"] - done, 0)
+
+    def snapshot(self):
+        """Return the progress as a JSON serializable dictionary."""
+        with self._lock:
+            now = time.time()
+            current = None
+            if self._step is not None:
+                step = self._step
+                current = {
+                    "name": step["name"],
+                    "seconds": now - step["started"],
+                    "bytes_read": _bytes_read() - step["bytes_started"],
+                    "unit": step["unit"],
+                    "done": len(step["items"]),
+                    "total": step["total"],
+                    "eta_seconds": self._eta(step, now),
+                    "items": list(step["items"]),
+                }
+            return {
+                "rank": self.rank,
+                "pid": os.getpid(),
+                "updated": now,
+                "seconds": now - self._started,
+                "bytes_read": _bytes_read() - self._bytes_started,
+                "peak_rss_bytes": _peak_rss(),
+                "step": current,
+                "steps": list(self._steps),
+            }
+
+    def _write(self):
+        if self.path is None:
+            return
+        tmp_path = str(self.path) + ".tmp"
+        try:
+            with open(tmp_path, "w") as fp:
+                json.dump(self.snapshot(), fp)
+            os.replace(tmp_path, self.path)
+        except OSError as err:
+            tensorrt_llm.logger.warning(f"Unable to write the progress file: {err}")
+
+
+PROGRESS = ConversionProgress()
+
+
+PRESHARDED_VERSION = 1
+
+
+def presharded_settings(args):
+    """Return everything that changes the rank local weights, and nothing that only changes the engine."""
+    source = next(
+        path
+        for path in [
+            args.quant_ckpt_path if args.per_group else None,
+            args.meta_ckpt_dir,
+            args.model_dir,
+            args.ft_model_dir,
+            "",
+        ]
+        if path is not None
+    )
+    source_files = []
+    if source and Path(source).exists():
+        paths = [Path(source)] if Path(source).is_file() else Path(source).iterdir()
+        for path in sorted(paths):
+            if path.is_file():
+                stat = path.stat()
+                source_files.append([path.name, stat.st_size, stat.st_mtime_ns])
+    return {
+        "version": PRESHARDED_VERSION,
+        "source": str(source),
+        "source_files": source_files,
+        "dtype": args.dtype,
+        "world_size": args.world_size,
+        "tp_size": args.tp_size,
+        "pp_size": args.pp_size,
+        "quant_mode": int(args.quant_mode),
+        "weight_only_precision": args.weight_only_precision,
+        "per_group": args.per_group,
+        "group_size": args.group_size,
+        "quantized_fp8_model_path": args.quantized_fp8_model_path,
+        "use_parallel_embedding": args.use_parallel_embedding,
+        "embedding_sharding_dim": args.embedding_sharding_dim,
+        "n_layer": args.n_layer,
+        "n_head": args.n_head,
+        "n_kv_head": args.n_kv_head,
+        "n_embd": args.n_embd,
+        "inter_size": args.inter_size,
+        "vocab_size": args.vocab_size,
+    }
+
+
+def save_presharded(tensorrt_llm_llama, presharded_dir, rank, settings):
+    """Write a rank's fully transformed weights so later builds with other engine options can skip loading."""
+    tik = time.time()
+    Path(presharded_dir).mkdir(parents=True, exist_ok=True)
+    tensors = {}
+    dtypes = {}
+    for name, param in tensorrt_llm_llama.named_parameters():
+        value = getattr(param, "_value", None)
+        if not isinstance(value, np.ndarray):
+            continue
+        if value.dtype == np_bfloat16:
+            # numpy has no bfloat16, so the raw bits are stored
+            value = value.view(np.uint16)
+            dtypes[name] = "bfloat16"
+        tensors[name] = np.ascontiguousarray(value)
+
+    weights_path = Path(presharded_dir, f"rank{rank}.safetensors")
+    save_file(tensors, str(weights_path) + ".tmp")
+    os.replace(str(weights_path) + ".tmp", weights_path)
+
+    # the manifest is written last, so it only exists for complete weights
+    manifest_path = Path(presharded_dir, f"rank{rank}.json")
+    with open(str(manifest_path) + ".tmp", "w") as fp:
+        json.dump({"settings": settings, "dtypes": dtypes}, fp, indent=2)
+    os.replace(str(manifest_path) + ".tmp", manifest_path)
+
+    t = time.strftime("%H:%M:%S", time.gmtime(time.time() - tik))
+    tensorrt_llm.logger.info(
+        f"Pre-sharded weights for rank {rank} saved to {presharded_dir}. Total time: {t}"
+    )
+
+
+def presharded_manifest(presharded_dir, rank, settings):
+    """Return the manifest of a rank's pre-sharded weights, or None if there are none for these settings."""
+    try:
+        with open(Path(presharded_dir, f"rank{rank}.json")) as fp:
+            manifest = json.load(fp)
+    except (OSError, ValueError):
+        return None
+    if manifest["settings"] != json.loads(json.dumps(settings)):
+        return None
+    return manifest
+
+
+def load_presharded(tensorrt_llm_llama, presharded_dir, rank, settings):
+    """Load a rank's pre-sharded weights, returning False if there are none for these settings."""
+    manifest = presharded_manifest(presharded_dir, rank, settings)
+    if manifest is None:
+        return False
+
+    tensorrt_llm.logger.info(f"Loading pre-sharded weights from {presharded_dir}...")
+    tik = time.time()
+    params = dict(tensorrt_llm_llama.named_parameters())
+    weights = safe_open(str(Path(presharded_dir, f"rank{rank}.safetensors")), "np")
+    for name in PROGRESS.track(weights.keys(), "tensors"):
+        value = weights.get_tensor(name)
+        if manifest["dtypes"].get(name) == "bfloat16":
+            value = value.view(np_bfloat16)
+        params[name].value = value
+
+    t = time.strftime("%H:%M:%S", time.gmtime(time.time() - tik))
+    tensorrt_llm.logger.info(f"Weights loaded. Total time: {t}")
+    return True
+
+
 def parse_ft_config(ini_file):
     gpt_config = configparser.ConfigParser()
     gpt_config.read(ini_file)
@@ -190,6 +506,7 @@ def load_from_hf_llama(
     hf_llama,
     mapping=Mapping(),
     dtype="float32",
+    workers=1,
 ):
     tensorrt_llm.logger.info("Loading weights from HF LLaMA...")
     tik = time.time()
@@ -204,8 +521,20 @@ def load_from_hf_llama(
     mha_mode = num_kv_heads == tensorrt_llm_llama.num_heads
 
     model_params = dict(hf_llama.named_parameters())
-    for l in range(hf_llama.config.num_hidden_layers):
-        prefix = f"model.layers.{l}.self_attn."
+    torch_dtype = str_dtype_to_torch(dtype)
+    layers_per_pipeline_stage = hf_llama.config.num_hidden_layers // mapping.pp_size
+    layers_range = list(
+        range(
+            mapping.pp_rank * layers_per_pipeline_stage,
+            (mapping.pp_rank + 1) * layers_per_pipeline_stage,
+            1,
+        )
+    )
+
+    def to_numpy(v):
+        return torch_to_numpy(v.to(torch_dtype).detach().cpu())
+
+    def qkv_weight(prefix):
         q_weight = model_params[prefix + "q_proj.weight"]
         k_weight = model_params[prefix + "k_proj.weight"]
         v_weight = model_params[prefix + "v_proj.weight"]
@@ -217,27 +546,41 @@ def load_from_hf_llama(
                 v_weight = dup_kv_weight(v_weight, num_kv_heads, mapping.tp_size)
             assert (k_weight.shape[0] % (mapping.tp_size * head_size)) == 0
             assert (v_weight.shape[0] % (mapping.tp_size * head_size)) == 0
-            qkv_weight = [q_weight, k_weight, v_weight]
-        else:
-            qkv_weight = torch.cat([q_weight, k_weight, v_weight], dim=0)
-
-        model_params[prefix + "qkv_proj.weight"] = qkv_weight
-
-    torch_dtype = str_dtype_to_torch(dtype)
-    layers_per_pipeline_stage = hf_llama.config.num_hidden_layers // mapping.pp_size
-    layers_range = list(
-        range(
-            mapping.pp_rank * layers_per_pipeline_stage,
-            (mapping.pp_rank + 1) * layers_per_pipeline_stage,
-            1,
+            wq = split(to_numpy(q_weight), mapping.tp_size, mapping.tp_rank)
+            wk = split(to_numpy(k_weight), mapping.tp_size, mapping.tp_rank)
+            wv = split(to_numpy(v_weight), mapping.tp_size, mapping.tp_rank)
+            return np.concatenate((wq, wk, wv))
+
+        v = to_numpy(torch.cat([q_weight, k_weight, v_weight], dim=0))
+        q_emb = v.shape[0] // 3
+        model_emb = v.shape[1]
+        v = v.reshape(3, q_emb, model_emb)
+        split_v = split(v, mapping.tp_size, mapping.tp_rank, dim=1)
+        return split_v.reshape(3 * (q_emb // mapping.tp_size), model_emb)
+
+    def linear(layer, split_v):
+        if not use_weight_only:
+            return [(layer.weight, np.ascontiguousarray(split_v))]
+        v = np.ascontiguousarray(split_v.transpose())
+        (
+            processed_torch_weights,
+            torch_weight_scales,
+        ) = torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
+            torch.tensor(v), plugin_weight_only_quant_type
         )
-    )
-    for k, v in model_params.items():
-        if isinstance(v, list):
-            v = [torch_to_numpy(vv.to(torch_dtype).detach().cpu()) for vv in v]
-        else:
-            v = torch_to_numpy(v.to(torch_dtype).detach().cpu())
+        # workaround for trt not supporting int8 inputs in plugins currently
+        return [
+            (layer.weight, processed_torch_weights.view(dtype=torch.float32).numpy()),
+            (layer.per_channel_scale, torch_weight_scales.numpy()),
+        ]
+
+    def transform(item):
+        """Convert a HF tensor into the rank local values of the parameters it maps to."""
+        k, v = item
         if "model.embed_tokens.weight" in k:
+            if not mapping.is_first_pp_rank():
+                return k, []
+            v = to_numpy(v)
             if tensorrt_llm_llama.use_parallel_embedding:
                 v = split(
                     v,
@@ -245,138 +588,55 @@ def load_from_hf_llama(
                     mapping.tp_rank,
                     tensorrt_llm_llama.embedding_sharding_dim,
                 )
-            if mapping.is_first_pp_rank():
-                tensorrt_llm_llama.vocab_embedding.weight.value = v
-        elif "model.norm.weight" in k:
-            if mapping.is_last_pp_rank():
-                tensorrt_llm_llama.ln_f.weight.value = v
-        elif "lm_head.weight" in k:
-            if mapping.is_last_pp_rank():
-                tensorrt_llm_llama.lm_head.weight.value = np.ascontiguousarray(
-                    split(v, mapping.tp_size, mapping.tp_rank)
-                )
-        else:
-            layer_idx = extract_layer_idx(k)
-            if layer_idx is None or int(layer_idx) not in layers_range:
-                continue
-            idx = int(layer_idx) - mapping.pp_rank * layers_per_pipeline_stage
-            if idx >= tensorrt_llm_llama.num_layers:
-                continue
-            if "input_layernorm.weight" in k:
-                tensorrt_llm_llama.layers[idx].input_layernorm.weight.value = v
-            elif "post_attention_layernorm.weight" in k:
-                dst = tensorrt_llm_llama.layers[idx].post_layernorm.weight
-                dst.value = v
-            elif "self_attn.qkv_proj.weight" in k:
-                dst = tensorrt_llm_llama.layers[idx].attention.qkv.weight
-                if not mha_mode:
-                    assert isinstance(v, list) and len(v) == 3
-                    wq = split(v[0], mapping.tp_size, mapping.tp_rank)
-                    wk = split(v[1], mapping.tp_size, mapping.tp_rank)
-                    wv = split(v[2], mapping.tp_size, mapping.tp_rank)
-                    split_v = np.concatenate((wq, wk, wv))
-                else:
-                    q_emb = v.shape[0] // 3
-                    model_emb = v.shape[1]
-                    v = v.reshape(3, q_emb, model_emb)
-                    split_v = split(v, mapping.tp_size, mapping.tp_rank, dim=1)
-                    split_v = split_v.reshape(3 * (q_emb // mapping.tp_size), model_emb)
-                if use_weight_only:
-                    v = np.ascontiguousarray(split_v.transpose())
-                    (
-                        processed_torch_weights,
-                        torch_weight_scales,
-                    ) = torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
-                        torch.tensor(v), plugin_weight_only_quant_type
-                    )
-                    # workaround for trt not supporting int8 inputs in plugins currently
-                    dst.value = processed_torch_weights.view(
-                        dtype=torch.float32
-                    ).numpy()
-                    scales = tensorrt_llm_llama.layers[
-                        idx
-                    ].attention.qkv.per_channel_scale
-                    scales.value = torch_weight_scales.numpy()
-                else:
-                    dst.value = np.ascontiguousarray(split_v)
-            elif "self_attn.o_proj.weight" in k:
-                dst = tensorrt_llm_llama.layers[idx].attention.dense.weight
-                split_v = split(v, mapping.tp_size, mapping.tp_rank, dim=1)
-                if use_weight_only:
-                    v = np.ascontiguousarray(split_v.transpose())
-                    (
-                        processed_torch_weights,
-                        torch_weight_scales,
-                    ) = torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
-                        torch.tensor(v), plugin_weight_only_quant_type
-                    )
-                    # workaround for trt not supporting int8 inputs in plugins currently
-                    dst.value = processed_torch_weights.view(
-                        dtype=torch.float32
-                    ).numpy()
-                    scales = tensorrt_llm_llama.layers[
-                        idx
-                    ].attention.dense.per_channel_scale
-                    scales.value = torch_weight_scales.numpy()
-                else:
-                    dst.value = np.ascontiguousarray(split_v)
-            elif "mlp.up_proj.weight" in k:
-                dst = tensorrt_llm_llama.layers[idx].mlp.gate.weight
-                split_v = split(v, mapping.tp_size, mapping.tp_rank, dim=0)
-                if use_weight_only:
-                    v = np.ascontiguousarray(split_v.transpose())
-                    (
-                        processed_torch_weights,
-                        torch_weight_scales,
-                    ) = torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
-                        torch.tensor(v), plugin_weight_only_quant_type
-                    )
-                    # workaround for trt not supporting int8 inputs in plugins currently
-                    dst.value = processed_torch_weights.view(
-                        dtype=torch.float32
-                    ).numpy()
-                    scales = tensorrt_llm_llama.layers[idx].mlp.gate.per_channel_scale
-                    scales.value = torch_weight_scales.numpy()
-                else:
-                    dst.value = np.ascontiguousarray(split_v)
-            elif "mlp.down_proj.weight" in k:
-                dst = tensorrt_llm_llama.layers[idx].mlp.proj.weight
-                split_v = split(v, mapping.tp_size, mapping.tp_rank, dim=1)
-                if use_weight_only:
-                    v = np.ascontiguousarray(split_v.transpose())
-                    (
-                        processed_torch_weights,
-                        torch_weight_scales,
-                    ) = torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
-                        torch.tensor(v), plugin_weight_only_quant_type
-                    )
-                    # workaround for trt not supporting int8 inputs in plugins currently
-                    dst.value = processed_torch_weights.view(
-                        dtype=torch.float32
-                    ).numpy()
-                    scales = tensorrt_llm_llama.layers[idx].mlp.proj.per_channel_scale
-                    scales.value = torch_weight_scales.numpy()
-                else:
-                    dst.value = np.ascontiguousarray(split_v)
-            elif "mlp.gate_proj.weight" in k:
-                dst = tensorrt_llm_llama.layers[idx].mlp.fc.weight
-                split_v = split(v, mapping.tp_size, mapping.tp_rank, dim=0)
-                if use_weight_only:
-                    v = np.ascontiguousarray(split_v.transpose())
-                    (
-                        processed_torch_weights,
-                        torch_weight_scales,
-                    ) = torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
-                        torch.tensor(v), plugin_weight_only_quant_type
-                    )
-                    # workaround for trt not supporting int8 inputs in plugins currently
-                    dst.value = processed_torch_weights.view(
-                        dtype=torch.float32
-                    ).numpy()
-                    scales = tensorrt_llm_llama.layers[idx].mlp.fc.per_channel_scale
-                    scales.value = torch_weight_scales.numpy()
-                else:
-                    dst.value = np.ascontiguousarray(split_v)
+            return k, [(tensorrt_llm_llama.vocab_embedding.weight, v)]
+        if "model.norm.weight" in k:
+            if not mapping.is_last_pp_rank():
+                return k, []
+            return k, [(tensorrt_llm_llama.ln_f.weight, to_numpy(v))]
+        if "lm_head.weight" in k:
+            if not mapping.is_last_pp_rank():
+                return k, []
+            v = np.ascontiguousarray(
+                split(to_numpy(v), mapping.tp_size, mapping.tp_rank)
+            )
+            return k, [(tensorrt_llm_llama.lm_head.weight, v)]
+
+        # skip the layers of other pipeline stages before paying for their conversion
+        layer_idx = extract_layer_idx(k)
+        if layer_idx is None or int(layer_idx) not in layers_range:
+            return k, []
+        idx = int(layer_idx) - mapping.pp_rank * layers_per_pipeline_stage
+        if idx >= tensorrt_llm_llama.num_layers:
+            return k, []
+        layer = tensorrt_llm_llama.layers[idx]
+        if "input_layernorm.weight" in k:
+            return k, [(layer.input_layernorm.weight, to_numpy(v))]
+        if "post_attention_layernorm.weight" in k:
+            return k, [(layer.post_layernorm.weight, to_numpy(v))]
+        if "self_attn.q_proj.weight" in k:
+            # k_proj and v_proj are fused into qkv along with q_proj
+            prefix = k[: -len("q_proj.weight")]
+            return k, linear(layer.attention.qkv, qkv_weight(prefix))
+        if "self_attn.o_proj.weight" in k:
+            split_v = split(to_numpy(v), mapping.tp_size, mapping.tp_rank, dim=1)
+            return k, linear(layer.attention.dense, split_v)
+        if "mlp.up_proj.weight" in k:
+            split_v = split(to_numpy(v), mapping.tp_size, mapping.tp_rank, dim=0)
+            return k, linear(layer.mlp.gate, split_v)
+        if "mlp.down_proj.weight" in k:
+            split_v = split(to_numpy(v), mapping.tp_size, mapping.tp_rank, dim=1)
+            return k, linear(layer.mlp.proj, split_v)
+        if "mlp.gate_proj.weight" in k:
+            split_v = split(to_numpy(v), mapping.tp_size, mapping.tp_rank, dim=0)
+            return k, linear(layer.mlp.fc, split_v)
+        return k, []
+
+    # the tensors are transformed on worker threads while this thread hands the finished ones to the model
+    PROGRESS.expect(len(model_params), "tensors")
+    for k, values in pipelined(transform, model_params.items(), workers):
+        for param, value in values:
+            param.value = value
+        PROGRESS.advance(k)
 
     tok = time.time()
     t = time.strftime("%H:%M:%S", time.gmtime(tok - tik))
@@ -384,199 +644,448 @@ def load_from_hf_llama(
     return
 
 
-def load_from_meta_llama(
+def has_safetensors(model_dir):
+    return any(Path(model_dir).glob("*.safetensors"))
+
+
+class SafetensorsCheckpoint:
+    """Memory-mapped access to the tensors in a directory of safetensors shards.
+
+    Nothing is read when the checkpoint is opened. Slicing a tensor only touches the pages that hold the requested
+    rows or columns, so each rank reads just its own shard of the weights.
+    """
+
+    def __init__(self, model_dir, framework="pt"):
+        self._framework = framework
+        self._handles = {}
+        index_file = Path(model_dir) / "model.safetensors.index.json"
+        if index_file.is_file():
+            with open(index_file) as fp:
+                weight_map = json.load(fp)["weight_map"]
+            self._files = {
+                name: str(Path(model_dir) / file) for name, file in weight_map.items()
+            }
+        else:
+            self._files = {}
+            for path in sorted(Path(model_dir).glob("*.safetensors")):
+                for name in self._handle(str(path)).keys():
+                    self._files[name] = str(path)
+
+    def _handle(self, path):
+        if path not in self._handles:
+            self._handles[path] = safe_open(path, framework=self._framework)
+        return self._handles[path]
+
+    def __contains__(self, name):
+        return name in self._files
+
+    def keys(self):
+        return self._files.keys()
+
+    def shape(self, name):
+        return self._handle(self._files[name]).get_slice(name).get_shape()
+
+    def read(self, name, dim=None, start=None, stop=None):
+        """Read a whole tensor, or only the [start, stop) range along dim."""
+        tensor_slice = self._handle(self._files[name]).get_slice(name)
+        if dim is None:
+            return tensor_slice[:]
+        if dim == 0:
+            return tensor_slice[start:stop]
+        return tensor_slice[:, start:stop]
+
+
+def rank_range(size, tp_size, tp_rank):
+    assert size % tp_size == 0, f"{size} can not be split evenly across {tp_size} ranks"
+    chunk = size // tp_size
+    return tp_rank * chunk, (tp_rank + 1) * chunk
+
+
+def kv_rank_range(num_kv_heads, head_size, tp_size, tp_rank):
+    if num_kv_heads < tp_size:
+        # the kv heads are duplicated up to tensor_parallel, so each rank reads a single head
+        head = tp_rank // (tp_size // num_kv_heads)
+        return head * head_size, (head + 1) * head_size
+    return rank_range(num_kv_heads * head_size, tp_size, tp_rank)
+
+
+def set_linear_weight(linear, v, use_weight_only, plugin_weight_only_quant_type):
+    if use_weight_only:
+        v = np.ascontiguousarray(v.transpose())
+        (
+            processed_torch_weights,
+            torch_weight_scales,
+        ) = torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
+            torch.tensor(v), plugin_weight_only_quant_type
+        )
+        # workaround for trt not supporting int8 inputs in plugins currently
+        linear.weight.value = processed_torch_weights.view(dtype=torch.float32).numpy()
+        linear.per_channel_scale.value = torch_weight_scales.numpy()
+    else:
+        linear.weight.value = np.ascontiguousarray(v)
+
+
+class SharedWeightPool:
+    """HF checkpoint tensors loaded once into shared memory for every rank of a parallel build.
+
+    The pool is created in the parent process and passed to the rank processes through torch.multiprocessing, which
+    attaches them to the same shared memory. Each shard file becomes a single flat buffer of the target dtype, so the
+    ranks only need one file descriptor per shard and take their tensors as views.
+    """
+
+    def __init__(self, buffers, layout):
+        self._buffers = buffers
+        # name -> (buffer index, offset, shape)
+        self._layout = layout
+
+    @staticmethod
+    def hf_bin_files(model_dir):
+        index_file = Path(model_dir) / "pytorch_model.bin.index.json"
+        if index_file.is_file():
+            with open(index_file) as fp:
+                files = set(json.load(fp)["weight_map"].values())
+            return sorted(Path(model_dir) / file for file in files)
+        return sorted(Path(model_dir).glob("pytorch_model*.bin"))
+
+    @classmethod
+    def from_hf_llama(cls, model_dir, dtype, shm_dir="/dev/shm"):
+        torch_dtype = str_dtype_to_torch(dtype)
+        files = cls.hf_bin_files(model_dir)
+        if not files:
+            raise RuntimeError(f"No pytorch_model*.bin files found in {model_dir}")
+
+        # size the pool before filling it, a full /dev/shm would crash the build with SIGBUS
+        itemsize = torch.empty(0, dtype=torch_dtype).element_size()
+        numel = 0
+        for path in files:
+            shard = load_torch_ckpt(path)
+            numel += sum(t.numel() for t in shard.values())
+            del shard
+        free = shutil.disk_usage(shm_dir).free
+        if numel * itemsize > free:
+            raise RuntimeError(
+                f"The shared weight pool needs {numel * itemsize} bytes but {shm_dir} only has {free} free."
+            )
+
+        buffers = []
+        layout = {}
+        for path in files:
+            shard = load_torch_ckpt(path)
+            buffer = torch.empty(
+                sum(t.numel() for t in shard.values()), dtype=torch_dtype
+            ).share_memory_()
+            offset = 0
+            for name, t in shard.items():
+                buffer[offset : offset + t.numel()].copy_(t.reshape(-1))
+                layout[name] = (len(buffers), offset, tuple(t.shape))
+                offset += t.numel()
+            buffers.append(buffer)
+            del shard
+        return cls(buffers, layout)
+
+    def __contains__(self, name):
+        return name in self._layout
+
+    def keys(self):
+        return self._layout.keys()
+
+    def shape(self, name):
+        return list(self._layout[name][2])
+
+    def read(self, name, dim=None, start=None, stop=None):
+        """Return a view of a whole tensor, or of the [start, stop) range along dim."""
+        buffer_idx, offset, shape = self._layout[name]
+        numel = int(np.prod(shape))
+        t = self._buffers[buffer_idx][offset : offset + numel].view(shape)
+        if dim is None:
+            return t
+        return t.narrow(dim, start, stop - start)
+
+
+def load_from_hf_safetensors_llama(
     tensorrt_llm_llama: tensorrt_llm.models.LLaMAForCausalLM,
-    meta_ckpt_dir,
+    model_dir,
     mapping=Mapping(),
     dtype="float32",
 ):
+    """Load the rank local weights straight from memory-mapped HF safetensors shards.
+
+    Unlike load_from_hf_llama, the HF model is never materialized. Each tensor is sliced for this rank before it is
+    read and cast, so peak host memory stays around the size of one layer instead of the whole model.
+    """
+    tensorrt_llm.logger.info("Loading weights from HF LLaMA safetensors...")
+    load_from_hf_checkpoint(
+        tensorrt_llm_llama, SafetensorsCheckpoint(model_dir), mapping, dtype
+    )
+
+
+def load_from_hf_checkpoint(
+    tensorrt_llm_llama: tensorrt_llm.models.LLaMAForCausalLM,
+    ckpt,
+    mapping=Mapping(),
+    dtype="float32",
+):
+    """Load the rank local weights from a lazily sliced HF checkpoint, such as SafetensorsCheckpoint."""
+    tik = time.time()
+
+    quant_mode = getattr(tensorrt_llm_llama, "quant_mode", QuantMode(0))
+    plugin_weight_only_quant_type = None
+    if quant_mode.is_int8_weight_only():
+        plugin_weight_only_quant_type = torch.int8
+    elif quant_mode.is_int4_weight_only():
+        plugin_weight_only_quant_type = torch.quint4x2
+    use_weight_only = quant_mode.is_weight_only()
     torch_dtype = str_dtype_to_torch(dtype)
+    num_kv_heads = tensorrt_llm_llama.num_kv_heads
+    head_size = tensorrt_llm_llama.hidden_size // tensorrt_llm_llama.num_heads
 
-    def gather_ckpts(ckpts):
-        gathered = {}
-        for k in ckpts[0]:
-            d = 0
-            if any([n in k for n in ["wo", "w2", "tok"]]):
-                d = 1
-            if "norm" in k or "rope" in k:  # no TP
-                gathered[k] = ckpts[0][k].clone()
-            else:
-                gathered[k] = torch.cat([pt[k] for pt in ckpts], dim=d).clone()
-        return gathered
-
-    def split_ckpt(ckpt, ranks_per_ckpt, ckpt_rank):
-        split_ckpt = {}
-        for k in ckpt:
-            d = 0
-            if any([n in k for n in ["wo", "w2", "tok"]]):
-                d = 1
-            if "norm" in k or "rope" in k:  # no TP
-                split_ckpt[k] = ckpt[k].clone()
-            elif tensorrt_llm_llama.num_kv_heads < mapping.tp_size and any(
-                [n in k for n in ["wk", "wv"]]
-            ):
-                assert mapping.tp_size % tensorrt_llm_llama.num_kv_heads == 0
-                # special case: we need to duplicate KV head
-                tmp = dup_kv_weight(
-                    ckpt[k], tensorrt_llm_llama.num_kv_heads, mapping.tp_size
-                )
-                split_ckpt[k] = torch.split(tmp, tmp.shape[d] // ranks_per_ckpt, dim=d)[
-                    ckpt_rank
-                ].clone()
-            else:
-                split_ckpt[k] = torch.split(
-                    ckpt[k], ckpt[k].shape[d] // ranks_per_ckpt, dim=d
-                )[ckpt_rank].clone()
-        return split_ckpt
+    def read(name, dim=None, start=None, stop=None):
+        return torch_to_numpy(ckpt.read(name, dim, start, stop).to(torch_dtype))
 
-    def get_current_weights(num_ckpts):
-        if num_ckpts > mapping.tp_size:
-            # combine ckpts
-            assert (num_ckpts % mapping.tp_size) == 0
-            nf = num_ckpts // mapping.tp_size
-            fs = nf * mapping.tp_rank
-            file_ids = list(range(fs, fs + nf))
-            ckpts = []
-            for f in file_ids:
-                ckpt = torch.load(
-                    Path(meta_ckpt_dir, f"consolidated.{f:02d}.pth"), map_location="cpu"
-                )
-                ckpts.append(ckpt)
-            return gather_ckpts(ckpts)
-        elif num_ckpts < mapping.tp_size:
-            # split ckpt
-            assert (mapping.tp_size % num_ckpts) == 0
-            ranks_per_ckpt = mapping.tp_size // num_ckpts
-            ckpt_fid = mapping.tp_rank // ranks_per_ckpt
-            ckpt_rank = mapping.tp_rank % ranks_per_ckpt
-            nH_per_ckpt = tensorrt_llm_llama.num_heads // num_ckpts
-            assert (nH_per_ckpt % ranks_per_ckpt) == 0
-            ckpt = torch.load(
-                Path(meta_ckpt_dir, f"consolidated.{ckpt_fid:02d}.pth"),
-                map_location="cpu",
+    def read_split(name, dim):
+        start, stop = rank_range(
+            ckpt.shape(name)[dim], mapping.tp_size, mapping.tp_rank
+        )
+        return read(name, dim, start, stop)
+
+    def set_linear(linear, v):
+        set_linear_weight(linear, v, use_weight_only, plugin_weight_only_quant_type)
+
+    if mapping.is_first_pp_rank():
+        v = (
+            read_split(
+                "model.embed_tokens.weight", tensorrt_llm_llama.embedding_sharding_dim
             )
-            return split_ckpt(ckpt, ranks_per_ckpt, ckpt_rank)
+            if tensorrt_llm_llama.use_parallel_embedding
+            else read("model.embed_tokens.weight")
+        )
+        tensorrt_llm_llama.vocab_embedding.weight.value = v
+    if mapping.is_last_pp_rank():
+        tensorrt_llm_llama.ln_f.weight.value = read("model.norm.weight")
+        # checkpoints with tied embeddings do not store the lm head
+        lm_head = (
+            "lm_head.weight"
+            if "lm_head.weight" in ckpt
+            else "model.embed_tokens.weight"
+        )
+        tensorrt_llm_llama.lm_head.weight.value = np.ascontiguousarray(
+            read_split(lm_head, 0)
+        )
 
-        # num_ckpts == tensor_parallel, 1:1 mapping from files to TP
-        return torch.load(
-            Path(meta_ckpt_dir, f"consolidated.{mapping.tp_rank:02d}.pth"),
-            map_location="cpu",
+    num_hidden_layers = len(
+        {
+            extract_layer_idx(name)
+            for name in ckpt.keys()
+            if name.startswith("model.layers.")
+        }
+    )
+    layers_per_pipeline_stage = num_hidden_layers // mapping.pp_size
+    first_layer = mapping.pp_rank * layers_per_pipeline_stage
+    for idx in PROGRESS.track(
+        range(layers_per_pipeline_stage), name=lambda idx: first_layer + idx
+    ):
+        prefix = f"model.layers.{first_layer + idx}."
+        layer = tensorrt_llm_llama.layers[idx]
+
+        layer.input_layernorm.weight.value = read(prefix + "input_layernorm.weight")
+        layer.post_layernorm.weight.value = read(
+            prefix + "post_attention_layernorm.weight"
         )
 
+        kv_start, kv_stop = kv_rank_range(
+            num_kv_heads, head_size, mapping.tp_size, mapping.tp_rank
+        )
+        q = read_split(prefix + "self_attn.q_proj.weight", 0)
+        k = read(prefix + "self_attn.k_proj.weight", 0, kv_start, kv_stop)
+        v = read(prefix + "self_attn.v_proj.weight", 0, kv_start, kv_stop)
+        set_linear(layer.attention.qkv, np.concatenate((q, k, v)))
+        set_linear(
+            layer.attention.dense, read_split(prefix + "self_attn.o_proj.weight", 1)
+        )
+
+        set_linear(layer.mlp.gate, read_split(prefix + "mlp.up_proj.weight", 0))
+        set_linear(layer.mlp.proj, read_split(prefix + "mlp.down_proj.weight", 1))
+        set_linear(layer.mlp.fc, read_split(prefix + "mlp.gate_proj.weight", 0))
+
+    tok = time.time()
+    t = time.strftime("%H:%M:%S", time.gmtime(tok - tik))
+    tensorrt_llm.logger.info(f"Weights loaded. Total time: {t}")
+
+
+def load_torch_ckpt(path):
+    """Open a torch checkpoint, memory-mapping it when torch supports it so tensors are only read when used."""
+    try:
+        return torch.load(path, map_location="cpu", mmap=True)
+    except (TypeError, RuntimeError):
+        # older torch releases and legacy (non zipfile) checkpoints can not be memory-mapped
+        return torch.load(path, map_location="cpu")
+
+
+def meta_tp_dim(name):
+    """Return the dimension a Meta checkpoint shards a tensor along, or None if it is replicated."""
+    if "norm" in name or "rope" in name:
+        return None
+    if any([n in name for n in ["wo", "w2", "tok"]]):
+        return 1
+    return 0
+
+
+class MetaCheckpoint:
+    """The consolidated.XX.pth files of a Meta checkpoint, resharded for a tensor parallel rank.
+
+    The files are memory-mapped and only opened when one of their tensors is needed. Resharding is done with views,
+    so the only copies made are the final rank local tensors.
+    """
+
+    def __init__(self, meta_ckpt_dir):
+        self._paths = sorted(Path(meta_ckpt_dir).glob("consolidated.*.pth"))
+        self._files = {}
+
+    def __len__(self):
+        return len(self._paths)
+
+    def file(self, idx):
+        if idx not in self._files:
+            self._files[idx] = load_torch_ckpt(self._paths[idx])
+        return self._files[idx]
+
+    def full(self, name):
+        """Gather a tensor from every file."""
+        dim = meta_tp_dim(name)
+        if dim is None or len(self) == 1:
+            return self.file(0)[name]
+        return torch.cat([self.file(f)[name] for f in range(len(self))], dim=dim)
+
+    def rank_local(self, name, tp_size, tp_rank, num_kv_heads):
+        """Return the part of a tensor that belongs to a tensor parallel rank."""
+        num_ckpts = len(self)
+        dim = meta_tp_dim(name)
+        if dim is None:
+            return self.file(0)[name]
+
+        if num_ckpts == tp_size:
+            # 1:1 mapping from files to TP
+            return self.file(tp_rank)[name]
+
+        if num_ckpts > tp_size:
+            # combine ckpts
+            assert (num_ckpts % tp_size) == 0
+            nf = num_ckpts // tp_size
+            fs = nf * tp_rank
+            return torch.cat([self.file(f)[name] for f in range(fs, fs + nf)], dim=dim)
+
+        # split ckpt
+        assert (tp_size % num_ckpts) == 0
+        ranks_per_ckpt = tp_size // num_ckpts
+        ckpt_rank = tp_rank % ranks_per_ckpt
+        weight = self.file(tp_rank // ranks_per_ckpt)[name]
+        if num_kv_heads < tp_size and any([n in name for n in ["wk", "wv"]]):
+            # special case: the KV heads are duplicated, so each rank takes a single head
+            kv_heads_per_ckpt = max(num_kv_heads // num_ckpts, 1)
+            assert ranks_per_ckpt % kv_heads_per_ckpt == 0
+            head_size = weight.shape[dim] // kv_heads_per_ckpt
+            head = ckpt_rank // (ranks_per_ckpt // kv_heads_per_ckpt)
+            return weight.narrow(dim, head * head_size, head_size)
+        chunk = weight.shape[dim] // ranks_per_ckpt
+        return weight.narrow(dim, ckpt_rank * chunk, chunk)
+
+
+def load_from_meta_llama(
+    tensorrt_llm_llama: tensorrt_llm.models.LLaMAForCausalLM,
+    meta_ckpt_dir,
+    mapping=Mapping(),
+    dtype="float32",
+):
+    torch_dtype = str_dtype_to_torch(dtype)
+
     def permute(w, nH, d, dH):
         # due to MQA's wk, nH*dH != d could be true
         return w.view(nH, dH // 2, 2, d).transpose(1, 2).reshape(nH * dH, d)
 
-    if not hasattr(load_from_meta_llama, "saved_embed"):
-        load_from_meta_llama.saved_embed = None
-
-    def gather_embedding(cur_embed, name: str, num_ckpts):
-        if mapping.tp_size == 1:
-            # even if num_ckpts > 1, get_current_weights will already have it gathered
-            return cur_embed
-        if load_from_meta_llama.saved_embed is None:
-            embeds = [None] * num_ckpts
-            for i in range(num_ckpts):
-                ckpt = torch.load(
-                    Path(meta_ckpt_dir, f"consolidated.{i:02d}.pth"), map_location="cpu"
-                )
-                embeds[i] = ckpt[name]
-            embed = torch.cat(embeds, dim=1).to(torch_dtype)
-            load_from_meta_llama.saved_embed = torch_to_numpy(
-                embed
-            )  # cache the embedding, not needed if no refit
-        return load_from_meta_llama.saved_embed
+    def to_numpy(t):
+        return torch_to_numpy(t.to(torch_dtype).contiguous())
 
     tensorrt_llm.logger.info("Loading weights from Meta LLaMA checkpoints ...")
     tik = time.time()
 
-    quant_mode = getattr(tensorrt_llm_llama, "quant_mode", QuantMode(0))
-    if quant_mode.is_int8_weight_only():
-        torch.int8
-    elif quant_mode.is_int4_weight_only():
-        torch.quint4x2
-    quant_mode.is_weight_only()
     num_kv_heads = tensorrt_llm_llama.num_kv_heads
-    mha_mode = num_kv_heads == tensorrt_llm_llama.num_heads
 
-    ckpts = list(Path(meta_ckpt_dir).glob("consolidated.*.pth"))
-    num_ckpts = len(ckpts)
+    ckpt = MetaCheckpoint(meta_ckpt_dir)
+    num_ckpts = len(ckpt)
     # llama/llama2 doesn't have MQA. So, simplifying loader logic by not worrying about it.
     assert (
         num_kv_heads > 1 or num_kv_heads >= num_ckpts
     ), f"We don't know how the {num_kv_heads} KV heads are distributed among {num_ckpts} checkpoints."
+    if num_kv_heads < mapping.tp_size and num_ckpts >= mapping.tp_size:
+        assert mapping.tp_size % num_kv_heads == 0
+        assert False, "Not supported yet"
+
+    def rank_local(name):
+        return ckpt.rank_local(name, mapping.tp_size, mapping.tp_rank, num_kv_heads)
 
     head_size = tensorrt_llm_llama.hidden_size // tensorrt_llm_llama.num_heads
-    ckpt = get_current_weights(num_ckpts)
-    layers_range = list(
-        range(
-            mapping.pp_rank * tensorrt_llm_llama.num_layers,
-            (mapping.pp_rank + 1) * tensorrt_llm_llama.num_layers,
-            1,
-        )
-    )
 
-    for l in layers_range:
-        prefix = f"layers.{l}.attention."
+    if mapping.is_first_pp_rank():
+        name = "tok_embeddings.weight"
+        if (
+            tensorrt_llm_llama.use_parallel_embedding
+            and tensorrt_llm_llama.embedding_sharding_dim == 1
+        ):
+            v = rank_local(name)
+        else:
+            v = ckpt.full(name)
+            if tensorrt_llm_llama.use_parallel_embedding:
+                # this needs a gather and then resplit along different dims
+                chunk = v.shape[0] // mapping.tp_size
+                v = v.narrow(0, mapping.tp_rank * chunk, chunk)
+        tensorrt_llm_llama.vocab_embedding.weight.value = to_numpy(v)
+    if mapping.is_last_pp_rank():
+        tensorrt_llm_llama.lm_head.weight.value = to_numpy(rank_local("output.weight"))
+        tensorrt_llm_llama.ln_f.weight.value = to_numpy(rank_local("norm.weight"))
+
+    # only the layers of this pipeline stage are read
+    first_layer = mapping.pp_rank * tensorrt_llm_llama.num_layers
+    for idx in PROGRESS.track(
+        range(tensorrt_llm_llama.num_layers), name=lambda idx: first_layer + idx
+    ):
+        prefix = f"layers.{first_layer + idx}."
+        layer = tensorrt_llm_llama.layers[idx]
+
         q_weight = permute(
-            ckpt[prefix + "wq.weight"].clone(),
+            rank_local(prefix + "attention.wq.weight"),
             nH=(tensorrt_llm_llama.num_heads // mapping.tp_size),
             d=tensorrt_llm_llama.hidden_size,
             dH=head_size,
         )
-        if num_kv_heads < mapping.tp_size and num_ckpts >= mapping.tp_size:
-            assert mapping.tp_size % num_kv_heads == 0
-            assert False, "Not supported yet"
         k_weight = permute(
-            ckpt[prefix + "wk.weight"].clone(),
+            rank_local(prefix + "attention.wk.weight"),
             nH=((num_kv_heads + mapping.tp_size - 1) // mapping.tp_size),
             d=tensorrt_llm_llama.hidden_size,
             dH=head_size,
         )
-        v_weight = ckpt[prefix + "wv.weight"].clone()
-
-        qkv_weight = torch.cat([q_weight, k_weight, v_weight], dim=0)
-        ckpt[prefix + "qkv.weight"] = qkv_weight
+        v_weight = rank_local(prefix + "attention.wv.weight")
+        layer.attention.qkv.weight.value = to_numpy(
+            torch.cat([q_weight, k_weight, v_weight], dim=0)
+        )
+        layer.attention.dense.weight.value = to_numpy(
+            rank_local(prefix + "attention.wo.weight")
+        )
 
-    for k, v in ckpt.items():
-        v = torch_to_numpy(v.to(torch_dtype).detach().cpu())
-        if "tok_embeddings" in k:
-            if not tensorrt_llm_llama.use_parallel_embedding:
-                v = gather_embedding(v, k, num_ckpts)
-            elif tensorrt_llm_llama.embedding_sharding_dim == 0:
-                # this needs a gather and then resplit along different dims
-                v = gather_embedding(v, k, num_ckpts)
-                v = split(v, mapping.tp_size, mapping.tp_rank, 0)
-            if mapping.is_first_pp_rank():
-                tensorrt_llm_llama.vocab_embedding.weight.value = v
-        elif "output" in k:
-            if mapping.is_last_pp_rank():
-                tensorrt_llm_llama.lm_head.weight.value = v
-        elif k == "norm.weight":
-            if mapping.is_last_pp_rank():
-                tensorrt_llm_llama.ln_f.weight.value = v
-        else:
-            # layer specific weights
-            layer_idx = extract_layer_idx(k)
-            if layer_idx is None:
-                continue
-            idx = int(layer_idx) - mapping.pp_rank * tensorrt_llm_llama.num_layers
-            if idx >= tensorrt_llm_llama.num_layers:
-                continue
-            if "attention_norm.weight" in k:
-                tensorrt_llm_llama.layers[idx].input_layernorm.weight.value = v
-            elif "ffn_norm.weight" in k:
-                tensorrt_llm_llama.layers[idx].post_layernorm.weight.value = v
-            elif "feed_forward.w3.weight" in k:
-                tensorrt_llm_llama.layers[idx].mlp.gate.weight.value = v
-            elif "feed_forward.w2.weight" in k:
-                tensorrt_llm_llama.layers[idx].mlp.proj.weight.value = v
-            elif "feed_forward.w1.weight" in k:
-                tensorrt_llm_llama.layers[idx].mlp.fc.weight.value = v
-            elif "attention.wo.weight" in k:
-                tensorrt_llm_llama.layers[idx].attention.dense.weight.value = v
-            elif "attention.qkv.weight" in k:
-                tensorrt_llm_llama.layers[idx].attention.qkv.weight.value = v
+        layer.input_layernorm.weight.value = to_numpy(
+            rank_local(prefix + "attention_norm.weight")
+        )
+        layer.post_layernorm.weight.value = to_numpy(
+            rank_local(prefix + "ffn_norm.weight")
+        )
+        layer.mlp.gate.weight.value = to_numpy(
+            rank_local(prefix + "feed_forward.w3.weight")
+        )
+        layer.mlp.proj.weight.value = to_numpy(
+            rank_local(prefix + "feed_forward.w2.weight")
+        )
+        layer.mlp.fc.weight.value = to_numpy(
+            rank_local(prefix + "feed_forward.w1.weight")
+        )
 
     tok = time.time()
     t = time.strftime("%H:%M:%S", time.gmtime(tok - tik))
@@ -612,7 +1121,8 @@ def load_from_binary(
         dtype = np_dtype if dtype is None else dtype
         p = dir_path + "/" + name
         if Path(p).exists():
-            t = np.fromfile(p, dtype=dtype)
+            # memory-map the file so only the parts this rank uses are read, when they are used
+            t = np.memmap(p, dtype=dtype, mode="r")
             if shape is not None:
                 t = t.reshape(shape)
             return t
@@ -717,20 +1227,19 @@ def load_from_binary(
 
     if mapping.is_last_pp_rank():
         tensorrt_llm_llama.ln_f.weight.value = fromfile(dir_path, "ln_f.weight.bin")
-    # share input embedding
-    lm_head_weight = fromfile(dir_path, "lm_head.weight.bin", [vocab_size, n_embd])
-
-    if vocab_size % mapping.tp_size != 0:
-        # padding
-        vocab_size_padded = tensorrt_llm_llama.lm_head.out_features * mapping.tp_size
-        pad_width = vocab_size_padded - vocab_size
-        lm_head_weight = np.pad(
-            lm_head_weight, ((0, pad_width), (0, 0)), "constant", constant_values=0
-        )
-    if mapping.is_last_pp_rank():
-        tensorrt_llm_llama.lm_head.weight.value = np.ascontiguousarray(
-            split(lm_head_weight, mapping.tp_size, mapping.tp_rank)
-        )
+        # share input embedding
+        lm_head_weight = fromfile(dir_path, "lm_head.weight.bin", [vocab_size, n_embd])
+
+        if vocab_size % mapping.tp_size != 0:
+            # padding, only this rank's rows are read and padded
+            rows = tensorrt_llm_llama.lm_head.out_features
+            start = mapping.tp_rank * rows
+            available = max(min(vocab_size, start + rows) - start, 0)
+            lm_head_local = np.zeros((rows, n_embd), dtype=lm_head_weight.dtype)
+            lm_head_local[:available] = lm_head_weight[start : start + available]
+        else:
+            lm_head_local = split(lm_head_weight, mapping.tp_size, mapping.tp_rank)
+        tensorrt_llm_llama.lm_head.weight.value = np.ascontiguousarray(lm_head_local)
 
     layers_range = list(
         range(
@@ -740,40 +1249,104 @@ def load_from_binary(
         )
     )
 
-    for i in layers_range:
-        n_groups = n_head // n_kv_head
-        c_attn_out_dim = (
-            (3 * n_embd // mapping.tp_size)
-            if not multi_query_mode
-            else (
-                n_embd // mapping.tp_size
-                + (n_embd // n_head * n_groups) // mapping.tp_size * 2
+    # the files of each layer that this rank reads
+    rank_file_re = re.compile(rf"(\.{mapping.tp_rank}\.bin|[^0-9]\.bin)$")
+    layer_files = {i: [] for i in layers_range}
+    for name in os.listdir(dir_path):
+        layer_idx = extract_layer_idx(name)
+        if layer_idx is not None and int(layer_idx) in layer_files:
+            if rank_file_re.search(name):
+                layer_files[int(layer_idx)].append(os.path.join(dir_path, name))
+    prefetcher = ThreadPoolExecutor(max_workers=4)
+    try:
+        for i in PROGRESS.track(layers_range):
+            # read the next layer's files in the background while this one is converted
+            for path in layer_files.get(i + 1, []):
+                prefetcher.submit(prefetch_file, path)
+            n_groups = n_head // n_kv_head
+            c_attn_out_dim = (
+                (3 * n_embd // mapping.tp_size)
+                if not multi_query_mode
+                else (
+                    n_embd // mapping.tp_size
+                    + (n_embd // n_head * n_groups) // mapping.tp_size * 2
+                )
+            )
+            idx = i - mapping.pp_rank * tensorrt_llm_llama.num_layers
+            tensorrt_llm_llama.layers[idx].input_layernorm.weight.value = fromfile(
+                dir_path, "model.layers." + str(i) + ".input_layernorm.weight.bin"
+            )
+            t = fromfile(
+                dir_path,
+                "model.layers."
+                + str(i)
+                + ".attention.query_key_value.weight."
+                + suffix,
+                [n_embd, c_attn_out_dim],
+                w_type,
+            )
+            if t is not None:
+                dst = tensorrt_llm_llama.layers[idx].attention.qkv.weight
+                if use_smooth_quant:
+                    dst.value = sq_trick(np.ascontiguousarray(np.transpose(t, [1, 0])))
+                    set_smoothquant_scale_factors(
+                        tensorrt_llm_llama.layers[idx].attention.qkv,
+                        tensorrt_llm_llama.layers[idx].input_layernorm.scale_to_int,
+                        dir_path,
+                        "model.layers." + str(i) + ".attention.query_key_value.",
+                        [1, c_attn_out_dim],
+                        quant_per_token_dyn,
+                        quant_per_channel,
+                        rank=mapping.tp_rank,
+                        is_qkv=True,
+                    )
+                elif use_weight_only:
+                    (
+                        processed_torch_weights,
+                        torch_weight_scales,
+                    ) = torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
+                        torch.tensor(t), plugin_weight_only_quant_type
+                    )
+                    # workaround for trt not supporting int8 inputs in plugins currently
+                    dst.value = processed_torch_weights.view(
+                        dtype=torch.float32
+                    ).numpy()
+                    scales = tensorrt_llm_llama.layers[
+                        i
+                    ].attention.qkv.per_channel_scale
+                    scales.value = torch_weight_scales.numpy()
+                else:
+                    dst.value = np.ascontiguousarray(np.transpose(t, [1, 0]))
+
+            dst = tensorrt_llm_llama.layers[idx].attention.dense.weight
+            t = fromfile(
+                dir_path,
+                "model.layers." + str(i) + ".attention.dense.weight." + suffix,
+                [n_embd // mapping.tp_size, n_embd],
+                w_type,
             )
-        )
-        idx = i - mapping.pp_rank * tensorrt_llm_llama.num_layers
-        tensorrt_llm_llama.layers[idx].input_layernorm.weight.value = fromfile(
-            dir_path, "model.layers." + str(i) + ".input_layernorm.weight.bin"
-        )
-        t = fromfile(
-            dir_path,
-            "model.layers." + str(i) + ".attention.query_key_value.weight." + suffix,
-            [n_embd, c_attn_out_dim],
-            w_type,
-        )
-        if t is not None:
-            dst = tensorrt_llm_llama.layers[idx].attention.qkv.weight
             if use_smooth_quant:
                 dst.value = sq_trick(np.ascontiguousarray(np.transpose(t, [1, 0])))
+                dense_scale = getattr(
+                    tensorrt_llm_llama.layers[idx].attention,
+                    "quantization_scaling_factor",
+                    None,
+                )
                 set_smoothquant_scale_factors(
-                    tensorrt_llm_llama.layers[idx].attention.qkv,
-                    tensorrt_llm_llama.layers[idx].input_layernorm.scale_to_int,
+                    tensorrt_llm_llama.layers[idx].attention.dense,
+                    dense_scale,
                     dir_path,
-                    "model.layers." + str(i) + ".attention.query_key_value.",
-                    [1, c_attn_out_dim],
+                    "model.layers." + str(i) + ".attention.dense.",
+                    [1, n_embd],
                     quant_per_token_dyn,
                     quant_per_channel,
-                    rank=mapping.tp_rank,
-                    is_qkv=True,
+                )
+                set_smoother(
+                    tensorrt_llm_llama.layers[idx].attention.dense,
+                    dir_path,
+                    "model.layers." + str(i) + ".attention.dense",
+                    [1, n_embd // mapping.tp_size],
+                    mapping.tp_rank,
                 )
             elif use_weight_only:
                 (
@@ -784,207 +1357,309 @@ def load_from_binary(
                 )
                 # workaround for trt not supporting int8 inputs in plugins currently
                 dst.value = processed_torch_weights.view(dtype=torch.float32).numpy()
-                scales = tensorrt_llm_llama.layers[i].attention.qkv.per_channel_scale
+                scales = tensorrt_llm_llama.layers[i].attention.dense.per_channel_scale
                 scales.value = torch_weight_scales.numpy()
             else:
                 dst.value = np.ascontiguousarray(np.transpose(t, [1, 0]))
 
-        dst = tensorrt_llm_llama.layers[idx].attention.dense.weight
-        t = fromfile(
-            dir_path,
-            "model.layers." + str(i) + ".attention.dense.weight." + suffix,
-            [n_embd // mapping.tp_size, n_embd],
-            w_type,
-        )
-        if use_smooth_quant:
-            dst.value = sq_trick(np.ascontiguousarray(np.transpose(t, [1, 0])))
-            dense_scale = getattr(
-                tensorrt_llm_llama.layers[idx].attention,
-                "quantization_scaling_factor",
-                None,
-            )
-            set_smoothquant_scale_factors(
-                tensorrt_llm_llama.layers[idx].attention.dense,
-                dense_scale,
-                dir_path,
-                "model.layers." + str(i) + ".attention.dense.",
-                [1, n_embd],
-                quant_per_token_dyn,
-                quant_per_channel,
-            )
-            set_smoother(
-                tensorrt_llm_llama.layers[idx].attention.dense,
-                dir_path,
-                "model.layers." + str(i) + ".attention.dense",
-                [1, n_embd // mapping.tp_size],
-                mapping.tp_rank,
-            )
-        elif use_weight_only:
-            (
-                processed_torch_weights,
-                torch_weight_scales,
-            ) = torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
-                torch.tensor(t), plugin_weight_only_quant_type
+            dst = tensorrt_llm_llama.layers[idx].post_layernorm.weight
+            dst.value = fromfile(
+                dir_path, "model.layers." + str(i) + ".post_layernorm.weight.bin"
             )
-            # workaround for trt not supporting int8 inputs in plugins currently
-            dst.value = processed_torch_weights.view(dtype=torch.float32).numpy()
-            scales = tensorrt_llm_llama.layers[i].attention.dense.per_channel_scale
-            scales.value = torch_weight_scales.numpy()
-        else:
-            dst.value = np.ascontiguousarray(np.transpose(t, [1, 0]))
-
-        dst = tensorrt_llm_llama.layers[idx].post_layernorm.weight
-        dst.value = fromfile(
-            dir_path, "model.layers." + str(i) + ".post_layernorm.weight.bin"
-        )
-
-        t = fromfile(
-            dir_path,
-            "model.layers." + str(i) + ".mlp.fc.weight." + suffix,
-            [n_embd, inter_size // mapping.tp_size],
-            w_type,
-        )
 
-        if use_smooth_quant:
-            tensorrt_llm_llama.layers[idx].mlp.fc.weight.value = sq_trick(
-                np.ascontiguousarray(np.transpose(t, [1, 0]))
-            )
-            set_smoothquant_scale_factors(
-                tensorrt_llm_llama.layers[idx].mlp.fc,
-                tensorrt_llm_llama.layers[idx].post_layernorm.scale_to_int,
+            t = fromfile(
                 dir_path,
-                "model.layers." + str(i) + ".mlp.fc.",
-                [1, inter_size // mapping.tp_size],
-                quant_per_token_dyn,
-                quant_per_channel,
-                rank=mapping.tp_rank,
-            )
-        elif use_weight_only:
-            dst = tensorrt_llm_llama.layers[i].mlp.fc.weight
-            (
-                processed_torch_weights,
-                torch_weight_scales,
-            ) = torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
-                torch.tensor(t), plugin_weight_only_quant_type
-            )
-            # workaround for trt not supporting int8 inputs in plugins currently
-            dst.value = processed_torch_weights.view(dtype=torch.float32).numpy()
-            scales = tensorrt_llm_llama.layers[i].mlp.fc.per_channel_scale
-            scales.value = torch_weight_scales.numpy()
-        else:
-            tensorrt_llm_llama.layers[idx].mlp.fc.weight.value = np.ascontiguousarray(
-                np.transpose(t, [1, 0])
+                "model.layers." + str(i) + ".mlp.fc.weight." + suffix,
+                [n_embd, inter_size // mapping.tp_size],
+                w_type,
             )
 
-        t = fromfile(
-            dir_path,
-            "model.layers." + str(i) + ".mlp.gate.weight." + suffix,
-            [n_embd, inter_size // mapping.tp_size],
-            w_type,
-        )
-        if use_smooth_quant:
-            tensorrt_llm_llama.layers[idx].mlp.gate.weight.value = sq_trick(
-                np.ascontiguousarray(np.transpose(t, [1, 0]))
-            )
-            set_smoothquant_scale_factors(
-                tensorrt_llm_llama.layers[idx].mlp.gate,
-                tensorrt_llm_llama.layers[idx].post_layernorm.scale_to_int,
-                dir_path,
-                "model.layers." + str(i) + ".mlp.gate.",
-                [1, inter_size // mapping.tp_size],
-                quant_per_token_dyn,
-                quant_per_channel,
-                rank=mapping.tp_rank,
-            )
-        elif use_weight_only:
-            dst = tensorrt_llm_llama.layers[i].mlp.gate.weight
-            (
-                processed_torch_weights,
-                torch_weight_scales,
-            ) = torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
-                torch.tensor(t), plugin_weight_only_quant_type
-            )
-            # workaround for trt not supporting int8 inputs in plugins currently
-            dst.value = processed_torch_weights.view(dtype=torch.float32).numpy()
-            scales = tensorrt_llm_llama.layers[i].mlp.gate.per_channel_scale
-            scales.value = torch_weight_scales.numpy()
-        else:
-            tensorrt_llm_llama.layers[idx].mlp.gate.weight.value = np.ascontiguousarray(
-                np.transpose(t, [1, 0])
-            )
+            if use_smooth_quant:
+                tensorrt_llm_llama.layers[idx].mlp.fc.weight.value = sq_trick(
+                    np.ascontiguousarray(np.transpose(t, [1, 0]))
+                )
+                set_smoothquant_scale_factors(
+                    tensorrt_llm_llama.layers[idx].mlp.fc,
+                    tensorrt_llm_llama.layers[idx].post_layernorm.scale_to_int,
+                    dir_path,
+                    "model.layers." + str(i) + ".mlp.fc.",
+                    [1, inter_size // mapping.tp_size],
+                    quant_per_token_dyn,
+                    quant_per_channel,
+                    rank=mapping.tp_rank,
+                )
+            elif use_weight_only:
+                dst = tensorrt_llm_llama.layers[i].mlp.fc.weight
+                (
+                    processed_torch_weights,
+                    torch_weight_scales,
+                ) = torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
+                    torch.tensor(t), plugin_weight_only_quant_type
+                )
+                # workaround for trt not supporting int8 inputs in plugins currently
+                dst.value = processed_torch_weights.view(dtype=torch.float32).numpy()
+                scales = tensorrt_llm_llama.layers[i].mlp.fc.per_channel_scale
+                scales.value = torch_weight_scales.numpy()
+            else:
+                tensorrt_llm_llama.layers[
+                    idx
+                ].mlp.fc.weight.value = np.ascontiguousarray(np.transpose(t, [1, 0]))
 
-        t = fromfile(
-            dir_path,
-            "model.layers." + str(i) + ".mlp.proj.weight." + suffix,
-            [inter_size // mapping.tp_size, n_embd],
-            w_type,
-        )
-        if use_smooth_quant:
-            tensorrt_llm_llama.layers[idx].mlp.proj.weight.value = sq_trick(
-                np.ascontiguousarray(np.transpose(t, [1, 0]))
-            )
-            proj_scale = getattr(
-                tensorrt_llm_llama.layers[idx].mlp, "quantization_scaling_factor", None
-            )
-            set_smoothquant_scale_factors(
-                tensorrt_llm_llama.layers[idx].mlp.proj,
-                proj_scale,
-                dir_path,
-                "model.layers." + str(i) + ".mlp.proj.",
-                [1, n_embd],
-                quant_per_token_dyn,
-                quant_per_channel,
-            )
-            set_smoother(
-                tensorrt_llm_llama.layers[idx].mlp.proj,
+            t = fromfile(
                 dir_path,
-                "model.layers." + str(i) + ".mlp.proj",
-                [1, inter_size // mapping.tp_size],
-                mapping.tp_rank,
-            )
-        elif use_weight_only:
-            dst = tensorrt_llm_llama.layers[i].mlp.proj.weight
-            (
-                processed_torch_weights,
-                torch_weight_scales,
-            ) = torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
-                torch.tensor(t), plugin_weight_only_quant_type
-            )
-            # workaround for trt not supporting int8 inputs in plugins currently
-            dst.value = processed_torch_weights.view(dtype=torch.float32).numpy()
-            scales = tensorrt_llm_llama.layers[i].mlp.proj.per_channel_scale
-            scales.value = torch_weight_scales.numpy()
-        else:
-            tensorrt_llm_llama.layers[idx].mlp.proj.weight.value = np.ascontiguousarray(
-                np.transpose(t, [1, 0])
+                "model.layers." + str(i) + ".mlp.gate.weight." + suffix,
+                [n_embd, inter_size // mapping.tp_size],
+                w_type,
             )
+            if use_smooth_quant:
+                tensorrt_llm_llama.layers[idx].mlp.gate.weight.value = sq_trick(
+                    np.ascontiguousarray(np.transpose(t, [1, 0]))
+                )
+                set_smoothquant_scale_factors(
+                    tensorrt_llm_llama.layers[idx].mlp.gate,
+                    tensorrt_llm_llama.layers[idx].post_layernorm.scale_to_int,
+                    dir_path,
+                    "model.layers." + str(i) + ".mlp.gate.",
+                    [1, inter_size // mapping.tp_size],
+                    quant_per_token_dyn,
+                    quant_per_channel,
+                    rank=mapping.tp_rank,
+                )
+            elif use_weight_only:
+                dst = tensorrt_llm_llama.layers[i].mlp.gate.weight
+                (
+                    processed_torch_weights,
+                    torch_weight_scales,
+                ) = torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
+                    torch.tensor(t), plugin_weight_only_quant_type
+                )
+                # workaround for trt not supporting int8 inputs in plugins currently
+                dst.value = processed_torch_weights.view(dtype=torch.float32).numpy()
+                scales = tensorrt_llm_llama.layers[i].mlp.gate.per_channel_scale
+                scales.value = torch_weight_scales.numpy()
+            else:
+                tensorrt_llm_llama.layers[
+                    idx
+                ].mlp.gate.weight.value = np.ascontiguousarray(np.transpose(t, [1, 0]))
 
-        if use_int8_kv_cache:
             t = fromfile(
                 dir_path,
-                "model.layers."
-                + str(i)
-                + ".attention.query_key_value.scale_y_quant_orig.bin",
-                [1],
-                np.float32,
+                "model.layers." + str(i) + ".mlp.proj.weight." + suffix,
+                [inter_size // mapping.tp_size, n_embd],
+                w_type,
             )
-            tensorrt_llm_llama.layers[idx].attention.kv_orig_quant_scale.value = 1.0 / t
-            tensorrt_llm_llama.layers[idx].attention.kv_quant_orig_scale.value = t
+            if use_smooth_quant:
+                tensorrt_llm_llama.layers[idx].mlp.proj.weight.value = sq_trick(
+                    np.ascontiguousarray(np.transpose(t, [1, 0]))
+                )
+                proj_scale = getattr(
+                    tensorrt_llm_llama.layers[idx].mlp,
+                    "quantization_scaling_factor",
+                    None,
+                )
+                set_smoothquant_scale_factors(
+                    tensorrt_llm_llama.layers[idx].mlp.proj,
+                    proj_scale,
+                    dir_path,
+                    "model.layers." + str(i) + ".mlp.proj.",
+                    [1, n_embd],
+                    quant_per_token_dyn,
+                    quant_per_channel,
+                )
+                set_smoother(
+                    tensorrt_llm_llama.layers[idx].mlp.proj,
+                    dir_path,
+                    "model.layers." + str(i) + ".mlp.proj",
+                    [1, inter_size // mapping.tp_size],
+                    mapping.tp_rank,
+                )
+            elif use_weight_only:
+                dst = tensorrt_llm_llama.layers[i].mlp.proj.weight
+                (
+                    processed_torch_weights,
+                    torch_weight_scales,
+                ) = torch.ops.fastertransformer.symmetric_quantize_last_axis_of_batched_matrix(
+                    torch.tensor(t), plugin_weight_only_quant_type
+                )
+                # workaround for trt not supporting int8 inputs in plugins currently
+                dst.value = processed_torch_weights.view(dtype=torch.float32).numpy()
+                scales = tensorrt_llm_llama.layers[i].mlp.proj.per_channel_scale
+                scales.value = torch_weight_scales.numpy()
+            else:
+                tensorrt_llm_llama.layers[
+                    idx
+                ].mlp.proj.weight.value = np.ascontiguousarray(np.transpose(t, [1, 0]))
+
+            if use_int8_kv_cache:
+                t = fromfile(
+                    dir_path,
+                    "model.layers."
+                    + str(i)
+                    + ".attention.query_key_value.scale_y_quant_orig.bin",
+                    [1],
+                    np.float32,
+                )
+                tensorrt_llm_llama.layers[idx].attention.kv_orig_quant_scale.value = (
+                    1.0 / t
+                )
+                tensorrt_llm_llama.layers[idx].attention.kv_quant_orig_scale.value = t
+    finally:
+        # do not leave whole-file reads queued behind a failed layer
+        prefetcher.shutdown(cancel_futures=True)
 
     tok = time.time()
     t = time.strftime("%H:%M:%S", time.gmtime(tok - tik))
     tensorrt_llm.logger.info(f"Weights loaded. Total time: {t}")
 
 
+@contextlib.contextmanager
+def share_torch_threads(workers):
+    """Give each of the worker threads an equal share of torch's intra-op threads while the block runs."""
+    num_threads = torch.get_num_threads()
+    torch.set_num_threads(max(1, num_threads // workers))
+    try:
+        yield
+    finally:
+        torch.set_num_threads(num_threads)
+
+
+def map_layers(process_layer, layers, workers=1):
+    """Run process_layer on every layer, spreading the layers over a pool of worker threads.
+
+    The per layer work happens in torch kernels that release the GIL, so the layers are converted in parallel. Each
+    worker gets an equal share of torch's intra-op threads to avoid oversubscribing the cores.
+    """
+    layers = list(layers)
+    PROGRESS.expect(len(layers))
+
+    def timed(layer):
+        tik = time.time()
+        process_layer(layer)
+        PROGRESS.advance(layer, time.time() - tik)
+
+    workers = max(1, min(workers, len(layers)))
+    if workers == 1:
+        for layer in layers:
+            timed(layer)
+        return
+
+    with share_torch_threads(workers), ThreadPoolExecutor(max_workers=workers) as pool:
+        # consume the results so that a failing layer raises here
+        for _ in pool.map(timed, layers):
+            pass
+
+
+def pipelined(transform, items, workers=1, depth=None):
+    """Yield transform(item) for every item, in order, while the next items are transformed on worker threads.
+
+    At most depth items, twice the number of workers by default, are transformed ahead of the consumer, which bounds
+    the memory held by finished but not yet consumed results.
+    """
+    if workers <= 1:
+        for item in items:
+            yield transform(item)
+        return
+
+    depth = depth or 2 * workers
+    pending = collections.deque()
+    with share_torch_threads(workers), ThreadPoolExecutor(max_workers=workers) as pool:
+        try:
+            for item in items:
+                pending.append(pool.submit(transform, item))
+                if len(pending) >= depth:
+                    yield pending.popleft().result()
+            while pending:
+                yield pending.popleft().result()
+        finally:
+            # do not transform the rest when the consumer fails or stops early
+            for future in pending:
+                future.cancel()
+
+
+def default_load_workers(world_size=1):
+    """Return how many layers to convert at once when each of world_size processes converts its own rank."""
+    return max(1, min(8, (os.cpu_count() or 1) // max(1, world_size)))
+
+
+def unpack_int32_into_int8(w_packed):
+    # Unpack inputs packed in int32/float32 into uint4 and store them in int8 format
+    w_packed_int4x2 = w_packed.contiguous().view(torch.uint8)
+    w_unpacked = torch.stack((w_packed_int4x2 & 0x0F, w_packed_int4x2 >> 4), dim=-1)
+    return w_unpacked.view(w_packed_int4x2.shape[0], -1).to(torch.int8)
+
+
+def int4_kernels():
+    """Return the TensorRT LLM int4 packing and weight interleaving kernels."""
+    return (
+        torch.ops.fastertransformer.pack_int8_tensor_to_packed_int4,
+        torch.ops.fastertransformer.preprocess_weights_for_mixed_gemm,
+    )
+
+
+def preprocess_groupwise_weight_params(
+    qweight_int32, qzeros_int32, scales_fp16, kernels=None
+):
+    """Convert a GPTQ weight to the interleaved int4 layout, returning the weight, the scales and zeros * scales."""
+    UINT4_TO_INT4_FLAG = 1
+    GPTQ_FLAG = 1
+    packer, preprocessor = kernels or int4_kernels()
+
+    qweight_unpacked_int8 = unpack_int32_into_int8(qweight_int32.T).T.contiguous()
+    qweight_unpacked_int8 -= 8
+    qweight_interleaved = preprocessor(
+        packer(qweight_unpacked_int8), torch.quint4x2
+    ).view(torch.float32)
+    # zeros = zeros * scales
+    qzeros_unpacked_int8 = unpack_int32_into_int8(qzeros_int32)
+    zeros_x_scales_fp16 = (
+        -qzeros_unpacked_int8 + 8 * UINT4_TO_INT4_FLAG - GPTQ_FLAG
+    ) * scales_fp16
+    zeros_x_scales_fp16 = zeros_x_scales_fp16.half()
+
+    # return processed interleaved weight, original scales and zeros * scales
+    return (
+        qweight_interleaved.contiguous(),
+        scales_fp16.contiguous(),
+        zeros_x_scales_fp16.contiguous(),
+    )
+
+
+def awq_quantize(weight, scale, group_size):
+    """Quantize a [k, n] weight with its [k / group_size, n] group scales to int8 values in [-8, 7]."""
+    [k, n] = weight.shape
+    weight = weight.reshape(k // group_size, group_size, n) / scale.unsqueeze(1)
+    return weight.round_().clamp_(-8, 7).to(torch.int8).reshape(k, n)
+
+
+def AWQ_quantize_pack_preprocess(weight, scale, group_size, kernels=None):
+    """Quantize an AWQ weight and convert it to the interleaved int4 layout."""
+    packer, preprocessor = kernels or int4_kernels()
+    int4_weight = packer(awq_quantize(weight, scale, group_size).cpu())
+    int4_weight = preprocessor(int4_weight, torch.quint4x2)
+    return int4_weight.view(torch.float32).cpu().numpy()
+
+
+def reSmooth_and_get_scale(weight, pre_quant_scale, avg_pre_quant_scale, group_size):
+    """Move a [k, n] weight from its own AWQ smoothing scale to a shared one and compute its new group scales."""
+    [k, n] = weight.shape
+    weight = weight * pre_quant_scale.reshape(k, 1) / avg_pre_quant_scale.reshape(k, 1)
+    amax = weight.reshape(k // group_size, group_size, n).abs().amax(dim=1)
+    return weight, amax / 8
+
+
 def load_from_gptq_llama(
-    tensorrt_llm_llama, quant_ckpt_path, mapping=Mapping(), dtype="float16"
+    tensorrt_llm_llama,
+    quant_ckpt_path,
+    mapping=Mapping(),
+    dtype="float16",
+    workers=1,
 ):
     tensorrt_llm.logger.info("Loading weights from groupwise GPTQ LLaMA safetensors...")
     tik = time.time()
 
     if quant_ckpt_path.endswith(".safetensors"):
         groupwise_qweight_safetensors = safe_open(
-            quant_ckpt_path, framework="pt", device=0
+            quant_ckpt_path, framework="pt", device="cpu"
         )
         model_params = {
             key: groupwise_qweight_safetensors.get_tensor(key)
@@ -995,55 +1670,12 @@ def load_from_gptq_llama(
     else:
         assert False, "Quantized checkpoint format not supported!"
 
-    def unpack_int32_into_int8(w_packed):
-        # Unpack inputs packed in int32/float32 into uint4 and store them in int8 format
-        w_packed_int4x2 = w_packed.contiguous().view(torch.uint8)
-        w_unpacked = torch.zeros(
-            w_packed_int4x2.shape[0], w_packed_int4x2.shape[1] * 2, dtype=torch.int8
-        )
-        w_unpacked[:, ::2] = w_packed_int4x2 % 16
-        w_unpacked[:, 1::2] = w_packed_int4x2 // 16
-        return w_unpacked.contiguous()
-
-    def preprocess_groupwise_weight_params(
-        weight_name, qweight_int32=None, qzeros_int32=None, scales_fp16=None
-    ):
-        if weight_name is not None:
-            qweight_int32 = model_params[weight_name].cpu()
-            qzeros_int32 = model_params[weight_name[:-7] + "qzeros"].cpu()
-            scales_fp16 = model_params[weight_name[:-7] + "scales"].cpu()
-
-        UINT4_TO_INT4_FLAG = 1
-        GPTQ_FLAG = 1
-        packer = torch.ops.fastertransformer.pack_int8_tensor_to_packed_int4
-        preprocessor = torch.ops.fastertransformer.preprocess_weights_for_mixed_gemm
-
-        qweight_unpacked_int8 = (
-            unpack_int32_into_int8(qweight_int32.T).T.contiguous() - 8
-        )
-        qweight_interleaved = preprocessor(
-            packer(qweight_unpacked_int8), torch.quint4x2
-        ).view(torch.float32)
-        # zeros = zeros * scales
-        qzeros_unpacked_int32 = unpack_int32_into_int8(qzeros_int32)
-        zeros_x_scales_fp16 = (
-            -qzeros_unpacked_int32 + 8 * UINT4_TO_INT4_FLAG - GPTQ_FLAG
-        ) * scales_fp16
-        zeros_x_scales_fp16 = zeros_x_scales_fp16.half()
-
-        # return processed interleaved weight, original scales and zeros * scales
-        return (
-            qweight_interleaved.contiguous(),
-            scales_fp16.contiguous(),
-            zeros_x_scales_fp16.contiguous(),
-        )
-
-    layer_ids = [extract_layer_idx(key) for key in groupwise_qweight_safetensors.keys()]
+    layer_ids = [extract_layer_idx(key) for key in model_params.keys()]
     layer_ids = [int(layer_idx) for layer_idx in layer_ids if layer_idx is not None]
     num_hidden_layers = max(layer_ids) + 1
-    num_kv_heads = tensorrt_llm_llama.num_kv_heads
-    mha_mode = num_kv_heads == tensorrt_llm_llama.num_heads
     suffixs = ["qweight", "qzeros", "scales"]
+    kernels = int4_kernels()
+    torch_dtype = str_dtype_to_torch(dtype)
 
     layers_per_pipeline_stage = num_hidden_layers // mapping.pp_size
     layers_range = list(
@@ -1054,14 +1686,32 @@ def load_from_gptq_llama(
         )
     )
 
-    for l in layers_range:
-        prefix = f"model.layers.{l}.self_attn."
-        split_qkv_suf = []
+    def assign(mOp, prefix, tp_dim):
+        split_v_suf = []
+        for suf in suffixs:
+            v = model_params[prefix + suf].cpu()
+            split_v = v.split(v.shape[tp_dim] // mapping.tp_size, dim=tp_dim)[
+                mapping.tp_rank
+            ]
+            split_v_suf.append(split_v)
+        th_qweight, th_scale, th_zero = preprocess_groupwise_weight_params(
+            *split_v_suf, kernels=kernels
+        )
+        mOp.qweight.value = th_qweight.numpy()
+        mOp.scale.value = th_scale.numpy()
+        mOp.zero.value = th_zero.numpy()
+
+    def process_layer(l):
+        prefix = f"model.layers.{l}."
+        layer = tensorrt_llm_llama.layers[
+            l - mapping.pp_rank * layers_per_pipeline_stage
+        ]
 
+        split_qkv_suf = []
         for suf in suffixs:
-            q_part = model_params[prefix + "q_proj." + suf].cpu()
-            k_part = model_params[prefix + "k_proj." + suf].cpu()
-            v_part = model_params[prefix + "v_proj." + suf].cpu()
+            q_part = model_params[prefix + "self_attn.q_proj." + suf].cpu()
+            k_part = model_params[prefix + "self_attn.k_proj." + suf].cpu()
+            v_part = model_params[prefix + "self_attn.v_proj." + suf].cpu()
             qkv_part = torch.cat([q_part, k_part, v_part], dim=0)
             dim = qkv_part.shape
             qkv_part = qkv_part.reshape(3, dim[0] // 3, dim[1])
@@ -1078,112 +1728,47 @@ def load_from_gptq_llama(
             )
             split_qkv_suf.append(split_qkv)
 
-        th_qweight, th_zero, th_scale = preprocess_groupwise_weight_params(
-            None, split_qkv_suf[0], split_qkv_suf[1], split_qkv_suf[2]
+        th_qweight, th_scale, th_zero = preprocess_groupwise_weight_params(
+            *split_qkv_suf, kernels=kernels
         )
+        layer.attention.qkv.qweight.value = th_qweight.numpy()
+        layer.attention.qkv.scale.value = th_scale.numpy()
+        layer.attention.qkv.zero.value = th_zero.numpy()
 
-        idx = l - mapping.pp_rank * layers_per_pipeline_stage
-        tensorrt_llm_llama.layers[idx].attention.qkv.qweight.value = th_qweight.numpy()
-        tensorrt_llm_llama.layers[idx].attention.qkv.scale.value = th_zero.numpy()
-        tensorrt_llm_llama.layers[idx].attention.qkv.zero.value = th_scale.numpy()
+        assign(layer.attention.dense, prefix + "self_attn.o_proj.", 0)
+        assign(layer.mlp.gate, prefix + "mlp.up_proj.", 1)
+        assign(layer.mlp.proj, prefix + "mlp.down_proj.", 0)
+        assign(layer.mlp.fc, prefix + "mlp.gate_proj.", 1)
 
-    torch_dtype = str_dtype_to_torch(dtype)
+        layer.input_layernorm.weight.value = torch_to_numpy(
+            model_params[prefix + "input_layernorm.weight"].to(torch_dtype).cpu()
+        )
+        layer.post_layernorm.weight.value = torch_to_numpy(
+            model_params[prefix + "post_attention_layernorm.weight"]
+            .to(torch_dtype)
+            .cpu()
+        )
+
+    map_layers(process_layer, layers_range, workers)
 
+    # only the unquantized weights outside the decoder layers are left
     for k, v in model_params.items():
-        if isinstance(v, list):
-            v = [torch_to_numpy(vv.to(torch_dtype).detach().cpu()) for vv in v]
-        else:
-            v = torch_to_numpy(v.to(torch_dtype).detach().cpu())
         if "model.embed_tokens.weight" in k:
             if mapping.is_first_pp_rank():
-                tensorrt_llm_llama.vocab_embedding.weight.value = v
+                tensorrt_llm_llama.vocab_embedding.weight.value = torch_to_numpy(
+                    v.to(torch_dtype).detach().cpu()
+                )
         elif "model.norm.weight" in k:
             if mapping.is_last_pp_rank():
-                tensorrt_llm_llama.ln_f.weight.value = v
+                tensorrt_llm_llama.ln_f.weight.value = torch_to_numpy(
+                    v.to(torch_dtype).detach().cpu()
+                )
         elif "lm_head.weight" in k:
             if mapping.is_last_pp_rank():
+                v = torch_to_numpy(v.to(torch_dtype).detach().cpu())
                 tensorrt_llm_llama.lm_head.weight.value = np.ascontiguousarray(
                     split(v, mapping.tp_size, mapping.tp_rank)
                 )
-        else:
-            layer_idx = extract_layer_idx(k)
-            if layer_idx is None:
-                continue
-            idx = int(layer_idx)
-            if idx not in layers_range:
-                continue
-            idx = idx - mapping.pp_rank * layers_per_pipeline_stage
-
-            if "input_layernorm.weight" in k:
-                tensorrt_llm_llama.layers[idx].input_layernorm.weight.value = v
-            elif "post_attention_layernorm.weight" in k:
-                tensorrt_llm_llama.layers[idx].post_layernorm.weight.value = v
-            elif "self_attn.o_proj.qweight" in k:
-                split_v_suf = []
-                for suf in suffixs:
-                    v = model_params[k[:-7] + suf].cpu()
-                    split_v = v.split(v.shape[0] // mapping.tp_size, dim=0)[
-                        mapping.tp_rank
-                    ]
-                    split_v_suf.append(split_v)
-                th_qweight, th_zero, th_scale = preprocess_groupwise_weight_params(
-                    None, split_v_suf[0], split_v_suf[1], split_v_suf[2]
-                )
-                tensorrt_llm_llama.layers[
-                    idx
-                ].attention.dense.qweight.value = th_qweight.numpy()
-                tensorrt_llm_llama.layers[
-                    idx
-                ].attention.dense.scale.value = th_zero.numpy()
-                tensorrt_llm_llama.layers[
-                    idx
-                ].attention.dense.zero.value = th_scale.numpy()
-            elif "mlp.up_proj.qweight" in k:
-                split_v_suf = []
-                for suf in suffixs:
-                    v = model_params[k[:-7] + suf].cpu()
-                    split_v = v.split(v.shape[1] // mapping.tp_size, dim=1)[
-                        mapping.tp_rank
-                    ]
-                    split_v_suf.append(split_v)
-                th_qweight, th_zero, th_scale = preprocess_groupwise_weight_params(
-                    None, split_v_suf[0], split_v_suf[1], split_v_suf[2]
-                )
-                tensorrt_llm_llama.layers[
-                    idx
-                ].mlp.gate.qweight.value = th_qweight.numpy()
-                tensorrt_llm_llama.layers[idx].mlp.gate.scale.value = th_zero.numpy()
-                tensorrt_llm_llama.layers[idx].mlp.gate.zero.value = th_scale.numpy()
-            elif "mlp.down_proj.qweight" in k:
-                split_v_suf = []
-                for suf in suffixs:
-                    v = model_params[k[:-7] + suf].cpu()
-                    split_v = v.split(v.shape[0] // mapping.tp_size, dim=0)[
-                        mapping.tp_rank
-                    ]
-                    split_v_suf.append(split_v)
-                th_qweight, th_zero, th_scale = preprocess_groupwise_weight_params(
-                    None, split_v_suf[0], split_v_suf[1], split_v_suf[2]
-                )
-                tensorrt_llm_llama.layers[
-                    idx
-                ].mlp.proj.qweight.value = th_qweight.numpy()
-                tensorrt_llm_llama.layers[idx].mlp.proj.scale.value = th_zero.numpy()
-                tensorrt_llm_llama.layers[idx].mlp.proj.zero.value = th_scale.numpy()
-            elif "mlp.gate_proj.qweight" in k:
-                split_v_suf = []
-                for suf in suffixs:
-                    v = model_params[k[:-7] + suf].cpu()
-                    split_v = v.split(v.shape[1] // mapping.tp_size, dim=1)[
-                        mapping.tp_rank
-                    ]
-                    split_v_suf.append(split_v)
-                th_qweight, th_zero, th_scale = preprocess_groupwise_weight_params(
-                    None, split_v_suf[0], split_v_suf[1], split_v_suf[2]
-                )
-                tensorrt_llm_llama.layers[idx].mlp.fc.qweight.value = th_qweight.numpy()
-                tensorrt_llm_llama.layers[idx].mlp.fc.scale.value = th_zero.numpy()
-                tensorrt_llm_llama.layers[idx].mlp.fc.zero.value = th_scale.numpy()
 
     tok = time.time()
     t = time.strftime("%H:%M:%S", time.gmtime(tok - tik))
@@ -1196,13 +1781,14 @@ def load_from_awq_llama(
     quant_ckpt_path,
     mapping=Mapping(),
     dtype="float16",
+    workers=1,
 ):
     tensorrt_llm.logger.info("Loading weights from groupwise AWQ LLaMA safetensors...")
     tik = time.time()
 
     if quant_ckpt_path.endswith(".safetensors"):
         groupwise_qweight_safetensors = safe_open(
-            quant_ckpt_path, framework="pt", device=0
+            quant_ckpt_path, framework="pt", device="cpu"
         )
         awq_llama = {
             key: groupwise_qweight_safetensors.get_tensor(key)
@@ -1230,17 +1816,15 @@ def load_from_awq_llama(
 
     getattr(tensorrt_llm_llama, "quant_mode", QuantMode(0))
 
-    packer = torch.ops.fastertransformer.pack_int8_tensor_to_packed_int4
-    preprocessor = torch.ops.fastertransformer.preprocess_weights_for_mixed_gemm
+    kernels = int4_kernels()
     torch_dtype = str_dtype_to_torch(dtype)
+    # quantize on the GPU when there is one, the packing kernels run on the CPU
+    device = "cuda" if torch.cuda.is_available() else "cpu"
 
-    def AWQ_quantize_pack_preprocess(weight, scale):
-        scale = scale.repeat_interleave(group_size, dim=0)
-        weight = weight / scale
-        qweight_int8 = torch.clamp(torch.round(weight.cuda()).char(), -8, 7)
-        int4_weight = packer(qweight_int8.cpu())
-        int4_weight = preprocessor(int4_weight, torch.quint4x2)
-        return int4_weight.view(torch.float32).cpu().numpy()
+    def quantize_pack_preprocess(weight, scale):
+        return AWQ_quantize_pack_preprocess(
+            weight.to(device), scale.to(device), group_size, kernels
+        )
 
     def process_and_assign_weight(awq_llama, mPrefix, mOp, tp_dim=0):
         weight = awq_llama[mPrefix + ".weight"].T.contiguous()
@@ -1264,37 +1848,10 @@ def load_from_awq_llama(
                 mapping.tp_rank
             ]
         scale = amax / 8.0
-        mOp.qweight.value = AWQ_quantize_pack_preprocess(weight, scale)
+        mOp.qweight.value = quantize_pack_preprocess(weight, scale)
         mOp.scale.value = scale.to(torch_dtype).cpu().numpy()
         mOp.pre_quant_scale.value = pre_quant_scale.to(torch_dtype).cpu().numpy()
 
-    def deSmooth(weight, pre_quant_scale):
-        [k, n] = weight.shape
-        pre_quant_scale = pre_quant_scale.repeat((n, 1)).transpose(1, 0).contiguous()
-        weight = weight * pre_quant_scale
-        return weight
-
-    def reSmooth(weight, pre_quant_scale):
-        [k, n] = weight.shape
-        pre_quant_scale = pre_quant_scale.repeat((n, 1)).transpose(1, 0).contiguous()
-        weight = weight / pre_quant_scale
-        return weight
-
-    def get_scale(weight):
-        weight = weight.T.contiguous()
-        [n, k] = weight.shape
-        weight = weight.reshape(n, int(k / group_size), group_size)
-        weight = torch.abs(weight.reshape(-1, group_size))
-        amax, idx = weight.max(1)
-        amax = amax.reshape(n, int(k / group_size)).T.contiguous()
-        return amax / 8
-
-    def reSmooth_and_get_scale(weight, pre_quant_scale, avg_pre_quant_scale):
-        weight = deSmooth(weight, pre_quant_scale)
-        weight = reSmooth(weight, avg_pre_quant_scale)
-        scale = get_scale(weight)
-        return weight, scale
-
     def process_and_assign_qkv_weight(awq_llama, prefix, mOp):
         q_weight = awq_llama[prefix + "self_attn.q_proj.weight"].T.contiguous()
         k_weight = awq_llama[prefix + "self_attn.k_proj.weight"].T.contiguous()
@@ -1325,20 +1882,20 @@ def load_from_awq_llama(
             q_pre_quant_scale + k_pre_quant_scale + v_pre_quant_scale
         ) / 3.0
         q_weight, q_scale = reSmooth_and_get_scale(
-            q_weight, q_pre_quant_scale, qkv_pre_quant_scale
+            q_weight, q_pre_quant_scale, qkv_pre_quant_scale, group_size
         )
         k_weight, k_scale = reSmooth_and_get_scale(
-            k_weight, k_pre_quant_scale, qkv_pre_quant_scale
+            k_weight, k_pre_quant_scale, qkv_pre_quant_scale, group_size
         )
         v_weight, v_scale = reSmooth_and_get_scale(
-            v_weight, v_pre_quant_scale, qkv_pre_quant_scale
+            v_weight, v_pre_quant_scale, qkv_pre_quant_scale, group_size
         )
 
         qkv_weights = torch.cat((q_weight, k_weight, v_weight), dim=1)
         qkv_scale = torch.cat((q_scale, k_scale, v_scale), dim=1)
 
         mOp.pre_quant_scale.value = qkv_pre_quant_scale.to(torch_dtype).cpu().numpy()
-        mOp.qweight.value = AWQ_quantize_pack_preprocess(qkv_weights, qkv_scale)
+        mOp.qweight.value = quantize_pack_preprocess(qkv_weights, qkv_scale)
         mOp.scale.value = qkv_scale.to(torch_dtype).cpu().numpy()
 
     # Check if we need to pad vocab
@@ -1371,74 +1928,77 @@ def load_from_awq_llama(
         )
     )
 
-    for layer_idx in layers_range:
+    def process_layer(layer_idx):
         prefix = "model.layers." + str(layer_idx) + "."
         tensorrt_llm.logger.info(f"Process weights in layer: {layer_idx}")
+        decoder_layer = tensorrt_llm_llama.layers[
+            layer_idx - mapping.pp_rank * layers_per_pipeline_stage
+        ]
         for idx, awq_attr in enumerate(awq_llama_block_names):
             v = awq_llama[prefix + awq_attr]
-            layer = attrgetter(tensorrt_llm_llama_block_names[idx])(
-                tensorrt_llm_llama.layers[layer_idx]
-            )
+            layer = attrgetter(tensorrt_llm_llama_block_names[idx])(decoder_layer)
             setattr(layer, "value", v.to(torch_dtype).cpu().numpy())
 
         # Attention QKV Linear
         # concatenate the Q, K, V layers weights.
-        process_and_assign_qkv_weight(
-            awq_llama, prefix, tensorrt_llm_llama.layers[layer_idx].attention.qkv
-        )
+        process_and_assign_qkv_weight(awq_llama, prefix, decoder_layer.attention.qkv)
 
         # Attention Dense (out_proj) Linear
         mPrefix = prefix + "self_attn.o_proj"
-        mOp = tensorrt_llm_llama.layers[layer_idx].attention.dense
+        mOp = decoder_layer.attention.dense
         process_and_assign_weight(awq_llama, mPrefix, mOp, 0)
 
         # MLP up_proj (mlp.gate) Linear
         mPrefix = prefix + "mlp.up_proj"
-        mOp = tensorrt_llm_llama.layers[layer_idx].mlp.gate
+        mOp = decoder_layer.mlp.gate
         process_and_assign_weight(awq_llama, mPrefix, mOp, 1)
 
         # MLP down_proj (mlp.proj) Linear
         mPrefix = prefix + "mlp.down_proj"
-        mOp = tensorrt_llm_llama.layers[layer_idx].mlp.proj
+        mOp = decoder_layer.mlp.proj
         process_and_assign_weight(awq_llama, mPrefix, mOp, 0)
 
         # MLP gate_proj (mlp.fc) Linear
         mPrefix = prefix + "mlp.gate_proj"
-        mOp = tensorrt_llm_llama.layers[layer_idx].mlp.fc
+        mOp = decoder_layer.mlp.fc
         process_and_assign_weight(awq_llama, mPrefix, mOp, 1)
 
+    map_layers(process_layer, layers_range, workers)
+
     v = awq_llama["model.norm.weight"]
     if mapping.is_last_pp_rank():
         tensorrt_llm_llama.ln_f.weight.value = v.to(torch_dtype).cpu().numpy()
 
     # lm_head
-    if pad_vocab:
-        weight = awq_llama["lm_head.weight"]
-        [vocab_size, k] = weight.shape
-        new_weight = torch.zeros([pad_vocab_size, k])
-        new_weight[:vocab_size, :] = weight
-        new_weight = new_weight.T.contiguous()
-        amax = awq_llama["lm_head.weight_quantizer._amax"].reshape(
-            [vocab_size, k // group_size]
-        )
-        new_amax = torch.ones([pad_vocab_size, k // group_size])
-        new_amax[:vocab_size, :] = amax
-        new_amax = new_amax.T.contiguous()
-        new_scale = new_amax / 8
-        tensorrt_llm_llama.lm_head.qweight.value = AWQ_quantize_pack_preprocess(
-            new_weight, new_scale
-        )
-        tensorrt_llm_llama.lm_head.scale.value = new_scale.to(torch_dtype).cpu().numpy()
-        tensorrt_llm_llama.lm_head.pre_quant_scale.value = (
-            awq_llama["lm_head.input_quantizer._pre_quant_scale"]
-            .to(torch_dtype)
-            .cpu()
-            .numpy()
-        )
-    else:
-        mPrefix = "lm_head"
-        mOp = tensorrt_llm_llama.lm_head
-        if mapping.is_last_pp_rank():
+    if mapping.is_last_pp_rank():
+        if pad_vocab:
+            weight = awq_llama["lm_head.weight"]
+            [vocab_size, k] = weight.shape
+            new_weight = torch.zeros([pad_vocab_size, k])
+            new_weight[:vocab_size, :] = weight
+            new_weight = new_weight.T.contiguous()
+            amax = awq_llama["lm_head.weight_quantizer._amax"].reshape(
+                [vocab_size, k // group_size]
+            )
+            new_amax = torch.ones([pad_vocab_size, k // group_size])
+            new_amax[:vocab_size, :] = amax
+            new_amax = new_amax.T.contiguous()
+            new_scale = new_amax / 8
+            tensorrt_llm_llama.lm_head.qweight.value = quantize_pack_preprocess(
+                new_weight, new_scale
+            )
+            tensorrt_llm_llama.lm_head.scale.value = (
+                new_scale.to(torch_dtype).cpu().numpy()
+            )
+            tensorrt_llm_llama.lm_head.pre_quant_scale.value = (
+                awq_llama["lm_head.input_quantizer._pre_quant_scale"]
+                .to(torch_dtype)
+                .cpu()
+                .numpy()
+            )
+        else:
+            mPrefix = "lm_head"
+            mOp = tensorrt_llm_llama.lm_head
             process_and_assign_weight(awq_llama, mPrefix, mOp, 1)
 
     tok = time.time()
@@ -17,11 +17,16 @@
 import argparse
 import logging
 import os
+import typing
 
+from .bundle import EngineBundle, export_bundle
 from .conversion import ConversionOptions, convert
 from .errors import ModelServerException
-from .model import Model, ModelFormats
-from .server import ModelServer
+from .hotswap import EngineUpdates, HotSwapController
+from .model import DEFAULT_MODEL_DIR, Model, ModelFormats
+from .server import ModelServer, replica_devices
+from .source import fetch_model, open_source
+from .timeline import TIMELINE
 
 _LOGGER = logging.getLogger(__name__)
 
@@ -80,23 +85,65 @@ def _should_convert(args: argparse.Namespace, model: "Model") -> bool:
     return model.conversion_is_needed()
 
 
+def _import_bundle(
+    args: argparse.Namespace, model: "Model", opts: ConversionOptions
+) -> bool:
+    """Install the requested engine bundle if it is compatible with this model and server."""
+    if not args.import_bundle or args.force_conversion:
+        return False
+
+    bundle = EngineBundle(args.import_bundle)
+    reason = bundle.incompatibility(model, opts.cache_key_fields())
+    if reason:
+        _LOGGER.warning("Engine bundle %s is not compatible, %s.", bundle.path, reason)
+        return False
+
+    with TIMELINE.phase("bundle_import"):
+        bundle.install(model)
+    return True
+
+
+def _build_devices(args: argparse.Namespace, model: "Model") -> typing.List[str]:
+    """Return the GPUs that no replica serves on, where engines for changed weights can be built."""
+    devices = replica_devices(
+        args.data_parallelism,
+        model.world_size,
+        model.gpu_count,
+        os.environ.get("CUDA_VISIBLE_DEVICES"),
+    )
+    if len(devices) < model.world_size:
+        _LOGGER.warning(
+            "Not watching the model weights, building an engine needs a GPU that does not serve. "
+            + "Use --import-bundle to swap engines built elsewhere."
+        )
+        return []
+    return devices
+
+
 def main(args: argparse.Namespace) -> int:
     """Execute the model server."""
+    if args.metrics_file is not None:
+        TIMELINE.metrics_file = args.metrics_file
+
     # make accomidations for various ML platforms
     azureml_model_dir = os.environ.get("AZUREML_MODEL_DIR")
     if azureml_model_dir:
         _azureml(azureml_model_dir)
 
+    # download the model from remote storage
+    if args.model_source:
+        _LOGGER.info("Fetching the model from %s.", args.model_source)
+        with TIMELINE.phase("model_fetch"):
+            source = open_source(args.model_source, endpoint_url=args.s3_endpoint)
+            fetch_model(source, DEFAULT_MODEL_DIR, workers=args.download_workers)
+
     # load the model directory
     _LOGGER.info("Reading the model directory.")
-    model = Model(model_type=args.type, world_size=args.world_size)
-
-    if model._format == ModelFormats.UNKNOWN:
-        raise ModelServerException(
-            f"""No known model formats detected in the provided MODEL_DIRECTORY.
-            Supported formats are Pytorch(.pth or .pt), Huggingface (.bin) and Onnx (.onnx).
-            Please check if the absolute path provided with the help of environment variable
-            MODEL_DIRECTORY in compose.env file is correct and has been set properly."""
+    with TIMELINE.phase("model_discovery"):
+        model = Model(
+            model_type=args.type,
+            world_size=args.world_size,
+            data_parallelism=args.data_parallelism,
         )
 
     # calculate the default parallism parameters
@@ -114,26 +161,84 @@ def main(args: argparse.Namespace) -> int:
         max_output_length=args.max_output_length,
         tensor_parallelism=args.tensor_parallelism,
         pipline_parallelism=args.pipeline_parallelism,
-        quantization = args.quantization,
+        quantization=args.quantization,
+        presharded_cache=args.presharded_cache,
     )
 
+    if args.hot_swap and model.world_size > 1:
+        raise ModelServerException(
+            "Engine hot swapping requires a world size of 1. Use --data-parallelism to serve on more GPUs."
+        )
+    if args.hot_swap and args.data_parallelism < 2:
+        raise ModelServerException(
+            "Engine hot swapping requires a --data-parallelism of at least 2, "
+            + "so the other replicas serve while one swaps its engine."
+        )
+    has_weights = model.format != ModelFormats.UNKNOWN
+
+    # use a prebuilt engine bundle when one is provided
+    if _import_bundle(args, model, conversion_opts):
+        _LOGGER.info("Using prebuilt engine bundle. Skipping TensorRT Conversion.")
+    else:
+        if model._format == ModelFormats.UNKNOWN:
+            raise ModelServerException(
+                f"""No known model formats detected in the provided MODEL_DIRECTORY.
+                Supported formats are Pytorch(.pth or .pt), Huggingface (.bin or .safetensors) and Onnx (.onnx).
+                Please check if the absolute path provided with the help of environment variable
+                MODEL_DIRECTORY in compose.env file is correct and has been set properly."""
+            )
+
+        # find the cached engine for these options
+        with TIMELINE.phase("engine_select"):
+            model.select_engine(conversion_opts.cache_key_fields())
+
+        # convert model
+        if _should_convert(args, model):
+            _LOGGER.info("Starting TensorRT Conversion.")
+            convert(model, conversion_opts)
+        else:
+            _LOGGER.info("TensorRT Conversion not required. Skipping.")
+
     # print discovered model parameters
     _LOGGER.info("Model file format: %s", model.format.name)
     _LOGGER.info("World Size: %d", model.world_size)
     _LOGGER.info("Compute Capability: %s", model.compute_cap)
     _LOGGER.info("Quantization: %s", conversion_opts.quantization)
+    _LOGGER.info("Engine Directory: %s", model.engine_dir)
 
-    # convert model
-    if _should_convert(args, model):
-        _LOGGER.info("Starting TensorRT Conversion.")
-        convert(model, conversion_opts)
-    else:
-        _LOGGER.info("TensorRT Conversion not required. Skipping.")
+    if args.engine_cache_budget:
+        model.engine_cache.evict(
+            int(args.engine_cache_budget * 1024**3), keep=[model.engine_dir]
+        )
+
+    inference_server = ModelServer(
+        model,
+        args.http,
+        data_parallelism=args.data_parallelism,
+        explicit_model_control=args.hot_swap,
+        extra_models=args.extra_model,
+    )
+
+    # package the engine for other nodes
+    if args.export_bundle:
+        with TIMELINE.phase("bundle_export"):
+            export_bundle(
+                model, inference_server.tokenizer_model_dir, args.export_bundle
+            )
 
     # host model
     if not args.no_hosting:
+        if args.hot_swap:
+            updates = EngineUpdates(
+                model,
+                conversion_opts,
+                bundle_path=args.import_bundle,
+                build_devices=_build_devices(args, model) if has_weights else [],
+            )
+            HotSwapController(
+                inference_server, model, updates, interval=args.hot_swap_interval
+            ).start()
         _LOGGER.info("Starting Triton Inference Server.")
-        inference_server = ModelServer(model, args.http)
         return inference_server.run()
 
     return 0
@@ -22,14 +22,24 @@ import sys
 from . import main
 from .errors import ModelServerException
 from .model import ModelTypes
+from .repository import ModelSpec
 
 TERMINATION_LOG = "/dev/termination-log"
+DEFAULT_ENGINE_CACHE_BUDGET = 100.0
 
 _LOG_FMT = f"[{os.getpid()}] %(asctime)15s [%(levelname)7s] - %(name)s - %(message)s"
 _LOG_DATE_FMT = "%b %d %H:%M:%S"
 _LOGGER = logging.getLogger("main")
 
 
+def _model_spec(spec: str) -> ModelSpec:
+    """Parse an auxiliary model spec from the command line."""
+    try:
+        return ModelSpec.parse(spec)
+    except ModelServerException as err:
+        raise argparse.ArgumentTypeError(str(err)) from err
+
+
 def parse_args() -> argparse.Namespace:
     """Parse the comamnd line arguments."""
     parser = argparse.ArgumentParser(
@@ -57,6 +67,60 @@ def parse_args() -> argparse.Namespace:
         action="store_true",
         help="Skip the conversion. If no engine is available in the cache, an error will be raised.",
     )
+    parser.add_argument(
+        "--engine-cache-budget",
+        type=float,
+        default=float(
+            os.environ.get("ENGINE_CACHE_BUDGET", DEFAULT_ENGINE_CACHE_BUDGET)
+        ),
+        help="The disk space, in GiB, that cached TensorRT engines and pre-sharded weights may use. "
+        + "Least recently used entries are evicted beyond this budget, the engine in use is always kept. "
+        + f"0 disables eviction. (default: $ENGINE_CACHE_BUDGET or {DEFAULT_ENGINE_CACHE_BUDGET:g})",
+    )
+    parser.add_argument(
+        "--presharded-cache",
+        action="store_true",
+        default=os.environ.get("PRESHARDED_CACHE", "") not in ("", "0"),
+        help="Save each rank's converted weights in the engine cache, so a later conversion with the same "
+        + "weights, parallelism and quantization skips reading the checkpoint. This costs about as much "
+        + "disk space as the model, on top of the engines. (default: $PRESHARDED_CACHE or off)",
+    )
+    parser.add_argument(
+        "--model-source",
+        type=str,
+        default=os.environ.get("MODEL_SOURCE"),
+        metavar="URL",
+        help="Download the model from an s3:// prefix or from an http(s):// JSON file listing "
+        + "instead of expecting it to be mounted. Downloads are cached in the model directory.",
+    )
+    parser.add_argument(
+        "--s3-endpoint",
+        type=str,
+        default=None,
+        metavar="URL",
+        help="The endpoint of an S3 compatible object store, such as MinIO. (default: $AWS_ENDPOINT_URL)",
+    )
+    parser.add_argument(
+        "--download-workers",
+        type=int,
+        default=16,
+        help="The number of ranged reads to run in parallel when downloading the model. (default: 16)",
+    )
+    parser.add_argument(
+        "--export-bundle",
+        type=str,
+        default=None,
+        metavar="PATH",
+        help="Package the TensorRT engine and tokenizer into a portable bundle at PATH.",
+    )
+    parser.add_argument(
+        "--import-bundle",
+        type=str,
+        default=None,
+        metavar="PATH",
+        help="Use the prebuilt engine bundle at PATH instead of converting the model, "
+        + "if it is compatible with this server. The model weights are not required.",
+    )
     parser.add_argument(
         "--no-hosting",
         action="store_true",
@@ -102,6 +166,13 @@ def parse_args() -> argparse.Namespace:
         default=1,
         help="number of pipeline parallism divisions (default: 1)",
     )
+    parser.add_argument(
+        "--data-parallelism",
+        type=int,
+        default=1,
+        help="number of independent model replicas, each on its own world_size GPUs and "
+        + "behind a built-in load balancer (default: 1)",
+    )
 
     parser.add_argument(
         "--quantization",
@@ -110,7 +181,39 @@ def parse_args() -> argparse.Namespace:
         help="Quantization type to be used for LLMs",
     )
 
+    parser.add_argument(
+        "--hot-swap",
+        action="store_true",
+        help="Run Triton with explicit model control and swap in new engines without a restart "
+        + "when the model weights or the --import-bundle file change, or when SIGHUP is received. "
+        + "Requires --data-parallelism of at least 2, replicas are drained and swapped one at a time.",
+    )
+    parser.add_argument(
+        "--hot-swap-interval",
+        type=float,
+        default=60.0,
+        help="How often, in seconds, to look for a new engine in hot swap mode. (default: 60)",
+    )
+    parser.add_argument(
+        "--metrics-file",
+        type=str,
+        default=None,
+        metavar="PATH",
+        help="Where to write the startup timeline metrics in the Prometheus text format. "
+        + "An empty string disables the file. (default: $MODEL_SERVER_METRICS_FILE or /tmp/model_server_startup.prom)",
+    )
+
     # server customization
+    parser.add_argument(
+        "--extra-model",
+        type=_model_spec,
+        action="append",
+        default=[],
+        metavar="SPEC",
+        help="Host an additional Triton model, such as an embedding or reranking model, next to the LLM. "
+        + "SPEC is name=NAME,path=DIR,gpus=0:1,instances=N where only path is required. "
+        + "gpus may be cpu. By default, one instance shares GPU 0 with the LLM. May be repeated.",
+    )
     parser.add_argument(
         "--http",
         action="store_true",
@@ -0,0 +1,140 @@
+# SPDX-FileCopyrightText: Copyright (c) 2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""A lightweight TCP load balancer that spreads client connections across Triton replicas.
+
+Balancing happens per connection, so it works for HTTP and for long lived gRPC streams alike. New connections go to
+the backend with the fewest open connections. Only backends marked available get new connections, and backends that
+refuse connections are skipped.
+"""
+import asyncio
+import itertools
+import logging
+import threading
+import typing
+
+_BUFFER_SIZE = 64 * 1024
+_LOGGER = logging.getLogger(__name__)
+
+Address = typing.Tuple[str, int]
+
+
+class LoadBalancer:
+    """Forward connections from one listening port to the least loaded of several backends."""
+
+    def __init__(self, listen: Address, backends: typing.Sequence[Address]) -> None:
+        """Initialize the load balancer."""
+        self._listen = listen
+        self._backends = list(backends)
+        self._open = {backend: 0 for backend in self._backends}
+        self._available: typing.FrozenSet[Address] = frozenset()
+        self._tie_breaker = itertools.count()
+
+    @property
+    def open_connections(self) -> typing.Dict[Address, int]:
+        """Return the number of open connections to each backend."""
+        return dict(self._open)
+
+    def open_connections_to(self, index: int) -> int:
+        """Return the number of open connections to the backend at index."""
+        return self._open[self._backends[index]]
+
+    def set_available(self, index: int, available: bool) -> None:
+        """Start or stop sending new connections to the backend at index.
+
+        Open connections are left alone. This may be called from any thread.
+        """
+        backend = self._backends[index]
+        if available:
+            self._available = self._available | {backend}
+        else:
+            self._available = self._available - {backend}
+
+    def _ranked_backends(self) -> typing.List[Address]:
+        """Return the available backends from least to most loaded, rotating between equally loaded backends."""
+        offset = next(self._tie_breaker)
+        count = len(self._backends)
+        rotated = [self._backends[(offset + idx) % count] for idx in range(count)]
+        available = [backend for backend in rotated if backend in self._available]
+        return sorted(available, key=lambda backend: self._open[backend])
+
+    @staticmethod
+    async def _pipe(reader: asyncio.StreamReader, writer: asyncio.StreamWriter) -> None:
+        """Copy bytes from a reader to a writer until the reader is closed."""
+        try:
+            while True:
+                data = await reader.read(_BUFFER_SIZE)
+                if not data:
+                    break
+                writer.write(data)
+                await writer.drain()
+        except (ConnectionError, asyncio.CancelledError):
+            pass
+        finally:
+            if writer.can_write_eof():
+                try:
+                    writer.write_eof()
+                except OSError:
+                    pass
+
+    async def _handle(
+        self, client_reader: asyncio.StreamReader, client_writer: asyncio.StreamWriter
+    ) -> None:
+        """Connect a client to a backend and proxy the traffic in both directions."""
+        for backend in self._ranked_backends():
+            try:
+                backend_reader, backend_writer = await asyncio.open_connection(*backend)
+            except OSError:
+                _LOGGER.debug("Backend %s:%d refused a connection.", *backend)
+                continue
+            break
+        else:
+            client_writer.close()
+            return
+
+        self._open[backend] += 1
+        try:
+            await asyncio.gather(
+                self._pipe(client_reader, backend_writer),
+                self._pipe(backend_reader, client_writer),
+            )
+        finally:
+            self._open[backend] -= 1
+            backend_writer.close()
+            client_writer.close()
+
+    async def serve(self) -> None:
+        """Accept and proxy connections forever."""
+        server = await asyncio.start_server(self._handle, *self._listen)
+        _LOGGER.info(
+            "Load balancing %s:%d across %s.",
+            *self._listen,
+            ", ".join(f"{host}:{port}" for host, port in self._backends),
+        )
+        async with server:
+            await server.serve_forever()
+
+
+def start_balancers(balancers: typing.Sequence[LoadBalancer]) -> threading.Thread:
+    """Run the load balancers on an event loop in a background thread."""
+
+    async def _serve_all() -> None:
+        await asyncio.gather(*(balancer.serve() for balancer in balancers))
+
+    thread = threading.Thread(
+        target=asyncio.run, args=(_serve_all(),), name="load-balancer", daemon=True
+    )
+    thread.start()
+    return thread
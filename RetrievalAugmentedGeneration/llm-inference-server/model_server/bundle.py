@@ -0,0 +1,160 @@
+# SPDX-FileCopyrightText: Copyright (c) 2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""This module contains the logic for exporting and importing prebuilt engine bundles.
+
+A bundle is an uncompressed tar archive that mirrors the layout of an engine cache directory. It holds the engine
+files, the tokenizer files in tokenizer/, and a compatibility manifest that is always the first member of the
+archive. The Triton model repository is not included, the importing server renders it for its own paths.
+"""
+import glob
+import json
+import logging
+import os
+import tarfile
+import tempfile
+import time
+import typing
+
+from .cache import toolkit_versions
+from .errors import ModelServerException
+from .model import Model, ModelFormats
+
+BUNDLE_VERSION = 1
+MANIFEST_NAME = "bundle-manifest.json"
+TOKENIZER_DIR = "tokenizer"
+_TOKENIZER_PATTERNS = ["tokenizer*", "special_tokens_map.json", "*.tiktoken"]
+_SKIPPED_ENGINE_FILES = ["hash", "last-used", TOKENIZER_DIR]
+_LOGGER = logging.getLogger(__name__)
+
+
+def export_bundle(model: Model, tokenizer_dir: str, bundle_path: str) -> None:
+    """Package the model's selected engine and tokenizer into a bundle."""
+    key_path = os.path.join(model.engine_dir, "cache-key.json")
+    with open(key_path, "r", encoding="UTF-8") as key_file:
+        key = json.load(key_file)
+    manifest = {
+        "version": BUNDLE_VERSION,
+        "created": time.time(),
+        "model_format": model.format.name,
+        "key": key,
+    }
+
+    _LOGGER.info("Exporting engine bundle to %s.", bundle_path)
+    tmp_path = f"{bundle_path}.{os.getpid()}.tmp"
+    with tarfile.open(tmp_path, "w") as archive:
+        with tempfile.NamedTemporaryFile("w", encoding="UTF-8") as manifest_file:
+            json.dump(manifest, manifest_file, indent=2, sort_keys=True)
+            manifest_file.flush()
+            archive.add(manifest_file.name, arcname=MANIFEST_NAME)
+
+        for name in sorted(os.listdir(model.engine_dir)):
+            if name not in _SKIPPED_ENGINE_FILES:
+                archive.add(os.path.join(model.engine_dir, name), arcname=name)
+
+        for pattern in _TOKENIZER_PATTERNS:
+            for path in sorted(glob.glob(os.path.join(tokenizer_dir, pattern))):
+                archive.add(
+                    path, arcname=os.path.join(TOKENIZER_DIR, os.path.basename(path))
+                )
+    os.replace(tmp_path, bundle_path)
+
+
+class EngineBundle:
+    """A prebuilt engine bundle on disk."""
+
+    def __init__(self, path: str) -> None:
+        """Initialize the bundle by reading its manifest."""
+        self._path = path
+        self._manifest = self._read_manifest(path)
+
+    @staticmethod
+    def _read_manifest(path: str) -> typing.Dict[str, typing.Any]:
+        """Read the manifest from the head of the archive without scanning the rest of it."""
+        try:
+            with tarfile.open(path, "r|") as archive:
+                member = archive.next()
+                if member is None or member.name != MANIFEST_NAME:
+                    raise ModelServerException(
+                        f"{path} is not an engine bundle. No manifest was found."
+                    )
+                manifest_file = typing.cast(typing.IO[bytes], archive.extractfile(member))
+                manifest = json.load(manifest_file)
+        except (OSError, tarfile.TarError) as err:
+            raise ModelServerException(f"Unable to read engine bundle {path}.") from err
+
+        if manifest.get("version") != BUNDLE_VERSION:
+            raise ModelServerException(
+                f"Engine bundle {path} has unsupported version {manifest.get('version')}."
+            )
+        return typing.cast(typing.Dict[str, typing.Any], manifest)
+
+    @property
+    def path(self) -> str:
+        """Return the path to the bundle archive."""
+        return self._path
+
+    @property
+    def model_format(self) -> ModelFormats:
+        """Return the format of the model the bundle was built from."""
+        return ModelFormats[self._manifest["model_format"]]
+
+    def incompatibility(
+        self,
+        model: Model,
+        build_options: typing.Optional[typing.Dict[str, typing.Any]],
+    ) -> typing.Optional[str]:
+        """Return the reason the bundle cannot be used for this model, or None when it can.
+
+        When build_options is None, bundles built with any conversion options are accepted.
+        """
+        key = self._manifest["key"]
+        expected = {
+            "model_type": model.type.name,
+            "world_size": model.world_size,
+            "compute_cap": model.compute_cap,
+            "toolkit": toolkit_versions(),
+        }
+        if build_options is not None:
+            expected["build_options"] = build_options
+        for field, value in expected.items():
+            if key.get(field) != value:
+                return f"{field} is {key.get(field)} in the bundle but {value} is required"
+
+        # when the weights are present, make sure the bundle was built from them
+        if model.format != ModelFormats.UNKNOWN and key.get("model_hash") != model.hash:
+            return "the bundle was built from a different checkpoint"
+        return None
+
+    def install(self, model: Model) -> None:
+        """Extract the bundle into the engine cache and select it for the model."""
+        key = self._manifest["key"]
+        engine_dir = model.engine_cache.entry(key)
+        hash_path = os.path.join(engine_dir, "hash")
+
+        if not os.path.isfile(hash_path):
+            _LOGGER.info("Extracting engine bundle %s to %s.", self._path, engine_dir)
+            with tarfile.open(self._path, "r") as archive:
+                members = [m for m in archive.getmembers() if m.name != MANIFEST_NAME]
+                if hasattr(tarfile, "data_filter"):
+                    archive.extractall(engine_dir, members=members, filter="data")
+                else:
+                    archive.extractall(engine_dir, members=members)  # nosec
+            with open(hash_path, "w", encoding="ASCII") as hash_file:
+                hash_file.write(key["model_hash"])
+        else:
+            _LOGGER.info("Engine bundle is already installed at %s.", engine_dir)
+
+        model.adopt_engine(engine_dir, self.model_format)
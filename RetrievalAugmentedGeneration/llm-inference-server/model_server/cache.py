@@ -0,0 +1,134 @@
+# SPDX-FileCopyrightText: Copyright (c) 2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""This module contains the content-addressed cache of TensorRT engines."""
+import hashlib
+import json
+import logging
+import os
+import pathlib
+import shutil
+import time
+import typing
+from importlib import metadata
+
+ENGINE_DIR_PREFIX = "trt-"
+TOOLKIT_PACKAGES = ["tensorrt_llm", "tensorrt", "nemo_toolkit"]
+_KEY_FILE = "cache-key.json"
+_LAST_USED_FILE = "last-used"
+_LOGGER = logging.getLogger(__name__)
+
+
+def toolkit_versions() -> typing.Dict[str, str]:
+    """Return the installed versions of the packages that produce TensorRT engines."""
+    versions = {}
+    for package in TOOLKIT_PACKAGES:
+        try:
+            versions[package] = metadata.version(package)
+        except metadata.PackageNotFoundError:
+            versions[package] = "none"
+    return versions
+
+
+def cache_key(fields: typing.Dict[str, typing.Any]) -> str:
+    """Create a stable digest from the fields that identify an engine."""
+    serialized = json.dumps(fields, sort_keys=True, default=str)
+    return hashlib.sha1(serialized.encode("UTF-8"), usedforsecurity=False).hexdigest()
+
+
+def _dir_size(dir_path: str) -> int:
+    """Return the total size, in bytes, of the files in a directory tree."""
+    total = 0
+    for root, _, files in os.walk(dir_path):
+        for name in files:
+            try:
+                total += os.path.getsize(os.path.join(root, name))
+            except OSError:
+                pass
+    return total
+
+
+class EngineCache:
+    """A directory of TensorRT engines, keyed by everything that affects the built engine."""
+
+    def __init__(self, root: str) -> None:
+        """Initialize the engine cache."""
+        self._root = root
+
+    @property
+    def root(self) -> str:
+        """Return the directory containing the cached engines."""
+        return self._root
+
+    def entry(self, fields: typing.Dict[str, typing.Any]) -> str:
+        """Create and return the engine directory for the given key fields, marking it as recently used."""
+        key = cache_key(fields)
+        path = os.path.join(self._root, f"{ENGINE_DIR_PREFIX}{key[:16]}")
+        pathlib.Path(path).mkdir(parents=True, exist_ok=True)
+
+        key_path = os.path.join(path, _KEY_FILE)
+        if not os.path.isfile(key_path):
+            with open(key_path, "w", encoding="UTF-8") as key_file:
+                json.dump(fields, key_file, indent=2, sort_keys=True, default=str)
+
+        self.touch(path)
+        return path
+
+    @staticmethod
+    def touch(path: str) -> None:
+        """Record that an engine directory has just been used."""
+        with open(os.path.join(path, _LAST_USED_FILE), "w", encoding="ASCII") as marker:
+            marker.write(str(time.time()))
+
+    @staticmethod
+    def _last_used(path: str) -> float:
+        """Return when an engine directory was last used."""
+        try:
+            with open(
+                os.path.join(path, _LAST_USED_FILE), "r", encoding="ASCII"
+            ) as marker:
+                return float(marker.read())
+        except (OSError, ValueError):
+            return os.path.getmtime(path)
+
+    def entries(self) -> typing.List[str]:
+        """Return the cached engine directories, least recently used first."""
+        paths = [
+            os.path.join(self._root, name)
+            for name in os.listdir(self._root)
+            if name.startswith(ENGINE_DIR_PREFIX)
+            and os.path.isdir(os.path.join(self._root, name))
+        ]
+        return sorted(paths, key=self._last_used)
+
+    def evict(self, budget_bytes: int, keep: typing.Sequence[str] = ()) -> None:
+        """Remove least recently used engines until the cache fits within the disk budget."""
+        sizes = {path: _dir_size(path) for path in self.entries()}
+        total = sum(sizes.values())
+        for path, size in sizes.items():
+            if total <= budget_bytes:
+                break
+            if path in keep:
+                continue
+            _LOGGER.info("Evicting cached engine %s (%d bytes).", path, size)
+            shutil.rmtree(path, ignore_errors=True)
+            total -= size
+
+        if total > budget_bytes:
+            _LOGGER.warning(
+                "Engine cache uses %d bytes, which exceeds the budget of %d bytes.",
+                total,
+                budget_bytes,
+            )
@@ -14,11 +14,12 @@
 # limitations under the License.
 
 """This module contains the logic for doing model conversions to TensorRT."""
-from dataclasses import dataclass
-from typing import Optional
+from dataclasses import asdict, dataclass
+from typing import Any, Dict, Optional
 
 from ..errors import ModelServerException
 from ..model import Model, ModelFormats, ModelTypes
+from ..timeline import TIMELINE
 
 
 @dataclass
@@ -31,6 +32,16 @@ class ConversionOptions:
     tensor_parallelism: int
     vocab_size: Optional[int] = None
     quantization: Optional[str] = ""
+    presharded_cache: bool = False
+
+    def cache_key_fields(self) -> Dict[str, Any]:
+        """Return the options that affect the built engine and therefore key the engine cache."""
+        fields = asdict(self)
+        # the vocab size is derived from the model type, which is already part of the key
+        fields.pop("vocab_size")
+        # saving the pre-sharded weights does not change the engine
+        fields.pop("presharded_cache")
+        return fields
 
 
 def convert(model: Model, opts: ConversionOptions) -> None:
@@ -45,6 +56,13 @@ def convert(model: Model, opts: ConversionOptions) -> None:
     | GPTNEXT  |    ✅   |    ❌    |    ❌   |    ❌   |    ❌   |
     +----------+---------+---------+---------+---------+---------+
     """
+    with TIMELINE.phase("conversion"):
+        _convert(model, opts)
+    model.write_hash()
+
+
+def _convert(model: Model, opts: ConversionOptions) -> None:
+    """Run the converter for the model's type and format."""
     if model.format == ModelFormats.NEMO:
         # pylint: disable-next=import-outside-toplevel  # preventing circular imports
         from . import nemo
@@ -70,5 +88,3 @@ def convert(model: Model, opts: ConversionOptions) -> None:
         raise ModelServerException(
             f"Unsupported model type. Conversion is supported for the following types: {supported_types}"
         )
-
-    model.write_hash()
@@ -20,8 +20,10 @@ import subprocess
 import sys
 import typing
 
+from ..cache import toolkit_versions
 from ..errors import ModelServerException, UnsupportedFormatException
 from ..model import Model
+from ..progress import ProgressMonitor, progress_dir
 from . import ConversionOptions
 
 _CONVERSION_SCRIPTS = "/opt/conversion_scripts/llama"
@@ -38,6 +40,21 @@ def find_pt_file(directory):
                 return os.path.join(root, file)
     return None
 
+def _presharded_dir(model: Model, opts: ConversionOptions) -> str:
+    """Return the cache directory for the pre-sharded weights, which only depend on the weights and how they are split."""
+    return model.engine_cache.entry(
+        {
+            "presharded_weights": model.hash,
+            "model_type": model.type.name,
+            "model_format": model.format.name,
+            "world_size": model.world_size,
+            "tensor_parallelism": opts.tensor_parallelism,
+            "pipeline_parallelism": opts.pipline_parallelism,
+            "quantization": opts.quantization,
+            "toolkit": toolkit_versions(),
+        }
+    )
+
 def convert(model: Model, opts: ConversionOptions) -> None:
     """Convert a llama model."""
     _LOGGER.debug("Running Llama model conversion.")
@@ -76,8 +93,14 @@ def convert(model: Model, opts: ConversionOptions) -> None:
             str(opts.pipline_parallelism),
             "--vocab_size",
             str(opts.vocab_size),
+            "--progress_dir",
+            progress_dir(),
         ]
 
+        # the pre-sharded weights are a full copy of the model, only keep them when asked to
+        if opts.presharded_cache:
+            raw_args.extend(["--presharded_dir", _presharded_dir(model, opts)])
+
         if opts.quantization == "int4_awq" and model.format.name == "PYTORCH":
             ckpt_dir = find_pt_file(model.model_dir)
             raw_args.extend([
@@ -109,7 +132,7 @@ def convert(model: Model, opts: ConversionOptions) -> None:
         "Starting Llama exporter with the command: %s", " ".join(exe + raw_args)
     )
     _LOGGER.debug("Starting Llama exporter with the env vars: %s", repr(env))
-    with subprocess.Popen(exe + raw_args, env=env, cwd=cwd) as proc:
+    with ProgressMonitor(progress_dir()), subprocess.Popen(exe + raw_args, env=env, cwd=cwd) as proc:
         try:
             retcode = proc.wait()
         except KeyboardInterrupt:
@@ -0,0 +1,192 @@
+# SPDX-FileCopyrightText: Copyright (c) 2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""This module contains the logic for quickly fingerprinting a model directory.
+
+Every file in the directory tree is recorded in a manifest along with its size, mtime, and inode and a hash of a
+few sampled chunks. On later runs, files whose metadata and sampled chunks are unchanged reuse the digest stored in the
+manifest. Only new or modified files are hashed in full.
+"""
+import hashlib
+import json
+import logging
+import os
+import typing
+from concurrent.futures import ThreadPoolExecutor
+
+try:
+    import xxhash
+
+    def _new_hasher() -> typing.Any:
+        """Return a new streaming hasher."""
+        return xxhash.xxh3_128()
+
+    HASH_ALGORITHM = "xxh3_128"
+except ImportError:  # pragma: no cover
+
+    def _new_hasher() -> typing.Any:
+        """Return a new streaming hasher."""
+        return hashlib.blake2b(digest_size=16)
+
+    HASH_ALGORITHM = "blake2b-128"
+
+MANIFEST_FILE = ".model-manifest.json"
+MANIFEST_VERSION = 1
+_READ_BLOCK_SIZE = 8 * 1024 * 1024
+_SAMPLE_SIZE = 1024 * 1024
+_SAMPLE_COUNT = 8
+_MAX_IO_WORKERS = 8
+_LOGGER = logging.getLogger(__name__)
+
+FileEntry = typing.Dict[str, typing.Union[str, int]]
+
+
+def _sample_offsets(size: int) -> typing.List[int]:
+    """Return the offsets of the chunks that are sampled from a file of the given size."""
+    if size <= _SAMPLE_SIZE * _SAMPLE_COUNT:
+        return [0]
+    stride = (size - _SAMPLE_SIZE) // (_SAMPLE_COUNT - 1)
+    return [idx * stride for idx in range(_SAMPLE_COUNT)]
+
+
+def _sample_hash(path: str, size: int) -> str:
+    """Hash a handful of evenly spaced chunks of a file."""
+    hasher = _new_hasher()
+    hasher.update(str(size).encode("ASCII"))
+    with open(path, "rb") as in_file:
+        for offset in _sample_offsets(size):
+            in_file.seek(offset)
+            hasher.update(in_file.read(_SAMPLE_SIZE))
+    return typing.cast(str, hasher.hexdigest())
+
+
+def _full_hash(path: str) -> str:
+    """Hash the entire contents of a file."""
+    hasher = _new_hasher()
+    with open(path, "rb") as in_file:
+        while True:
+            block = in_file.read(_READ_BLOCK_SIZE)
+            if not block:
+                break
+            hasher.update(block)
+    return typing.cast(str, hasher.hexdigest())
+
+
+def _walk(
+    dir_path: str, exclude_prefixes: typing.Sequence[str]
+) -> typing.Dict[str, os.stat_result]:
+    """Recursively list the files in a directory, skipping hidden and excluded entries."""
+    found = {}
+    for root, dirs, files in os.walk(dir_path, followlinks=True):
+        dirs[:] = sorted(
+            d
+            for d in dirs
+            if not d.startswith(".")
+            and not (root == dir_path and d.startswith(tuple(exclude_prefixes)))
+        )
+        for name in files:
+            if name.startswith("."):
+                continue
+            path = os.path.join(root, name)
+            try:
+                found[os.path.relpath(path, dir_path)] = os.stat(path)
+            except FileNotFoundError:
+                _LOGGER.debug("Skipping dangling file %s", path)
+    return found
+
+
+def _fingerprint_file(
+    path: str, stat: os.stat_result, known: typing.Optional[FileEntry]
+) -> FileEntry:
+    """Create the manifest entry for a single file, reusing the known entry when possible."""
+    entry: FileEntry = {
+        "size": stat.st_size,
+        "mtime_ns": stat.st_mtime_ns,
+        "inode": stat.st_ino,
+        "sample": _sample_hash(path, stat.st_size),
+    }
+
+    if known and all(known.get(key) == entry[key] for key in entry):
+        entry["digest"] = known["digest"]
+    else:
+        _LOGGER.debug("File metadata changed, hashing in full: %s", path)
+        entry["digest"] = _full_hash(path)
+    return entry
+
+
+def _read_manifest(manifest_path: str) -> typing.Dict[str, FileEntry]:
+    """Read the last known manifest, ignoring it when it is missing or incompatible."""
+    try:
+        with open(manifest_path, "r", encoding="UTF-8") as manifest_file:
+            manifest = json.load(manifest_file)
+    except (OSError, ValueError):
+        return {}
+    if (
+        manifest.get("version") != MANIFEST_VERSION
+        or manifest.get("algorithm") != HASH_ALGORITHM
+    ):
+        return {}
+    return typing.cast(typing.Dict[str, FileEntry], manifest.get("files", {}))
+
+
+def _write_manifest(manifest_path: str, files: typing.Dict[str, FileEntry]) -> None:
+    """Atomically write the manifest, tolerating read-only model directories."""
+    manifest = {"version": MANIFEST_VERSION, "algorithm": HASH_ALGORITHM, "files": files}
+    tmp_path = f"{manifest_path}.{os.getpid()}.tmp"
+    try:
+        with open(tmp_path, "w", encoding="UTF-8") as manifest_file:
+            json.dump(manifest, manifest_file, indent=1, sort_keys=True)
+        os.replace(tmp_path, manifest_path)
+    except OSError as err:
+        _LOGGER.debug("Unable to write the model manifest: %s", err)
+
+
+def fingerprint_dir(
+    dir_path: str,
+    exclude_prefixes: typing.Sequence[str] = (),
+    max_workers: typing.Optional[int] = None,
+) -> str:
+    """
+    Create a fingerprint of every file in a directory tree.
+
+    This hash IS NOT cryptographically secure, but it is designed to be computed as quickly as reasonably possible.
+    Top level directories starting with any of the exclude_prefixes are skipped, as are hidden files and directories.
+    At most max_workers files are read concurrently.
+    """
+    manifest_path = os.path.join(dir_path, MANIFEST_FILE)
+    known = _read_manifest(manifest_path)
+    found = _walk(dir_path, exclude_prefixes)
+    workers = max_workers or min(_MAX_IO_WORKERS, (os.cpu_count() or 1))
+
+    with ThreadPoolExecutor(max_workers=workers) as pool:
+        futures = {
+            rel_path: pool.submit(
+                _fingerprint_file,
+                os.path.join(dir_path, rel_path),
+                stat,
+                known.get(rel_path),
+            )
+            for rel_path, stat in found.items()
+        }
+        files = {rel_path: future.result() for rel_path, future in futures.items()}
+
+    if files != known:
+        _write_manifest(manifest_path, files)
+
+    hasher = hashlib.sha1(usedforsecurity=False)
+    for rel_path in sorted(files):
+        hasher.update(rel_path.encode("UTF-8"))
+        hasher.update(str(files[rel_path]["digest"]).encode("ASCII"))
+    return hasher.hexdigest()
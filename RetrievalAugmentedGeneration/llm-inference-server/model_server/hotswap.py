@@ -0,0 +1,298 @@
+# SPDX-FileCopyrightText: Copyright (c) 2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""This module swaps TensorRT engines into a running Triton server without a restart.
+
+Triton is started with explicit model control. When a new engine is ready, it is published as the next version of the
+tensorrt_llm model and that model is reloaded on every data parallel replica, one at a time. The old engine's KV cache
+takes most of the free GPU memory, so the new engine cannot be loaded next to it. Each replica is first drained: the
+load balancer stops sending it new connections and the swap waits until its open connections, and the streams on them,
+have finished. Then the old version is unloaded and the new one loaded, while the other replicas keep serving. If the
+new engine fails to load, every replica that was already drained goes through the same steps to load the old version
+again, the replicas that were not touched keep serving it. The tokenizer is fixed when Triton starts, so swapped
+engines must share it.
+"""
+import contextlib
+import logging
+import os
+import shutil
+import signal
+import threading
+import time
+import typing
+
+from .bundle import EngineBundle
+from .conversion import ConversionOptions, convert
+from .errors import ModelServerException
+from .model import Model
+from .server import ModelServer
+
+TRTLLM_MODEL_NAME = "tensorrt_llm"
+_LOAD_TIMEOUT_SECONDS = 1800.0
+# how long a replica's open connections may take to finish before its swap is given up
+_DRAIN_TIMEOUT_SECONDS = 600.0
+_POLL_SECONDS = 1.0
+_LOGGER = logging.getLogger(__name__)
+
+
+def _default_client(url: str, http: bool) -> typing.Any:
+    """Create a Triton client for the given URL."""
+    # pylint: disable=import-outside-toplevel  # only required in hot swap mode
+    if http:
+        import tritonclient.http as tritonclient
+    else:
+        import tritonclient.grpc as tritonclient  # type: ignore[no-redef]
+    return tritonclient.InferenceServerClient(url)
+
+
+@contextlib.contextmanager
+def _visible_devices(devices: typing.Sequence[str]) -> typing.Iterator[None]:
+    """Restrict the GPUs that CUDA processes started in this context can see."""
+    visible = os.environ.get("CUDA_VISIBLE_DEVICES")
+    os.environ["CUDA_VISIBLE_DEVICES"] = ",".join(devices)
+    try:
+        yield
+    finally:
+        if visible is None:
+            del os.environ["CUDA_VISIBLE_DEVICES"]
+        else:
+            os.environ["CUDA_VISIBLE_DEVICES"] = visible
+
+
+class EngineUpdates:
+    """Detect and prepare new engines for a running model server.
+
+    An update is either a new or modified engine bundle at the import path, or a change to the mounted model
+    weights, which is converted with the server's conversion options. The serving engines hold most of their GPUs'
+    memory, so weights are only watched when build_devices names GPUs that no replica uses. A failed conversion is
+    not retried until the weights change again.
+    """
+
+    def __init__(
+        self,
+        model: Model,
+        opts: ConversionOptions,
+        bundle_path: typing.Optional[str] = None,
+        build_devices: typing.Sequence[str] = (),
+    ) -> None:
+        """Initialize the update detector."""
+        self._model = model
+        self._opts = opts
+        self._bundle_path = bundle_path
+        self._build_devices = list(build_devices)
+        self._bundle_mtime = self._current_bundle_mtime()
+        self._failed_hash: typing.Optional[str] = None
+
+    def _current_bundle_mtime(self) -> typing.Optional[float]:
+        """Return the modification time of the bundle to import, if there is one."""
+        if self._bundle_path and os.path.isfile(self._bundle_path):
+            return os.path.getmtime(self._bundle_path)
+        return None
+
+    def _bundle_update(self) -> typing.Optional[str]:
+        """Install the bundle if it has changed since it was last seen."""
+        mtime = self._current_bundle_mtime()
+        if mtime is None or mtime == self._bundle_mtime:
+            return None
+        self._bundle_mtime = mtime
+
+        bundle = EngineBundle(typing.cast(str, self._bundle_path))
+        reason = bundle.incompatibility(self._model, None)
+        if reason:
+            _LOGGER.warning("Updated engine bundle is not compatible, %s.", reason)
+            return None
+        bundle.install(self._model)
+        return self._model.engine_dir
+
+    def _weights_update(self) -> typing.Optional[str]:
+        """Convert the mounted weights if they have changed since the current engine was built."""
+        previous = self._model.engine_dir
+        previous_format = self._model.format
+        self._model.refresh_hash()
+        if self._model.hash == self._failed_hash:
+            return None
+        engine_dir = self._model.select_engine(self._opts.cache_key_fields())
+        if engine_dir == previous:
+            return None
+
+        try:
+            if self._model.conversion_is_needed():
+                _LOGGER.info("Model weights changed. Building a new engine.")
+                with _visible_devices(self._build_devices):
+                    convert(self._model, self._opts)
+        except Exception:
+            # drop the partial engine and wait for the next change of the weights
+            shutil.rmtree(engine_dir, ignore_errors=True)
+            self._failed_hash = self._model.hash
+            self._model.adopt_engine(previous, previous_format)
+            raise
+        return engine_dir
+
+    def __call__(self) -> typing.Optional[str]:
+        """Return the directory of a newly prepared engine, or None when nothing changed."""
+        engine_dir = self._bundle_update()
+        if not engine_dir and self._build_devices:
+            engine_dir = self._weights_update()
+        return engine_dir
+
+
+class HotSwapController:
+    """Publish new engines as new model versions and reload them on every Triton server."""
+
+    # pylint: disable-next=too-many-arguments
+    def __init__(
+        self,
+        server: ModelServer,
+        model: Model,
+        updates: typing.Callable[[], typing.Optional[str]],
+        interval: float = 60.0,
+        client_factory: typing.Callable[[str, bool], typing.Any] = _default_client,
+    ) -> None:
+        """Initialize the controller."""
+        self._server = server
+        self._model = model
+        self._updates = updates
+        self._interval = interval
+        self._client_factory = client_factory
+        self._wake = threading.Event()
+        self._stop = threading.Event()
+        self._current_engine = model.engine_dir
+
+    @property
+    def _model_dir(self) -> str:
+        """Return the repository directory of the TensorRT LLM model."""
+        return os.path.join(self._server.model_repository, TRTLLM_MODEL_NAME)
+
+    def _versions(self) -> typing.List[int]:
+        """Return the model versions present in the repository, in ascending order."""
+        return sorted(
+            int(name) for name in os.listdir(self._model_dir) if name.isdigit()
+        )
+
+    def _wait_until_ready(self, client: typing.Any, version: int) -> None:
+        """Block until a Triton server reports the model version as ready."""
+        deadline = time.monotonic() + _LOAD_TIMEOUT_SECONDS
+        while not client.is_model_ready(TRTLLM_MODEL_NAME, str(version)):
+            if time.monotonic() > deadline:
+                raise ModelServerException(
+                    f"Version {version} of {TRTLLM_MODEL_NAME} did not become ready in time."
+                )
+            time.sleep(_POLL_SECONDS)
+
+    def _wait_until_unloaded(self, client: typing.Any) -> None:
+        """Block until a Triton server no longer reports the model as ready."""
+        deadline = time.monotonic() + _LOAD_TIMEOUT_SECONDS
+        while client.is_model_ready(TRTLLM_MODEL_NAME):
+            if time.monotonic() > deadline:
+                raise ModelServerException(
+                    f"{TRTLLM_MODEL_NAME} was not unloaded in time."
+                )
+            time.sleep(_POLL_SECONDS)
+
+    def _reload(self, replica: int, client: typing.Any, version: int) -> None:
+        """Load the model version rendered in the repository on a drained replica."""
+        try:
+            # there is no room for both engines, so the old one goes first
+            client.unload_model(TRTLLM_MODEL_NAME)
+            self._wait_until_unloaded(client)
+            client.load_model(TRTLLM_MODEL_NAME)
+            self._wait_until_ready(client, version)
+        finally:
+            self._server.resume(replica)
+
+    def swap(self, engine_dir: str) -> bool:
+        """Serve the given engine as a new model version, returning whether the swap succeeded."""
+        old_versions = self._versions()
+        version = (old_versions[-1] if old_versions else 0) + 1
+        version_dir = os.path.join(self._model_dir, str(version))
+        _LOGGER.info("Swapping in engine %s as version %d.", engine_dir, version)
+
+        os.makedirs(version_dir, exist_ok=True)
+        self._server.render_model_templates(engine_dir)
+        clients = [
+            self._client_factory(url, self._server.http)
+            for url in self._server.control_urls
+        ]
+        # the replicas that may no longer serve the old version
+        swapped: typing.List[int] = []
+        try:
+            # one replica at a time, so the load balancer always has replicas to route to
+            for replica, client in enumerate(clients):
+                self._server.drain(replica, _DRAIN_TIMEOUT_SECONDS)
+                swapped.append(replica)
+                self._reload(replica, client, version)
+        # pylint: disable-next=broad-exception-caught; the old engine keeps serving
+        except Exception as err:
+            _LOGGER.error(
+                "Engine swap failed, going back to the current engine: %s", err
+            )
+            shutil.rmtree(version_dir, ignore_errors=True)
+            self._server.render_model_templates(self._current_engine)
+            for replica in swapped:
+                try:
+                    self._server.drain(replica, _DRAIN_TIMEOUT_SECONDS)
+                    self._reload(replica, clients[replica], old_versions[-1])
+                # pylint: disable-next=broad-exception-caught; best effort rollback
+                except Exception as rollback_err:
+                    _LOGGER.error(
+                        "Unable to load the current engine on replica %d again: %s",
+                        replica,
+                        rollback_err,
+                    )
+            return False
+
+        for old_version in old_versions:
+            shutil.rmtree(
+                os.path.join(self._model_dir, str(old_version)), ignore_errors=True
+            )
+        self._current_engine = engine_dir
+        _LOGGER.info("Now serving engine %s as version %d.", engine_dir, version)
+        return True
+
+    def check(self) -> None:
+        """Look for a new engine and swap it in if one is found."""
+        try:
+            engine_dir = self._updates()
+        # pylint: disable-next=broad-exception-caught; keep serving the current engine
+        except Exception as err:
+            _LOGGER.error("Unable to prepare a new engine: %s", err)
+            return
+        if engine_dir and engine_dir != self._current_engine:
+            self.swap(engine_dir)
+
+    def request_update(self, *_: typing.Any) -> None:
+        """Ask the controller to look for a new engine now. Usable as a signal handler."""
+        self._wake.set()
+
+    def stop(self) -> None:
+        """Stop the controller's background thread."""
+        self._stop.set()
+        self._wake.set()
+
+    def _run(self) -> None:
+        """Periodically look for new engines until stopped."""
+        while not self._stop.is_set():
+            self._wake.wait(self._interval)
+            self._wake.clear()
+            if not self._stop.is_set():
+                self.check()
+
+    def start(self) -> threading.Thread:
+        """Start looking for new engines in the background. SIGHUP triggers an immediate check."""
+        if threading.current_thread() is threading.main_thread():
+            signal.signal(signal.SIGHUP, self.request_update)
+        thread = threading.Thread(target=self._run, name="hot-swap", daemon=True)
+        thread.start()
+        return thread
@@ -15,53 +15,21 @@
 
 """This module contains the model class that represents the model mounted to the container."""
 import glob
-import hashlib
 import logging
 import os
-import pathlib
 import subprocess
 import typing
 from enum import Enum, auto, unique
 
+from .cache import ENGINE_DIR_PREFIX, EngineCache, toolkit_versions
 from .errors import ModelServerException
+from .fingerprint import fingerprint_dir
+from .timeline import TIMELINE
 
 DEFAULT_MODEL_DIR = "/model"
-HASH_COMMAND = "sha1sum"
 _LOGGER = logging.getLogger(__name__)
 
 
-def _fast_hash_dir(dir_path: str) -> str:
-    """
-    Read the files in a directory and quickly create a hash.
-
-    This hash IS NOT cryptographically secure, but it is designed to be computed as quickly as reasonably possible.
-    This function will only hash top level files and will not traverse directories.
-    """
-    # create a threaded pool of workers to calculate individual hases
-    workers = []
-    for obj in os.listdir(dir_path):
-        obj_path = os.path.join(dir_path, obj)
-        if not os.path.isfile(obj_path):
-            continue
-
-        workers += [
-            # pylint: disable-next=consider-using-with
-            subprocess.Popen(
-                [HASH_COMMAND, obj_path], stdout=subprocess.PIPE, stderr=subprocess.PIPE
-            )
-        ]
-
-    # wait for workers to complete
-    all_shas = b""
-    for proc in workers:
-        stdout, _ = proc.communicate()
-        all_shas += stdout.split(b" ", maxsplit=1)[0]
-
-    hasher = hashlib.sha1(usedforsecurity=False)
-    hasher.update(all_shas)
-    return hasher.hexdigest()
-
-
 @unique
 class ModelFormats(Enum):
     """A Enumerator containing all of the supported model types."""
@@ -95,6 +63,7 @@ class Model:
         model_type: str,
         model_dir: typing.Optional[str] = None,
         world_size: typing.Optional[int] = None,
+        data_parallelism: int = 1,
     ):
         """Initialize the model class."""
         try:
@@ -103,15 +72,19 @@ class Model:
             raise ModelServerException(f"Unrecognized model type {type}") from err
 
         self._model_dir = model_dir or DEFAULT_MODEL_DIR
-        self._gpu_info = self._init_gpu_info(world_size=world_size)
+        self._gpu_info = self._init_gpu_info(
+            world_size=world_size, data_parallelism=data_parallelism
+        )
         self._hash: typing.Optional[str] = None
-        self._engine_dir = self._init_engine_dir()
+        self._engine_cache = EngineCache(self._model_dir)
+        self._engine_dir: typing.Optional[str] = None
         self._format = self._init_model_format()
 
     @classmethod
     def _init_gpu_info(
         cls,
         world_size: typing.Optional[int] = None,
+        data_parallelism: int = 1,
     ) -> typing.Dict[str, typing.Union[str, int]]:
         """
         Get the product name and architecture for the first GPU in the system.
@@ -133,16 +106,38 @@ class Model:
                 "Attached GPUs are dissimilar. All GPUs must be of the same type."
             )
         if not world_size:
-            world_size = len(compute_caps)
+            world_size = max(len(compute_caps) // data_parallelism, 1)
+        if world_size * data_parallelism > len(compute_caps):
+            raise ModelServerException(
+                f"{data_parallelism} replicas with a world size of {world_size} need "
+                + f"{world_size * data_parallelism} GPUs but only {len(compute_caps)} are attached."
+            )
 
-        return {"compute_cap": compute_caps[0], "world_size": world_size}
+        return {
+            "compute_cap": compute_caps[0],
+            "world_size": world_size,
+            "gpu_count": len(compute_caps),
+        }
+
+    def select_engine(self, build_options: typing.Dict[str, typing.Any]) -> str:
+        """Select the cached TensorRT engine directory matching this model and the given build options."""
+        fields = {
+            "model_hash": self.hash,
+            "model_type": self.type.name,
+            "model_format": self.format.name,
+            "world_size": self.world_size,
+            "compute_cap": self.compute_cap,
+            "toolkit": toolkit_versions(),
+            "build_options": build_options,
+        }
+        self._engine_dir = self._engine_cache.entry(fields)
+        return self._engine_dir
 
-    def _init_engine_dir(self) -> str:
-        """Create and return the path to the TensorRT cache directory for this model."""
-        cache_dir = f"trt-w{self.world_size}-cc{self.compute_cap}"
-        cache_path = os.path.join(self.model_dir, cache_dir)
-        pathlib.Path(cache_path).mkdir(parents=True, exist_ok=True)
-        return cache_path
+    def adopt_engine(self, engine_dir: str, model_format: ModelFormats) -> None:
+        """Use a prebuilt engine, taking the model format from it when no weights are mounted."""
+        self._engine_dir = engine_dir
+        if self._format == ModelFormats.UNKNOWN:
+            self._format = model_format
 
     def _init_model_format(self) -> ModelFormats:
         """Determine the format of model that has been mounted."""
@@ -161,7 +156,7 @@ class Model:
             return ModelFormats.PYTORCH
 
         # look for huggingface saved models
-        hf_count = self._file_ext_count("bin")
+        hf_count = self._file_ext_count("bin") + self._file_ext_count("safetensors")
         if hf_count:
             return ModelFormats.HUGGINGFACE
 
@@ -195,14 +190,27 @@ class Model:
     @property
     def engine_dir(self) -> str:
         """Return the stored engine directory."""
+        if not self._engine_dir:
+            raise ModelServerException("No TensorRT engine has been selected.")
         return self._engine_dir
 
+    @property
+    def engine_cache(self) -> EngineCache:
+        """Return the cache of TensorRT engines for this model."""
+        return self._engine_cache
+
     @property
     def world_size(self) -> int:
         """Return the world size."""
         ws = self._gpu_info["world_size"]
         return typing.cast(int, ws)
 
+    @property
+    def gpu_count(self) -> int:
+        """Return the number of GPUs attached to the container."""
+        count = self._gpu_info["gpu_count"]
+        return typing.cast(int, count)
+
     @property
     def compute_cap(self) -> str:
         """Return the compute capability version."""
@@ -219,9 +227,16 @@ class Model:
         """Return the hash of the model."""
         if not self._hash:
             _LOGGER.info("Calculating model hash.")
-            self._hash = _fast_hash_dir(self.model_dir)
+            with TIMELINE.phase("model_hash"):
+                self._hash = fingerprint_dir(
+                    self.model_dir, exclude_prefixes=[ENGINE_DIR_PREFIX]
+                )
         return self._hash
 
+    def refresh_hash(self) -> None:
+        """Forget the cached model hash so it is recalculated on next use."""
+        self._hash = None
+
     @property
     def _last_hash_path(self) -> str:
         """Return the path to the last known hash file."""
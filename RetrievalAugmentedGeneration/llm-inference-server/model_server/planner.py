@@ -0,0 +1,402 @@
+# SPDX-FileCopyrightText: Copyright (c) 2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Estimate the GPU memory needed to host a Llama model and recommend engine settings.
+
+The planner only reads the checkpoint's config.json (Hugging Face) or params.json (Meta), so it runs entirely on CPU
+and can be used to size a deployment before any GPU time is spent.
+
+    python3 -m model_server.planner /model --gpu-memory 80 --world-size 2 --quantization int4_awq
+"""
+import argparse
+import json
+import math
+import os
+import sys
+import typing
+from dataclasses import asdict, dataclass
+
+from .errors import ModelServerException
+
+GIB = 1024**3
+# bytes per weight element, including the per group scales of the int4 formats
+WEIGHT_BYTES = {"none": 2.0, "int8_weight_only": 1.0, "int4_awq": 0.5 + 2 / 128}
+KV_CACHE_BYTES = {"float16": 2, "int8": 1, "fp8": 1}
+# the CUDA context, cuBLAS and plugin workspaces, and the runtime's own buffers
+DEFAULT_RUNTIME_OVERHEAD_GIB = 2.0
+DEFAULT_KV_CACHE_FRACTION = 0.75
+_LATENCY_MAX_BATCH_SIZE = 16
+_THROUGHPUT_MAX_BATCH_SIZE = 256
+_THROUGHPUT_KV_CACHE_FRACTION = 0.9
+
+
+@dataclass
+class ModelShape:
+    """The architecture parameters of a Llama model."""
+
+    hidden_size: int
+    intermediate_size: int
+    num_layers: int
+    num_heads: int
+    num_kv_heads: int
+    vocab_size: int
+    max_position_embeddings: int
+
+    @property
+    def head_dim(self) -> int:
+        """Return the size of each attention head."""
+        return self.hidden_size // self.num_heads
+
+    @property
+    def layer_params(self) -> int:
+        """Return the number of parameters in a single decoder layer."""
+        attention = 2 * self.hidden_size * self.hidden_size
+        attention += 2 * self.hidden_size * self.num_kv_heads * self.head_dim
+        mlp = 3 * self.hidden_size * self.intermediate_size
+        return attention + mlp + 2 * self.hidden_size
+
+    @property
+    def total_params(self) -> int:
+        """Return the number of parameters in the whole model."""
+        embeddings = 2 * self.vocab_size * self.hidden_size
+        return self.num_layers * self.layer_params + embeddings + self.hidden_size
+
+
+@dataclass
+class CapacityPlan:
+    """The estimated memory use and capacity of one GPU for a given configuration."""
+
+    total_params: int
+    weight_bytes_per_rank: int
+    kv_bytes_per_token: int
+    activation_bytes: int
+    kv_cache_bytes: int
+    kv_cache_tokens: int
+    max_concurrent_sequences: int
+    max_batch_size: int
+    kv_cache_free_gpu_mem_fraction: float
+    min_tensor_parallelism: int
+    warnings: typing.List[str]
+
+
+def _meta_intermediate_size(params: typing.Dict[str, typing.Any]) -> int:
+    """Compute the feed forward size the same way the Meta reference implementation does."""
+    hidden = int(2 * (4 * params["dim"]) / 3)
+    hidden = int((params.get("ffn_dim_multiplier") or 1.0) * hidden)
+    multiple_of = params.get("multiple_of", 256)
+    return multiple_of * ((hidden + multiple_of - 1) // multiple_of)
+
+
+def read_model_shape(model_dir: str, vocab_size: int = 32000) -> ModelShape:
+    """Read the model architecture from the checkpoint's configuration file."""
+    hf_config = os.path.join(model_dir, "config.json")
+    meta_config = os.path.join(model_dir, "params.json")
+
+    if os.path.isfile(hf_config):
+        with open(hf_config, "r", encoding="UTF-8") as config_file:
+            config = json.load(config_file)
+        return ModelShape(
+            hidden_size=config["hidden_size"],
+            intermediate_size=config["intermediate_size"],
+            num_layers=config["num_hidden_layers"],
+            num_heads=config["num_attention_heads"],
+            num_kv_heads=config.get(
+                "num_key_value_heads", config["num_attention_heads"]
+            ),
+            vocab_size=config.get("vocab_size", vocab_size),
+            max_position_embeddings=config.get("max_position_embeddings", 4096),
+        )
+
+    if os.path.isfile(meta_config):
+        with open(meta_config, "r", encoding="UTF-8") as config_file:
+            params = json.load(config_file)
+        return ModelShape(
+            hidden_size=params["dim"],
+            intermediate_size=_meta_intermediate_size(params),
+            num_layers=params["n_layers"],
+            num_heads=params["n_heads"],
+            num_kv_heads=params.get("n_kv_heads") or params["n_heads"],
+            vocab_size=params["vocab_size"]
+            if params.get("vocab_size", -1) > 0
+            else vocab_size,
+            max_position_embeddings=4096,
+        )
+
+    raise ModelServerException(
+        f"No config.json or params.json was found in {model_dir}."
+    )
+
+
+def weight_bytes_per_rank(
+    shape: ModelShape,
+    quantization: str,
+    tensor_parallelism: int,
+    pipeline_parallelism: int,
+) -> int:
+    """Estimate the weight memory on the most heavily loaded rank."""
+    layers = math.ceil(shape.num_layers / pipeline_parallelism)
+    layer_bytes = layers * shape.layer_params * WEIGHT_BYTES[quantization]
+    # the embedding table is replicated and stays in float16, the lm head is split across the tensor parallel ranks
+    embedding_bytes = shape.vocab_size * shape.hidden_size * 2
+    lm_head_bytes = shape.vocab_size * shape.hidden_size * 2 / tensor_parallelism
+    if pipeline_parallelism > 1:
+        embedding_bytes = max(embedding_bytes, lm_head_bytes)
+        lm_head_bytes = 0
+    return int(layer_bytes / tensor_parallelism + embedding_bytes + lm_head_bytes)
+
+
+def kv_bytes_per_token(
+    shape: ModelShape,
+    kv_cache_dtype: str,
+    tensor_parallelism: int,
+    pipeline_parallelism: int,
+) -> int:
+    """Estimate the KV cache memory that each token uses on a single rank."""
+    layers = math.ceil(shape.num_layers / pipeline_parallelism)
+    kv_heads = max(1, shape.num_kv_heads // tensor_parallelism)
+    return 2 * layers * kv_heads * shape.head_dim * KV_CACHE_BYTES[kv_cache_dtype]
+
+
+def activation_bytes(
+    shape: ModelShape,
+    max_batch_size: int,
+    max_input_length: int,
+    tensor_parallelism: int,
+) -> int:
+    """Estimate the activation memory of a full context phase batch."""
+    width = 2 * shape.hidden_size + shape.intermediate_size // tensor_parallelism
+    return max_batch_size * max_input_length * width * 2
+
+
+# pylint: disable-next=too-many-arguments,too-many-locals
+def plan_capacity(
+    shape: ModelShape,
+    gpu_memory_bytes: int,
+    world_size: int,
+    pipeline_parallelism: int = 1,
+    quantization: str = "none",
+    kv_cache_dtype: str = "float16",
+    max_input_length: int = 3000,
+    max_output_length: int = 512,
+    target: str = "throughput",
+    runtime_overhead_bytes: int = int(DEFAULT_RUNTIME_OVERHEAD_GIB * GIB),
+    kv_cache_fraction: typing.Optional[float] = None,
+) -> CapacityPlan:
+    """Estimate the memory use of a configuration and recommend the batch size and KV cache settings."""
+    tensor_parallelism = max(1, world_size // pipeline_parallelism)
+    warnings = []
+    if kv_cache_fraction is None:
+        kv_cache_fraction = (
+            _THROUGHPUT_KV_CACHE_FRACTION
+            if target == "throughput"
+            else DEFAULT_KV_CACHE_FRACTION
+        )
+
+    sequence_length = max_input_length + max_output_length
+    if sequence_length > shape.max_position_embeddings:
+        warnings.append(
+            f"max input + output length ({sequence_length}) exceeds the model's "
+            + f"max_position_embeddings ({shape.max_position_embeddings})"
+        )
+
+    weights = weight_bytes_per_rank(
+        shape, quantization, tensor_parallelism, pipeline_parallelism
+    )
+    kv_per_token = kv_bytes_per_token(
+        shape, kv_cache_dtype, tensor_parallelism, pipeline_parallelism
+    )
+
+    # find the smallest tensor parallelism that fits the weights
+    min_tp = 1
+    while (
+        min_tp < 64
+        and weight_bytes_per_rank(shape, quantization, min_tp, pipeline_parallelism)
+        + runtime_overhead_bytes
+        >= gpu_memory_bytes
+    ):
+        min_tp *= 2
+    if min_tp > tensor_parallelism:
+        warnings.append(
+            f"the weights do not fit with a tensor parallelism of {tensor_parallelism}, "
+            + f"at least {min_tp} is needed"
+        )
+
+    # the engine's batch size sizes the activations, which compete with the kv cache for memory
+    def _capacity(batch_size: int) -> typing.Tuple[int, int, int]:
+        activations = activation_bytes(
+            shape, batch_size, max_input_length, tensor_parallelism
+        )
+        free = gpu_memory_bytes - weights - runtime_overhead_bytes - activations
+        kv_cache = max(0, int(free * kv_cache_fraction))
+        return activations, kv_cache, kv_cache // (kv_per_token * sequence_length)
+
+    limit = (
+        _THROUGHPUT_MAX_BATCH_SIZE
+        if target == "throughput"
+        else _LATENCY_MAX_BATCH_SIZE
+    )
+    batch_size = 1
+    while batch_size * 2 <= limit and _capacity(batch_size * 2)[2] >= batch_size * 2:
+        batch_size *= 2
+    activations, kv_cache, concurrency = _capacity(batch_size)
+    if concurrency < 1:
+        warnings.append("not even a single full length sequence fits in the KV cache")
+
+    return CapacityPlan(
+        total_params=shape.total_params,
+        weight_bytes_per_rank=weights,
+        kv_bytes_per_token=kv_per_token,
+        activation_bytes=activations,
+        kv_cache_bytes=kv_cache,
+        kv_cache_tokens=kv_cache // kv_per_token,
+        max_concurrent_sequences=concurrency,
+        max_batch_size=batch_size,
+        kv_cache_free_gpu_mem_fraction=kv_cache_fraction,
+        min_tensor_parallelism=min_tp,
+        warnings=warnings,
+    )
+
+
+def _format_plan(plan: CapacityPlan) -> str:
+    """Render the plan as a human readable report."""
+    lines = [
+        f"Parameters:                      {plan.total_params / 1e9:.2f} B",
+        f"Weight memory per rank:          {plan.weight_bytes_per_rank / GIB:.2f} GiB",
+        f"KV cache per token per rank:     {plan.kv_bytes_per_token / 1024:.1f} KiB",
+        f"Activation memory per rank:      {plan.activation_bytes / GIB:.2f} GiB",
+        f"KV cache memory per rank:        {plan.kv_cache_bytes / GIB:.2f} GiB",
+        f"KV cache capacity:               {plan.kv_cache_tokens} tokens",
+        f"Max concurrent sequences:        {plan.max_concurrent_sequences}",
+        "",
+        "Recommended settings:",
+        f"  max_batch_size:                  {plan.max_batch_size}",
+        f"  kv_cache_free_gpu_mem_fraction:  {plan.kv_cache_free_gpu_mem_fraction}",
+        f"  minimum tensor parallelism:      {plan.min_tensor_parallelism}",
+    ]
+    lines += [f"WARNING: {warning}" for warning in plan.warnings]
+    return "\n".join(lines)
+
+
+def parse_args(argv: typing.Optional[typing.List[str]] = None) -> argparse.Namespace:
+    """Parse the planner's command line arguments."""
+    parser = argparse.ArgumentParser(
+        prog="model-server-planner",
+        description="Estimate GPU memory use and recommend TensorRT LLM engine settings, using only the CPU.",
+    )
+    parser.add_argument(
+        "model_dir",
+        metavar="MODEL_DIR",
+        help="The checkpoint directory containing config.json or params.json.",
+    )
+    parser.add_argument(
+        "--gpu-memory",
+        type=float,
+        required=True,
+        help="The memory of each GPU in GiB.",
+    )
+    parser.add_argument(
+        "-w", "--world-size", type=int, default=1, help="The number of GPUs."
+    )
+    parser.add_argument(
+        "--pipeline-parallelism",
+        type=int,
+        default=1,
+        help="number of pipeline parallism divisions (default: 1)",
+    )
+    parser.add_argument(
+        "--quantization",
+        type=str.lower,
+        default="none",
+        choices=list(WEIGHT_BYTES),
+        help="Quantization type to be used for LLMs",
+    )
+    parser.add_argument(
+        "--kv-cache-dtype",
+        default="float16",
+        choices=list(KV_CACHE_BYTES),
+        help="The data type of the KV cache. (default: float16)",
+    )
+    parser.add_argument(
+        "--max-input-length",
+        type=int,
+        default=3000,
+        help="maximum number of input tokens",
+    )
+    parser.add_argument(
+        "--max-output-length",
+        type=int,
+        default=512,
+        help="maximum number of output tokens",
+    )
+    parser.add_argument(
+        "--target",
+        choices=["latency", "throughput"],
+        default="throughput",
+        help="Optimize the recommendation for per request latency or aggregate throughput. (default: throughput)",
+    )
+    parser.add_argument(
+        "--runtime-overhead",
+        type=float,
+        default=DEFAULT_RUNTIME_OVERHEAD_GIB,
+        help=f"GPU memory in GiB reserved for the CUDA context and workspaces. (default: {DEFAULT_RUNTIME_OVERHEAD_GIB})",
+    )
+    parser.add_argument(
+        "--kv-cache-fraction",
+        type=float,
+        default=None,
+        help="Use this kv_cache_free_gpu_mem_fraction instead of recommending one.",
+    )
+    parser.add_argument(
+        "--vocab-size",
+        type=int,
+        default=32000,
+        help="The vocabulary size, when the checkpoint does not declare it. (default: 32000)",
+    )
+    parser.add_argument("--json", action="store_true", help="Print the plan as JSON.")
+    return parser.parse_args(argv)
+
+
+def main(argv: typing.Optional[typing.List[str]] = None) -> int:
+    """Run the capacity planner."""
+    args = parse_args(argv)
+    if args.world_size % args.pipeline_parallelism:
+        raise ModelServerException(
+            "Pipeline Parallelism must evenly divide the World Size"
+        )
+
+    shape = read_model_shape(args.model_dir, vocab_size=args.vocab_size)
+    plan = plan_capacity(
+        shape,
+        gpu_memory_bytes=int(args.gpu_memory * GIB),
+        world_size=args.world_size,
+        pipeline_parallelism=args.pipeline_parallelism,
+        quantization=args.quantization,
+        kv_cache_dtype=args.kv_cache_dtype,
+        max_input_length=args.max_input_length,
+        max_output_length=args.max_output_length,
+        target=args.target,
+        runtime_overhead_bytes=int(args.runtime_overhead * GIB),
+        kv_cache_fraction=args.kv_cache_fraction,
+    )
+
+    if args.json:
+        print(json.dumps(asdict(plan), indent=2))
+    else:
+        print(_format_plan(plan))
+    return 0 if plan.max_concurrent_sequences > 0 else 1
+
+
+if __name__ == "__main__":
+    sys.exit(main())
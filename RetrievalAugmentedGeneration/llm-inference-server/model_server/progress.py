@@ -0,0 +1,186 @@
+# SPDX-FileCopyrightText: Copyright (c) 2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""This module reports the progress of a running engine conversion.
+
+The conversion script writes the progress of each rank, with the time, bytes read and peak RSS of every step and
+layer, to rank<N>.json in the progress directory. While a conversion runs, the monitor logs a summary of each rank
+whenever it changes and publishes the progress as gauges in the startup metrics file.
+"""
+import glob
+import json
+import logging
+import os
+import shutil
+import threading
+import types
+import typing
+
+from .timeline import TIMELINE
+
+PROGRESS_DIR_ENV = "MODEL_SERVER_PROGRESS_DIR"
+DEFAULT_PROGRESS_DIR = "/tmp/model_server_conversion"  # nosec; not a secret location
+_POLL_SECONDS = 10.0
+_LOGGER = logging.getLogger(__name__)
+
+
+def progress_dir() -> str:
+    """Return the directory the conversion writes its progress to."""
+    return os.environ.get(PROGRESS_DIR_ENV, DEFAULT_PROGRESS_DIR)
+
+
+def read_progress(directory: str) -> typing.List[typing.Dict[str, typing.Any]]:
+    """Return the latest progress of every rank, ordered by rank."""
+    progress = []
+    for path in glob.glob(os.path.join(directory, "rank*.json")):
+        try:
+            with open(path, "r", encoding="UTF-8") as progress_file:
+                progress.append(json.load(progress_file))
+        except (OSError, ValueError):
+            # the file is replaced atomically, so this only happens while it is being removed
+            continue
+    return sorted(progress, key=lambda rank: rank.get("rank", 0))
+
+
+def _duration(seconds: float) -> str:
+    """Format a duration as hours, minutes and seconds."""
+    minutes, seconds = divmod(int(seconds), 60)
+    hours, minutes = divmod(minutes, 60)
+    if hours:
+        return f"{hours}h{minutes:02d}m"
+    if minutes:
+        return f"{minutes}m{seconds:02d}s"
+    return f"{seconds}s"
+
+
+def describe(progress: typing.Dict[str, typing.Any]) -> str:
+    """Summarize the progress of a rank in one line."""
+    step = progress.get("step")
+    if step is None:
+        done = [finished["name"] for finished in progress.get("steps", [])]
+        state = f"finished {done[-1]}" if done else "starting"
+    else:
+        state = step["name"]
+        if step.get("unit"):
+            state += f" {step['done']}/{step['total']} {step['unit']}"
+        if step.get("eta_seconds") is not None:
+            state += f", ETA {_duration(step['eta_seconds'])}"
+    return (
+        f"rank {progress.get('rank', 0)}: {state}, "
+        f"{_duration(progress.get('seconds', 0))} elapsed, "
+        f"{progress.get('bytes_read', 0) / 2**30:.1f} GiB read, "
+        f"peak RSS {progress.get('peak_rss_bytes', 0) / 2**30:.1f} GiB"
+    )
+
+
+def metrics(
+    progress: typing.Sequence[typing.Dict[str, typing.Any]]
+) -> typing.List[str]:
+    """Return the progress of every rank in the Prometheus text format."""
+    lines = [
+        "# HELP model_server_conversion_step_done Layers, or other units, the current conversion step has processed.",
+        "# TYPE model_server_conversion_step_done gauge",
+        "# HELP model_server_conversion_step_total Layers, or other units, the current conversion step will process.",
+        "# TYPE model_server_conversion_step_total gauge",
+        "# HELP model_server_conversion_eta_seconds Estimated time until the current conversion step finishes.",
+        "# TYPE model_server_conversion_eta_seconds gauge",
+        "# HELP model_server_conversion_step_seconds Wall time of each finished conversion step.",
+        "# TYPE model_server_conversion_step_seconds gauge",
+        "# HELP model_server_conversion_bytes_read Bytes the conversion has read from storage.",
+        "# TYPE model_server_conversion_bytes_read gauge",
+        "# HELP model_server_conversion_peak_rss_bytes Peak RSS of the conversion.",
+        "# TYPE model_server_conversion_peak_rss_bytes gauge",
+    ]
+    for rank in progress:
+        labels = f'rank="{rank.get("rank", 0)}"'
+        step = rank.get("step")
+        if step is not None:
+            step_labels = f'{labels},step="{step["name"]}"'
+            lines += [
+                f"model_server_conversion_step_done{{{step_labels}}} {step['done']}",
+                f"model_server_conversion_step_total{{{step_labels}}} {step['total']}",
+            ]
+            if step.get("eta_seconds") is not None:
+                lines += [
+                    f"model_server_conversion_eta_seconds{{{labels}}} {step['eta_seconds']:.3f}"
+                ]
+        for finished in rank.get("steps", []):
+            lines += [
+                f'model_server_conversion_step_seconds{{{labels},step="{finished["name"]}"}} '
+                f"{finished['seconds']:.3f}"
+            ]
+        lines += [
+            f"model_server_conversion_bytes_read{{{labels}}} {rank.get('bytes_read', 0)}",
+            f"model_server_conversion_peak_rss_bytes{{{labels}}} {rank.get('peak_rss_bytes', 0)}",
+        ]
+    return lines
+
+
+class ProgressMonitor:
+    """Follow the progress files of a conversion while it runs."""
+
+    def __init__(self, directory: str, interval: float = _POLL_SECONDS) -> None:
+        """Initialize the monitor."""
+        self._directory = directory
+        self._interval = interval
+        self._stop = threading.Event()
+        self._thread: typing.Optional[threading.Thread] = None
+        self._progress: typing.List[typing.Dict[str, typing.Any]] = []
+        self._states: typing.Dict[int, typing.Tuple[typing.Any, ...]] = {}
+
+    def metrics(self) -> typing.List[str]:
+        """Return the last seen progress as metrics."""
+        return metrics(self._progress)
+
+    def poll(self) -> None:
+        """Read the progress files, log the ranks that have changed and update the metrics file."""
+        self._progress = read_progress(self._directory)
+        for rank in self._progress:
+            # the times always change, so only a new step or layer is worth a log line
+            step = rank.get("step") or {}
+            state = (len(rank.get("steps", [])), step.get("name"), step.get("done"))
+            if self._states.get(rank.get("rank", 0)) != state:
+                self._states[rank.get("rank", 0)] = state
+                _LOGGER.info("Conversion progress, %s", describe(rank))
+        TIMELINE.write_metrics()
+
+    def _run(self) -> None:
+        """Poll until stopped."""
+        while not self._stop.wait(self._interval):
+            self.poll()
+
+    def __enter__(self) -> "ProgressMonitor":
+        """Clear the progress of earlier conversions and start following this one."""
+        shutil.rmtree(self._directory, ignore_errors=True)
+        os.makedirs(self._directory, exist_ok=True)
+        TIMELINE.add_collector(self.metrics)
+        self._thread = threading.Thread(
+            target=self._run, name="conversion-progress", daemon=True
+        )
+        self._thread.start()
+        return self
+
+    def __exit__(
+        self,
+        exc_type: typing.Optional[typing.Type[BaseException]],
+        exc_value: typing.Optional[BaseException],
+        traceback: typing.Optional[types.TracebackType],
+    ) -> None:
+        """Stop following the conversion, logging its final state."""
+        self._stop.set()
+        if self._thread is not None:
+            self._thread.join()
+        self.poll()
+        TIMELINE.remove_collector(self.metrics)
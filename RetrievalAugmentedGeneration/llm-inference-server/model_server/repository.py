@@ -0,0 +1,174 @@
+# SPDX-FileCopyrightText: Copyright (c) 2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""This module composes one Triton model repository from the LLM ensemble and auxiliary models.
+
+Auxiliary models, such as embedding or reranking models, are ordinary Triton model directories. Each one is linked
+into the composed repository under its own name with a rendered config.pbtxt whose instance group places it on the
+requested GPUs, so small models can share GPUs with the LLM instead of needing their own containers.
+"""
+import logging
+import os
+import re
+import shutil
+import typing
+from dataclasses import dataclass, field
+
+from jinja2 import Environment, FileSystemLoader
+
+from .errors import ModelServerException
+
+CONFIG_FILE = "config.pbtxt"
+CONFIG_TEMPLATE = "config.pbtxt.j2"
+_NAME_RE = re.compile(r'^name:\s*".*"\s*$', re.MULTILINE)
+_INSTANCE_GROUP_RE = re.compile(r"^instance_group\s*\[", re.MULTILINE)
+_LOGGER = logging.getLogger(__name__)
+
+
+@dataclass
+class ModelSpec:
+    """An auxiliary Triton model and where its instances should run."""
+
+    name: str
+    path: str
+    # None places the instances on the CPU
+    gpus: typing.Optional[typing.List[int]] = field(default_factory=lambda: [0])
+    instances: int = 1
+
+    @classmethod
+    def parse(cls, spec: str) -> "ModelSpec":
+        """Parse a spec such as name=embedder,path=/models/embedder,gpus=0:1,instances=2.
+
+        Only path is required. The name defaults to the directory name, gpus is a colon separated list of device
+        indexes or "cpu", and instances is the number of instances on each GPU.
+        """
+        try:
+            options = dict(item.split("=", 1) for item in spec.split(","))
+        except ValueError as err:
+            raise ModelServerException(
+                f"Model spec {spec} must be a comma separated list of key=value pairs."
+            ) from err
+
+        unknown = set(options) - {"name", "path", "gpus", "instances"}
+        if unknown:
+            raise ModelServerException(
+                f"Unknown model spec options: {', '.join(sorted(unknown))}"
+            )
+        if not options.get("path"):
+            raise ModelServerException(f"Model spec {spec} is missing the path.")
+
+        path = os.path.abspath(options["path"])
+        try:
+            gpus = options.get("gpus", "0")
+            return cls(
+                name=options.get("name") or os.path.basename(path.rstrip("/")),
+                path=path,
+                gpus=None
+                if gpus.lower() == "cpu"
+                else [int(gpu) for gpu in gpus.split(":")],
+                instances=int(options.get("instances", "1")),
+            )
+        except ValueError as err:
+            raise ModelServerException(f"Model spec {spec} is not valid.") from err
+
+    @property
+    def instance_group(self) -> str:
+        """Return the Triton instance group that places this model."""
+        lines = ["instance_group [", "  {", f"    count: {self.instances}"]
+        if self.gpus is None:
+            lines += ["    kind: KIND_CPU"]
+        else:
+            gpus = ", ".join(str(gpu) for gpu in self.gpus)
+            lines += ["    kind: KIND_GPU", f"    gpus: [ {gpus} ]"]
+        return "\n".join(lines + ["  }", "]"]) + "\n"
+
+
+def _strip_instance_group(config: str) -> str:
+    """Remove the top level instance group from a model configuration."""
+    match = _INSTANCE_GROUP_RE.search(config)
+    if not match:
+        return config
+
+    depth = 0
+    for idx in range(match.end() - 1, len(config)):
+        if config[idx] == "[":
+            depth += 1
+        elif config[idx] == "]":
+            depth -= 1
+            if depth == 0:
+                return config[: match.start()] + config[idx + 1 :].lstrip("\n")
+    raise ModelServerException("Unterminated instance_group in model configuration.")
+
+
+def render_model_config(spec: ModelSpec) -> str:
+    """Render an auxiliary model's configuration with its name and placement."""
+    if os.path.isfile(os.path.join(spec.path, CONFIG_TEMPLATE)):
+        env = Environment(
+            loader=FileSystemLoader(searchpath=spec.path), autoescape=False
+        )  # nosec; the templates are provided by the operator, not by clients
+        config = env.get_template(CONFIG_TEMPLATE).render(
+            model_dir=spec.path, gpus=spec.gpus, instances=spec.instances
+        )
+    elif os.path.isfile(os.path.join(spec.path, CONFIG_FILE)):
+        with open(os.path.join(spec.path, CONFIG_FILE), "r", encoding="UTF-8") as src:
+            config = src.read()
+    else:
+        raise ModelServerException(
+            f"No {CONFIG_FILE} or {CONFIG_TEMPLATE} found in the model directory {spec.path}."
+        )
+
+    name = f'name: "{spec.name}"'
+    if _NAME_RE.search(config):
+        config = _NAME_RE.sub(name, config, count=1)
+    else:
+        config = f"{name}\n{config}"
+    config = _strip_instance_group(config)
+    return config.rstrip("\n") + "\n\n" + spec.instance_group
+
+
+def compose_repository(
+    dest: str, llm_repository: str, specs: typing.Sequence[ModelSpec]
+) -> str:
+    """Build a model repository at dest that serves the LLM ensemble and the auxiliary models."""
+    shutil.rmtree(dest, ignore_errors=True)
+    os.makedirs(dest)
+
+    # link the llm models so renders and hot swaps in the ensemble directory stay visible
+    llm_repository = os.path.abspath(llm_repository)
+    for entry in os.listdir(llm_repository):
+        if os.path.isdir(os.path.join(llm_repository, entry)):
+            os.symlink(os.path.join(llm_repository, entry), os.path.join(dest, entry))
+
+    for spec in specs:
+        model_dir = os.path.join(dest, spec.name)
+        if os.path.lexists(model_dir):
+            raise ModelServerException(
+                f"The model name {spec.name} is used more than once in the model repository."
+            )
+        os.makedirs(model_dir)
+        for entry in os.listdir(spec.path):
+            if entry not in (CONFIG_FILE, CONFIG_TEMPLATE):
+                os.symlink(
+                    os.path.join(spec.path, entry), os.path.join(model_dir, entry)
+                )
+        with open(os.path.join(model_dir, CONFIG_FILE), "w", encoding="UTF-8") as out:
+            out.write(render_model_config(spec))
+        _LOGGER.info(
+            "Hosting %s from %s on %s.",
+            spec.name,
+            spec.path,
+            "the CPU" if spec.gpus is None else f"GPUs {spec.gpus}",
+        )
+    return dest
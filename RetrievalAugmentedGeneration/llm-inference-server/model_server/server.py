@@ -17,25 +17,150 @@
 import logging
 import os
 import subprocess
+import threading
+import time
 import typing
+import urllib.request
 
 from jinja2 import Environment, FileSystemLoader
 
+from .balancer import LoadBalancer, start_balancers
+from .errors import ModelServerException
 from .model import Model, ModelFormats
+from .repository import ModelSpec, compose_repository
+from .timeline import TIMELINE
 
 _ENSEMBLE_MODEL_DIR = "/opt/ensemble_models"
+_COMPOSED_REPOSITORY_DIR = "/tmp/model_repository"  # nosec; rebuilt on every start
 _TRITON_BIN = "/opt/tritonserver/bin/tritonserver"
 _MPIRUN_BIN = "/usr/local/mpi/bin/mpirun"
+_TRITON_HTTP_PORT = 8000
+_TRITON_GRPC_PORT = 8001
+_TRITON_HTTP_URL = f"localhost:{_TRITON_HTTP_PORT}"
+_TRITON_GRPC_URL = f"localhost:{_TRITON_GRPC_PORT}"
+# data parallel replicas listen on consecutive blocks of ports starting here
+_REPLICA_BASE_PORT = 9000
+_REPLICA_PORT_STRIDE = 3
+_READINESS_POLL_SECONDS = 1.0
+_READINESS_TIMEOUT_SECONDS = 1.0
+_DRAIN_POLL_SECONDS = 0.5
 _LOGGER = logging.getLogger(__name__)
 
 
+def replica_ports(replica: int) -> typing.Dict[str, int]:
+    """Return the ports a data parallel replica listens on."""
+    base = _REPLICA_BASE_PORT + replica * _REPLICA_PORT_STRIDE
+    return {"http": base, "grpc": base + 1, "metrics": base + 2}
+
+
+def triton_server_args(
+    rank: int,
+    repository: str,
+    http: bool,
+    replica: typing.Optional[int] = None,
+    model_control: typing.Sequence[str] = (),
+) -> typing.List[str]:
+    """Generate the arguments of the triton server of given rank, in a data parallel replica if one is given.
+
+    Replicas always serve http on their own port, so their readiness can be checked.
+    """
+    allow_http = "true" if http or replica is not None else "false"
+    args = [
+        "--allow-http",
+        allow_http,
+        "--allow-grpc",
+        "false" if http else "true",
+        "--model-repository",
+        repository,
+        "--disable-auto-complete-config",
+    ]
+    args += model_control
+    if replica is None:
+        return args + [f"--backend-config=python,shm-region-prefix-name=prefix{rank}_"]
+
+    ports = replica_ports(replica)
+    return args + [
+        "--http-port",
+        str(ports["http"]),
+        "--grpc-port",
+        str(ports["grpc"]),
+        "--metrics-port",
+        str(ports["metrics"]),
+        "--backend-config=python,shm-region-prefix-name="
+        + f"replica{replica}_prefix{rank}_",
+    ]
+
+
+def mpi_command(rank_args: typing.Sequence[typing.Sequence[str]]) -> typing.List[str]:
+    """Generate the command for one MPI world that starts a triton server with the given arguments per rank."""
+    cmd = [_MPIRUN_BIN]
+    for args in rank_args:
+        cmd += ["-n", "1", _TRITON_BIN, *args, ":"]
+    return cmd
+
+
+def replica_devices(
+    replica: int, world_size: int, gpu_count: int, visible: typing.Optional[str]
+) -> typing.List[str]:
+    """Return the GPUs assigned to a data parallel replica, out of the visible ones."""
+    devices = visible.split(",") if visible else [str(idx) for idx in range(gpu_count)]
+    return devices[replica * world_size : (replica + 1) * world_size]
+
+
+def replica_env(
+    env: typing.Mapping[str, str], replica: int, world_size: int, gpu_count: int
+) -> typing.Dict[str, str]:
+    """Return the environment of a data parallel replica, derived from the server's environment."""
+    devices = replica_devices(
+        replica, world_size, gpu_count, env.get("CUDA_VISIBLE_DEVICES")
+    )
+    return {**env, "CUDA_VISIBLE_DEVICES": ",".join(devices)}
+
+
+def replica_is_ready(replica: int) -> bool:
+    """Ask a data parallel replica if its engine is ready, it is not while an engine is swapped in."""
+    url = f"http://127.0.0.1:{replica_ports(replica)['http']}/v2/models/tensorrt_llm/ready"
+    try:
+        with urllib.request.urlopen(  # nosec; always a local http url
+            url, timeout=_READINESS_TIMEOUT_SECONDS
+        ) as resp:
+            return bool(resp.status == 200)
+    except OSError:
+        return False
+
+
 class ModelServer:
     """Abstraction of a multi-gpu triton inference server cluster."""
 
-    def __init__(self, model: Model, http: bool = False) -> None:
+    def __init__(
+        self,
+        model: Model,
+        http: bool = False,
+        data_parallelism: int = 1,
+        explicit_model_control: bool = False,
+        extra_models: typing.Sequence[ModelSpec] = (),
+    ) -> None:
         """Initialize the model server."""
         self._model = model
         self._http = http
+        self._data_parallelism = data_parallelism
+        self._explicit_model_control = explicit_model_control
+        self._extra_models = list(extra_models)
+        # the replicas that report ready, and the ones taken out of the load balancer to swap their engine
+        self._ready: typing.Set[int] = set()
+        self._draining: typing.Set[int] = set()
+        self._replica_balancers: typing.List[LoadBalancer] = []
+
+        # every triton server sees all of the gpus, or only its own when running replicas
+        visible_gpus = model.gpu_count if data_parallelism == 1 else model.world_size
+        for spec in self._extra_models:
+            if spec.gpus is not None and any(
+                gpu < 0 or gpu >= visible_gpus for gpu in spec.gpus
+            ):
+                raise ModelServerException(
+                    f"{spec.name} is placed on GPUs {spec.gpus} but each Triton server only has "
+                    + f"{visible_gpus} GPUs."
+                )
 
     @property
     def _decoupled_mode(self) -> str:
@@ -45,18 +170,11 @@ class ModelServer:
         return "true" if not self._http else "false"
 
     @property
-    def _allow_http(self) -> str:
-        """Indicate if Triton should allow http connections."""
-        return "true" if self._http else "false"
-
-    @property
-    def _allow_grpc(self) -> str:
-        """Inidicate if Triton should allow grpc connections."""
-        return "true" if not self._http else "false"
-
-    @property
-    def _tokenizer_model_dir(self) -> str:
+    def tokenizer_model_dir(self) -> str:
         """Inidicate where the tokenizer model can be found."""
+        bundled_tokenizer = os.path.join(self._model.engine_dir, "tokenizer")
+        if os.path.isdir(bundled_tokenizer):
+            return bundled_tokenizer
         if self._model.format == ModelFormats.NEMO:
             return self._model.engine_dir
         return self._model.model_dir
@@ -73,37 +191,110 @@ class ModelServer:
         """Return the triton model repository."""
         return os.path.join(_ENSEMBLE_MODEL_DIR, self._model.family)
 
-    def _triton_server_cmd(self, rank: int) -> typing.List[str]:
-        """Generate the command to start a single triton server of given rank."""
+    @property
+    def triton_repository(self) -> str:
+        """Return the repository Triton loads, which adds any auxiliary models to the LLM ensemble."""
+        if self._extra_models:
+            return _COMPOSED_REPOSITORY_DIR
+        return self.model_repository
+
+    @property
+    def _llm_model_names(self) -> typing.List[str]:
+        """Return the names of the models that make up the LLM ensemble."""
+        return sorted(
+            entry
+            for entry in os.listdir(self.model_repository)
+            if os.path.isdir(os.path.join(self.model_repository, entry))
+        )
+
+    def _model_control_flags(self, rank: int) -> typing.List[str]:
+        """Generate the flags that select which models a triton server of given rank loads."""
+        if self._extra_models and rank > 0:
+            # only rank 0 serves clients, so the other ranks skip the auxiliary models
+            return ["--model-control-mode=explicit"] + [
+                f"--load-model={name}" for name in self._llm_model_names
+            ]
+        if self._explicit_model_control:
+            return ["--model-control-mode=explicit", "--load-model=*"]
+        return []
+
+    def replica_cmd(self, replica: typing.Optional[int] = None) -> typing.List[str]:
+        """Generate the command for one MPI world, either the only one or a data parallel replica."""
+        return mpi_command(
+            [
+                triton_server_args(
+                    rank,
+                    self.triton_repository,
+                    self._http,
+                    replica=replica,
+                    model_control=self._model_control_flags(rank),
+                )
+                for rank in range(self._model.world_size)
+            ]
+        )
+
+    @property
+    def control_urls(self) -> typing.List[str]:
+        """Return the URLs of every Triton server's client API."""
+        protocol = "http" if self._http else "grpc"
+        if self._data_parallelism == 1:
+            return [_TRITON_HTTP_URL if self._http else _TRITON_GRPC_URL]
         return [
-            "-n",
-            "1",
-            _TRITON_BIN,
-            "--allow-http",
-            self._allow_http,
-            "--allow-grpc",
-            self._allow_grpc,
-            "--model-repository",
-            self.model_repository,
-            "--disable-auto-complete-config",
-            f"--backend-config=python,shm-region-prefix-name=prefix{rank}_",
-            ":",
+            f"localhost:{replica_ports(replica)[protocol]}"
+            for replica in range(self._data_parallelism)
         ]
 
+    def drain(self, replica: int, timeout: float) -> None:
+        """Stop sending new connections to a replica and wait until its open connections have closed.
+
+        Another replica has to be ready, so the model keeps being served while this one is drained.
+        """
+        if not self._ready - {replica}:
+            raise ModelServerException(
+                f"Not draining replica {replica}, no other replica is ready to serve."
+            )
+        self._draining.add(replica)
+        for balancer in self._replica_balancers:
+            balancer.set_available(replica, False)
+
+        deadline = time.monotonic() + timeout
+        while any(
+            balancer.open_connections_to(replica)
+            for balancer in self._replica_balancers
+        ):
+            if time.monotonic() > deadline:
+                self.resume(replica)
+                raise ModelServerException(
+                    f"Connections to replica {replica} were still open after {timeout:g} seconds."
+                )
+            time.sleep(_DRAIN_POLL_SECONDS)
+
+    def resume(self, replica: int) -> None:
+        """Send connections to a drained replica again, once it reports ready."""
+        self._draining.discard(replica)
+
+    @property
+    def http(self) -> bool:
+        """Indicate if Triton is serving http instead of grpc."""
+        return self._http
+
     @property
     def _cmd(self) -> typing.List[str]:
         """Generate the full command."""
-        cmd = [_MPIRUN_BIN]
-        for rank in range(self._model.world_size):
-            cmd += self._triton_server_cmd(rank)
-        return cmd
+        return self.replica_cmd()
+
+    def replica_env(self, replica: int) -> typing.Dict[str, str]:
+        """Return the environment variables for a data parallel replica."""
+        return replica_env(
+            self._env, replica, self._model.world_size, self._model.gpu_count
+        )
 
     @property
     def _env(self) -> typing.Dict[str, str]:
         """Return the environment variable for the triton inference server."""
         env = dict(os.environ)
         env["TRT_ENGINE_DIR"] = self._model.engine_dir
-        env["TOKENIZER_DIR"] = self._tokenizer_model_dir
+        env["TOKENIZER_DIR"] = self.tokenizer_model_dir
         if os.getuid() == 0:
             _LOGGER.warning(
                 "Triton server will be running as root. It is recommended that you don't run this container as root."
@@ -112,8 +303,8 @@ class ModelServer:
             env["OMPI_ALLOW_RUN_AS_ROOT_CONFIRM"] = "1"
         return env
 
-    def _render_model_templates(self) -> None:
-        """Render and Jinja templates in the model directory."""
+    def render_model_templates(self, engine_dir: typing.Optional[str] = None) -> None:
+        """Render and Jinja templates in the model directory, pointing at the model's engine by default."""
         env = Environment(
             loader=FileSystemLoader(searchpath=self.model_repository),
             autoescape=False,
@@ -128,23 +319,147 @@ class ModelServer:
 
         with open(output_path, "w", encoding="UTF-8") as out:
             template_args = {
-                "engine_dir": self._model.engine_dir,
+                "engine_dir": engine_dir or self._model.engine_dir,
                 "decoupled_mode": self._decoupled_mode,
                 "gpt_model_type": self._gpt_model_type,
             }
             out.write(template.render(**template_args))
 
+    def _watch_readiness(self, proc: subprocess.Popen, start: float) -> None:  # type: ignore[type-arg]
+        """Record the time it takes for Triton to report that all of its models are ready."""
+        try:
+            if self._http:
+                # pylint: disable-next=import-outside-toplevel  # the client is optional
+                import tritonclient.http as tritonclient
+
+                client = tritonclient.InferenceServerClient(_TRITON_HTTP_URL)
+            else:
+                # pylint: disable-next=import-outside-toplevel  # the client is optional
+                import tritonclient.grpc as tritonclient  # type: ignore[no-redef]
+
+                client = tritonclient.InferenceServerClient(_TRITON_GRPC_URL)
+        except ImportError:
+            _LOGGER.debug("Triton client is not installed, not watching for readiness.")
+            return
+
+        while proc.poll() is None:
+            try:
+                if client.is_server_ready():
+                    TIMELINE.record("triton_ready", start)
+                    return
+            # pylint: disable-next=broad-exception-caught; the server is not up yet
+            except Exception:
+                pass
+            time.sleep(_READINESS_POLL_SECONDS)
+
+    def _balancers(self) -> typing.List[LoadBalancer]:
+        """Create the load balancers that front the data parallel replicas."""
+        protocol, port = (
+            ("http", _TRITON_HTTP_PORT) if self._http else ("grpc", _TRITON_GRPC_PORT)
+        )
+        backends = [
+            ("127.0.0.1", replica_ports(replica)[protocol])
+            for replica in range(self._data_parallelism)
+        ]
+        bind = ("0.0.0.0", port)  # nosec; serving all interfaces is intended
+        return [LoadBalancer(bind, backends)]
+
+    def _run_replicas(self) -> int:
+        """Start independent triton servers on separate GPUs behind a load balancer.
+
+        Replicas only get connections while they report ready and are not drained. A replica that exits is dropped,
+        and the server exits once none are left.
+        """
+        procs: typing.List[subprocess.Popen] = []  # type: ignore[type-arg]
+        start = time.time()
+        try:
+            for replica in range(self._data_parallelism):
+                cmd = self.replica_cmd(replica)
+                env = self.replica_env(replica)
+                _LOGGER.debug(
+                    "Starting triton replica %d on GPUs %s with the command: %s",
+                    replica,
+                    env["CUDA_VISIBLE_DEVICES"],
+                    " ".join(cmd),
+                )
+                # pylint: disable-next=consider-using-with; the processes are cleaned up below
+                procs.append(subprocess.Popen(cmd, env=env))
+
+            balancers = self._replica_balancers = self._balancers()
+            start_balancers(balancers)
+
+            ready = [False] * len(procs)
+            retcodes: typing.Dict[int, int] = {}
+            all_ready = False
+            while len(retcodes) < len(procs):
+                for replica, proc in enumerate(procs):
+                    if replica in retcodes:
+                        continue
+                    retcode = proc.poll()
+                    if retcode is not None:
+                        retcodes[replica] = retcode
+                        _LOGGER.error(
+                            "Triton replica %d exited with code %d, %d replicas left.",
+                            replica,
+                            retcode,
+                            len(procs) - len(retcodes),
+                        )
+                    is_ready = (
+                        retcode is None
+                        and replica not in self._draining
+                        and replica_is_ready(replica)
+                    )
+                    if is_ready == ready[replica]:
+                        continue
+                    ready[replica] = is_ready
+                    if is_ready:
+                        self._ready.add(replica)
+                    else:
+                        self._ready.discard(replica)
+                    for balancer in balancers:
+                        balancer.set_available(replica, is_ready)
+                    if is_ready:
+                        _LOGGER.info("Triton replica %d is ready.", replica)
+                    elif retcode is None:
+                        _LOGGER.warning(
+                            "Triton replica %d is no longer ready.", replica
+                        )
+
+                if not all_ready and all(ready):
+                    all_ready = True
+                    TIMELINE.record("triton_ready", start)
+                time.sleep(_READINESS_POLL_SECONDS)
+            return max(retcodes.values())
+        except KeyboardInterrupt:
+            return 0
+        finally:
+            for proc in procs:
+                if proc.poll() is None:
+                    proc.kill()
+                proc.wait()
+
     def run(self) -> int:
         """Start the triton inference server."""
-        cmd = self._cmd
-        env = self._env
-
         _LOGGER.debug("Rendering the ensemble models.")
-        self._render_model_templates()
+        with TIMELINE.phase("render_templates"):
+            self.render_model_templates()
+            if self._extra_models:
+                compose_repository(
+                    self.triton_repository, self.model_repository, self._extra_models
+                )
 
+        if self._data_parallelism > 1:
+            return self._run_replicas()
+
+        cmd = self._cmd
+        env = self._env
         _LOGGER.debug("Starting triton with the command: %s", " ".join(cmd))
         _LOGGER.debug("Starting triton with the env vars: %s", repr(env))
+        start = time.time()
         with subprocess.Popen(cmd, env=env) as proc:
+            threading.Thread(
+                target=self._watch_readiness, args=(proc, start), daemon=True
+            ).start()
             try:
                 retcode = proc.wait()
             except KeyboardInterrupt:
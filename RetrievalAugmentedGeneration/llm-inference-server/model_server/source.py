@@ -0,0 +1,388 @@
+# SPDX-FileCopyrightText: Copyright (c) 2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""This module contains the logic for fetching model weights from remote storage.
+
+Supported sources are S3 compatible object stores (s3://bucket/prefix) and HTTP servers that publish a JSON file
+listing (https://host/path/manifest.json). Files are downloaded as parallel ranged reads directly into the model
+directory, which doubles as the local cache. Partial downloads are resumed on the next start, and checksums are
+verified incrementally as contiguous ranges land on disk.
+"""
+import abc
+import hashlib
+import json
+import logging
+import os
+import threading
+import typing
+from concurrent.futures import Future, ThreadPoolExecutor
+from dataclasses import asdict, dataclass
+from urllib.parse import urljoin, urlparse
+
+from .errors import ModelServerException
+
+SOURCE_MANIFEST_FILE = ".source-manifest.json"
+DEFAULT_CHUNK_SIZE = 16 * 1024 * 1024
+DEFAULT_WORKERS = 16
+_WRITE_BLOCK_SIZE = 1024 * 1024
+_LOGGER = logging.getLogger(__name__)
+
+
+@dataclass
+class RemoteObject:
+    """A single file in a remote model source."""
+
+    path: str
+    size: int
+    etag: str = ""
+    sha256: str = ""
+    md5: str = ""
+
+
+class ModelSource(abc.ABC):
+    """A remote location that model files can be downloaded from."""
+
+    @abc.abstractmethod
+    def list_objects(self) -> typing.List[RemoteObject]:
+        """Return all of the files in the source."""
+
+    @abc.abstractmethod
+    def read_range(
+        self, obj: RemoteObject, start: int, end: int
+    ) -> typing.Iterator[bytes]:
+        """Stream the bytes of a file from start up to, but not including, end."""
+
+
+class S3Source(ModelSource):
+    """A model stored under a prefix in an S3 compatible object store."""
+
+    def __init__(self, url: str, endpoint_url: typing.Optional[str] = None) -> None:
+        """Initialize the S3 source."""
+        # pylint: disable-next=import-outside-toplevel  # only required for s3 sources
+        import boto3
+
+        parsed = urlparse(url)
+        self._bucket = parsed.netloc
+        self._prefix = parsed.path.lstrip("/")
+        if self._prefix and not self._prefix.endswith("/"):
+            self._prefix += "/"
+        self._client = boto3.client(
+            "s3", endpoint_url=endpoint_url or os.environ.get("AWS_ENDPOINT_URL")
+        )
+
+    def list_objects(self) -> typing.List[RemoteObject]:
+        """Return all of the files under the prefix."""
+        objects = []
+        paginator = self._client.get_paginator("list_objects_v2")
+        for page in paginator.paginate(Bucket=self._bucket, Prefix=self._prefix):
+            for item in page.get("Contents", []):
+                if item["Key"].endswith("/"):
+                    continue
+                head = self._client.head_object(Bucket=self._bucket, Key=item["Key"])
+                etag = head["ETag"].strip('"')
+                objects.append(
+                    RemoteObject(
+                        path=item["Key"][len(self._prefix) :],
+                        size=head["ContentLength"],
+                        etag=etag,
+                        sha256=head.get("Metadata", {}).get("sha256", ""),
+                        # etags of single part uploads are the md5 of the object
+                        md5=etag if "-" not in etag else "",
+                    )
+                )
+        return objects
+
+    def read_range(
+        self, obj: RemoteObject, start: int, end: int
+    ) -> typing.Iterator[bytes]:
+        """Stream a byte range of an object."""
+        response = self._client.get_object(
+            Bucket=self._bucket,
+            Key=self._prefix + obj.path,
+            Range=f"bytes={start}-{end - 1}",
+            IfMatch=obj.etag,
+        )
+        yield from response["Body"].iter_chunks(_WRITE_BLOCK_SIZE)
+
+
+class HttpSource(ModelSource):
+    """A model published on an HTTP server alongside a JSON listing of its files.
+
+    The listing is a list of objects with path, size, and optionally sha256 keys. File paths are resolved relative to
+    the listing's URL.
+    """
+
+    def __init__(self, url: str) -> None:
+        """Initialize the HTTP source."""
+        # pylint: disable-next=import-outside-toplevel  # only required for http sources
+        import requests
+
+        self._url = url
+        self._session = requests.Session()
+        adapter = requests.adapters.HTTPAdapter(pool_maxsize=DEFAULT_WORKERS * 2)
+        self._session.mount("http://", adapter)
+        self._session.mount("https://", adapter)
+
+    def list_objects(self) -> typing.List[RemoteObject]:
+        """Download and parse the file listing."""
+        response = self._session.get(self._url, timeout=60)
+        response.raise_for_status()
+        return [
+            RemoteObject(
+                path=item["path"],
+                size=int(item["size"]),
+                etag=item.get("etag", ""),
+                sha256=item.get("sha256", ""),
+            )
+            for item in response.json()
+        ]
+
+    def read_range(
+        self, obj: RemoteObject, start: int, end: int
+    ) -> typing.Iterator[bytes]:
+        """Stream a byte range of a file."""
+        headers = {"Range": f"bytes={start}-{end - 1}"}
+        with self._session.get(
+            urljoin(self._url, obj.path), headers=headers, stream=True, timeout=60
+        ) as response:
+            response.raise_for_status()
+            if response.status_code != 206 and (start, end) != (0, obj.size):
+                raise ModelServerException(
+                    f"The server for {self._url} does not support ranged reads."
+                )
+            yield from response.iter_content(_WRITE_BLOCK_SIZE)
+
+
+def open_source(url: str, endpoint_url: typing.Optional[str] = None) -> ModelSource:
+    """Create the model source for a URL."""
+    scheme = urlparse(url).scheme
+    if scheme == "s3":
+        return S3Source(url, endpoint_url=endpoint_url)
+    if scheme in ("http", "https"):
+        return HttpSource(url)
+    raise ModelServerException(
+        f"Unsupported model source {url}. Supported schemes are s3, http, and https."
+    )
+
+
+class _FileDownload:
+    """The state of a single file being downloaded in parallel chunks."""
+
+    def __init__(self, obj: RemoteObject, dest: str, chunk_size: int) -> None:
+        """Initialize the download, picking up any partial progress from a previous attempt."""
+        self.obj = obj
+        self.dest = dest
+        self.part_path = f"{dest}.part"
+        self._state_path = f"{dest}.part.json"
+        self._chunk_size = chunk_size
+        self._lock = threading.Lock()
+        self._hashers = {
+            "sha256": hashlib.sha256(),
+            "md5": hashlib.md5(usedforsecurity=False),
+        }
+        self._hashed_chunks = 0
+
+        # an empty file has no chunks, a ranged read of zero bytes is not valid
+        chunk_count = -(-obj.size // chunk_size)
+        self.chunks = [
+            (idx * chunk_size, min((idx + 1) * chunk_size, obj.size))
+            for idx in range(chunk_count)
+        ]
+        self.done = self._read_state()
+        if not os.path.exists(self.part_path):
+            self.done = set()
+        with open(self.part_path, "ab") as part_file:
+            part_file.truncate(obj.size)
+        self._advance_hash()
+
+    def _read_state(self) -> typing.Set[int]:
+        """Read the chunks completed by a previous attempt for the same remote file."""
+        try:
+            with open(self._state_path, "r", encoding="UTF-8") as state_file:
+                state = json.load(state_file)
+        except (OSError, ValueError):
+            return set()
+        if (
+            state.get("object") != asdict(self.obj)
+            or state.get("chunk_size") != self._chunk_size
+        ):
+            return set()
+        return set(state.get("done", []))
+
+    def _write_state(self) -> None:
+        """Record the completed chunks so the download can be resumed."""
+        state = {
+            "object": asdict(self.obj),
+            "chunk_size": self._chunk_size,
+            "done": sorted(self.done),
+        }
+        with open(self._state_path, "w", encoding="UTF-8") as state_file:
+            json.dump(state, state_file)
+
+    def _advance_hash(self) -> None:
+        """Hash the contiguous run of completed chunks that has not been hashed yet."""
+        if (
+            self._hashed_chunks >= len(self.chunks)
+            or self._hashed_chunks not in self.done
+        ):
+            return
+        with open(self.part_path, "rb") as part_file:
+            while self._hashed_chunks in self.done:
+                start, end = self.chunks[self._hashed_chunks]
+                part_file.seek(start)
+                remaining = end - start
+                while remaining:
+                    block = part_file.read(min(_WRITE_BLOCK_SIZE, remaining))
+                    for hasher in self._hashers.values():
+                        hasher.update(block)
+                    remaining -= len(block)
+                self._hashed_chunks += 1
+
+    def fetch_chunk(self, source: ModelSource, idx: int) -> None:
+        """Download one chunk into its place in the partial file."""
+        start, end = self.chunks[idx]
+        offset = start
+        fd = os.open(self.part_path, os.O_WRONLY)
+        try:
+            for block in source.read_range(self.obj, start, end):
+                os.pwrite(fd, block, offset)
+                offset += len(block)
+        finally:
+            os.close(fd)
+        if offset != end:
+            raise ModelServerException(
+                f"Short read for {self.obj.path}: expected {end - start} bytes, got {offset - start}."
+            )
+
+        with self._lock:
+            self.done.add(idx)
+            self._write_state()
+            self._advance_hash()
+
+    def finish(self) -> None:
+        """Verify the checksums and move the file into place."""
+        for name in ("sha256", "md5"):
+            expected = getattr(self.obj, name)
+            actual = self._hashers[name].hexdigest()
+            if expected and expected != actual:
+                os.remove(self.part_path)
+                self._remove_state()
+                raise ModelServerException(
+                    f"Checksum mismatch for {self.obj.path}: expected {name} {expected}, got {actual}."
+                )
+        os.replace(self.part_path, self.dest)
+        self._remove_state()
+
+    def _remove_state(self) -> None:
+        """Remove the resume state, which files without chunks never write."""
+        if os.path.exists(self._state_path):
+            os.remove(self._state_path)
+
+
+def _read_source_manifest(
+    dest_dir: str,
+) -> typing.Dict[str, typing.Dict[str, typing.Any]]:
+    """Read the record of files that were already downloaded into the model directory."""
+    try:
+        with open(
+            os.path.join(dest_dir, SOURCE_MANIFEST_FILE), "r", encoding="UTF-8"
+        ) as manifest:
+            return typing.cast(
+                typing.Dict[str, typing.Dict[str, typing.Any]], json.load(manifest)
+            )
+    except (OSError, ValueError):
+        return {}
+
+
+def _write_source_manifest(
+    dest_dir: str, files: typing.Dict[str, typing.Dict[str, typing.Any]]
+) -> None:
+    """Record the files that have been downloaded into the model directory."""
+    tmp_path = os.path.join(dest_dir, f"{SOURCE_MANIFEST_FILE}.tmp")
+    with open(tmp_path, "w", encoding="UTF-8") as manifest:
+        json.dump(files, manifest, indent=1, sort_keys=True)
+    os.replace(tmp_path, os.path.join(dest_dir, SOURCE_MANIFEST_FILE))
+
+
+def _local_path(dest_dir: str, remote_path: str) -> str:
+    """Return where a remote file is stored, refusing paths that lead out of the model directory."""
+    root = os.path.realpath(dest_dir)
+    path = os.path.realpath(os.path.join(root, remote_path))
+    if os.path.isabs(remote_path) or os.path.commonpath([root, path]) != root:
+        raise ModelServerException(
+            f"Refusing to download {remote_path!r} outside of the model directory."
+        )
+    return path
+
+
+def _is_cached(
+    dest_dir: str,
+    obj: RemoteObject,
+    known: typing.Dict[str, typing.Dict[str, typing.Any]],
+) -> bool:
+    """Determine if a remote file is already present in the model directory."""
+    path = _local_path(dest_dir, obj.path)
+    return (
+        known.get(obj.path) == asdict(obj)
+        and os.path.isfile(path)
+        and os.path.getsize(path) == obj.size
+    )
+
+
+def fetch_model(
+    source: ModelSource,
+    dest_dir: str,
+    workers: int = DEFAULT_WORKERS,
+    chunk_size: int = DEFAULT_CHUNK_SIZE,
+) -> None:
+    """Download every file from the source into the destination directory."""
+    objects = source.list_objects()
+    known = _read_source_manifest(dest_dir)
+    pending = [obj for obj in objects if not _is_cached(dest_dir, obj, known)]
+    _LOGGER.info(
+        "Model source has %d files, %d need to be downloaded (%d bytes).",
+        len(objects),
+        len(pending),
+        sum(obj.size for obj in pending),
+    )
+
+    downloads = []
+    for obj in pending:
+        dest = _local_path(dest_dir, obj.path)
+        os.makedirs(os.path.dirname(dest), exist_ok=True)
+        downloads.append(_FileDownload(obj, dest, chunk_size))
+
+    with ThreadPoolExecutor(max_workers=workers) as pool:
+        futures: typing.List[Future[None]] = [
+            pool.submit(download.fetch_chunk, source, idx)
+            for download in downloads
+            for idx in range(len(download.chunks))
+            if idx not in download.done
+        ]
+        try:
+            for future in futures:
+                future.result()
+        except Exception as err:
+            for future in futures:
+                future.cancel()
+            raise ModelServerException(
+                "Unable to download the model. The download will resume on the next start."
+            ) from err
+
+    for download in downloads:
+        download.finish()
+        known[download.obj.path] = asdict(download.obj)
+        _LOGGER.debug("Downloaded %s.", download.obj.path)
+    _write_source_manifest(dest_dir, known)
@@ -0,0 +1,193 @@
+# SPDX-FileCopyrightText: Copyright (c) 2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""This module records how long each phase of the model server's startup takes.
+
+Every completed phase is logged as a single line JSON event on the model_server.timeline logger and the full
+timeline is rewritten to a Prometheus text format metrics file, so it can be collected by the node exporter's
+textfile collector or simply read from the container.
+"""
+import contextlib
+import json
+import logging
+import os
+import resource
+import threading
+import time
+import typing
+from dataclasses import asdict, dataclass
+
+METRICS_FILE_ENV = "MODEL_SERVER_METRICS_FILE"
+DEFAULT_METRICS_FILE = "/tmp/model_server_startup.prom"  # nosec; not a secret location
+_CLEAR_REFS = "/proc/self/clear_refs"
+_STATUS = "/proc/self/status"
+_LOGGER = logging.getLogger(__name__)
+
+
+@dataclass
+class Phase:
+    """A single completed startup phase."""
+
+    name: str
+    start: float
+    seconds: float
+    peak_rss_bytes: int
+    children_peak_rss_bytes: int
+
+
+def _reset_peak_rss() -> bool:
+    """Reset the kernel's peak RSS counter for this process, returning whether it is supported."""
+    try:
+        with open(_CLEAR_REFS, "w", encoding="ASCII") as clear_refs:
+            clear_refs.write("5")
+        return True
+    except OSError:
+        return False
+
+
+def _peak_rss() -> int:
+    """Return the peak RSS of this process, in bytes, since the counter was last reset."""
+    try:
+        with open(_STATUS, "r", encoding="ASCII") as status:
+            for line in status:
+                if line.startswith("VmHWM:"):
+                    return int(line.split()[1]) * 1024
+    except OSError:
+        pass
+    return resource.getrusage(resource.RUSAGE_SELF).ru_maxrss * 1024
+
+
+def _children_peak_rss() -> int:
+    """Return the largest peak RSS of any child process that has been waited on, in bytes."""
+    return resource.getrusage(resource.RUSAGE_CHILDREN).ru_maxrss * 1024
+
+
+class Timeline:
+    """The phases of the model server's startup."""
+
+    def __init__(self) -> None:
+        """Initialize the timeline."""
+        self._phases: typing.List[Phase] = []
+        # the running peak RSS of each phase that is in progress, innermost last
+        self._active_peaks: typing.List[int] = []
+        self._lock = threading.Lock()
+        self._started = time.time()
+        # functions returning additional metrics lines, such as the progress of a running conversion
+        self._collectors: typing.List[typing.Callable[[], typing.List[str]]] = []
+        self.metrics_file: typing.Optional[str] = os.environ.get(
+            METRICS_FILE_ENV, DEFAULT_METRICS_FILE
+        )
+
+    @property
+    def phases(self) -> typing.List[Phase]:
+        """Return the completed phases in the order they finished."""
+        with self._lock:
+            return list(self._phases)
+
+    def _fold_peak(self) -> int:
+        """Fold the current peak RSS into every phase in progress and return it."""
+        peak = _peak_rss()
+        self._active_peaks = [max(active, peak) for active in self._active_peaks]
+        return peak
+
+    @contextlib.contextmanager
+    def phase(self, name: str) -> typing.Iterator[None]:
+        """Time the enclosed block as a startup phase. Phases may be nested."""
+        with self._lock:
+            self._fold_peak()
+            _reset_peak_rss()
+            self._active_peaks.append(0)
+        start = time.time()
+        try:
+            yield
+        finally:
+            with self._lock:
+                self._fold_peak()
+                peak = self._active_peaks.pop()
+            self.record(name, start, peak)
+
+    def record(
+        self, name: str, start: float, peak_rss_bytes: typing.Optional[int] = None
+    ) -> Phase:
+        """Record a phase that started at the given time and has just finished."""
+        phase = Phase(
+            name=name,
+            start=start,
+            seconds=time.time() - start,
+            peak_rss_bytes=peak_rss_bytes or _peak_rss(),
+            children_peak_rss_bytes=_children_peak_rss(),
+        )
+        with self._lock:
+            self._phases.append(phase)
+        _LOGGER.info(json.dumps({"event": "startup_phase", **asdict(phase)}))
+        self.write_metrics()
+        return phase
+
+    def add_collector(self, collector: typing.Callable[[], typing.List[str]]) -> None:
+        """Include the lines returned by the collector in the metrics file."""
+        with self._lock:
+            self._collectors.append(collector)
+
+    def remove_collector(
+        self, collector: typing.Callable[[], typing.List[str]]
+    ) -> None:
+        """Stop including the lines of a collector in the metrics file."""
+        with self._lock:
+            self._collectors.remove(collector)
+
+    def write_metrics(self) -> None:
+        """Write the timeline to the metrics file in the Prometheus text format."""
+        if not self.metrics_file:
+            return
+
+        lines = [
+            "# HELP model_server_startup_phase_seconds Wall time spent in each startup phase.",
+            "# TYPE model_server_startup_phase_seconds gauge",
+        ]
+        lines += [
+            f'model_server_startup_phase_seconds{{phase="{p.name}"}} {p.seconds:.3f}'
+            for p in self.phases
+        ]
+        lines += [
+            "# HELP model_server_startup_phase_peak_rss_bytes Peak RSS of the model server during each phase.",
+            "# TYPE model_server_startup_phase_peak_rss_bytes gauge",
+        ]
+        lines += [
+            f'model_server_startup_phase_peak_rss_bytes{{phase="{p.name}"}} {p.peak_rss_bytes}'
+            for p in self.phases
+        ]
+        lines += [
+            "# HELP model_server_startup_children_peak_rss_bytes Largest peak RSS of any finished child process.",
+            "# TYPE model_server_startup_children_peak_rss_bytes gauge",
+            f"model_server_startup_children_peak_rss_bytes {_children_peak_rss()}",
+            "# HELP model_server_startup_seconds Wall time since the model server started.",
+            "# TYPE model_server_startup_seconds gauge",
+            f"model_server_startup_seconds {time.time() - self._started:.3f}",
+        ]
+        with self._lock:
+            collectors = list(self._collectors)
+        for collector in collectors:
+            lines += collector()
+
+        tmp_path = f"{self.metrics_file}.tmp"
+        try:
+            with open(tmp_path, "w", encoding="UTF-8") as metrics:
+                metrics.write("\n".join(lines) + "\n")
+            os.replace(tmp_path, self.metrics_file)
+        except OSError as err:
+            _LOGGER.debug("Unable to write the startup metrics file: %s", err)
+
+
+TIMELINE = Timeline()
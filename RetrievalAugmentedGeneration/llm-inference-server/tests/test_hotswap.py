@@ -0,0 +1,296 @@
+# SPDX-FileCopyrightText: Copyright (c) 2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Tests for swapping engines into Triton servers, using stub Triton clients."""
+import os
+import types
+import typing
+
+import pytest
+
+from model_server import hotswap
+from model_server.hotswap import TRTLLM_MODEL_NAME, EngineUpdates, HotSwapController
+
+
+class StubTriton:
+    """A Triton client that serves the version rendered into the model repository when it loads the model."""
+
+    def __init__(
+        self,
+        server: "StubServer",
+        replica: int,
+        fail_versions: typing.Sequence[int] = (),
+    ):
+        self.server = server
+        self.replica = replica
+        self.fail_versions = set(fail_versions)
+        self.calls: typing.List[typing.Tuple[str, typing.Any]] = []
+        self.version: typing.Optional[int] = 1
+        self.engine: typing.Optional[str] = server.rendered
+
+    def load_model(self, name: str) -> None:
+        assert name == TRTLLM_MODEL_NAME
+        assert (
+            self.replica in self.server.drained
+        ), "loading on a replica that is not drained"
+        latest = max(server_versions(self.server))
+        self.calls.append(("load", latest))
+        if latest in self.fail_versions:
+            self.version = None
+            raise RuntimeError(f"failed to load version {latest}")
+        self.version, self.engine = latest, self.server.rendered
+
+    def unload_model(self, name: str) -> None:
+        assert (
+            self.replica in self.server.drained
+        ), "unloading on a replica that is not drained"
+        self.calls.append(("unload", self.version))
+        self.version = None
+
+    def is_model_ready(self, name: str, version: str = "") -> bool:
+        if self.version is None:
+            return False
+        return not version or int(version) == self.version
+
+
+def server_versions(server: "StubServer") -> typing.List[int]:
+    model_dir = os.path.join(server.model_repository, TRTLLM_MODEL_NAME)
+    return [int(name) for name in os.listdir(model_dir) if name.isdigit()]
+
+
+class StubServer:
+    """The parts of ModelServer the controller uses."""
+
+    def __init__(self, repository: str, replicas: int) -> None:
+        self.model_repository = repository
+        self.http = False
+        self.control_urls = [f"localhost:{9001 + 3 * idx}" for idx in range(replicas)]
+        self.rendered = "/engines/old"
+
+        self.events: typing.List[typing.Tuple[str, int]] = []
+        self.drained: typing.Set[int] = set()
+        self.refuse_drain = False
+
+    def render_model_templates(self, engine_dir: str) -> None:
+        self.rendered = engine_dir
+
+    def drain(self, replica: int, timeout: float) -> None:
+        if self.refuse_drain:
+            raise RuntimeError("no other replica is ready")
+        self.events.append(("drain", replica))
+        self.drained.add(replica)
+
+    def resume(self, replica: int) -> None:
+        self.events.append(("resume", replica))
+        self.drained.discard(replica)
+
+
+@pytest.fixture(name="controller")
+def fixture_controller(tmp_path, monkeypatch):
+    """Return a factory of controllers over replicas serving version 1 of /engines/old."""
+    monkeypatch.setattr(hotswap, "_POLL_SECONDS", 0)
+    monkeypatch.setattr(hotswap, "_LOAD_TIMEOUT_SECONDS", 0.05)
+    os.makedirs(tmp_path / TRTLLM_MODEL_NAME / "1")
+
+    def _create(
+        fail_versions: typing.Sequence[int] = (),
+        updates: typing.Callable[[], typing.Optional[str]] = lambda: None,
+        replicas: int = 2,
+    ):
+        server = StubServer(str(tmp_path), replicas=replicas)
+        clients = {
+            url: StubTriton(server, replica, fail_versions)
+            for replica, url in enumerate(server.control_urls)
+        }
+        model = types.SimpleNamespace(engine_dir="/engines/old")
+        ctrl = HotSwapController(
+            server, model, updates, client_factory=lambda url, http: clients[url]
+        )
+        return ctrl, server, list(clients.values())
+
+    return _create
+
+
+def test_swap(controller, tmp_path):
+    ctrl, server, clients = controller()
+    assert ctrl.swap("/engines/new")
+
+    for client in clients:
+        # the old engine is unloaded before the new one is loaded
+        assert client.calls == [("unload", 1), ("load", 2)]
+        assert client.version == 2 and client.engine == "/engines/new"
+    # each replica is drained and swapped while the other one serves
+    assert server.events == [("drain", 0), ("resume", 0), ("drain", 1), ("resume", 1)]
+    assert sorted(os.listdir(tmp_path / TRTLLM_MODEL_NAME)) == ["2"]
+    assert server.rendered == "/engines/new"
+
+
+def test_swap_rolls_back(controller, tmp_path):
+    ctrl, server, clients = controller(fail_versions=[2])
+    assert not ctrl.swap("/engines/new")
+
+    # the first replica failed and loads version 1 again, the second one was never touched
+    assert clients[0].calls == [
+        ("unload", 1),
+        ("load", 2),
+        ("unload", None),
+        ("load", 1),
+    ]
+    assert not clients[1].calls
+    for client in clients:
+        assert client.version == 1 and client.engine == "/engines/old"
+    assert ("drain", 1) not in server.events and not server.drained
+    assert sorted(os.listdir(tmp_path / TRTLLM_MODEL_NAME)) == ["1"]
+    assert server.rendered == "/engines/old"
+
+
+def test_swap_rolls_back_swapped_replicas_only(controller, monkeypatch):
+    ctrl, server, clients = controller(replicas=3)
+    # the second replica fails to load the new engine
+    load = StubTriton.load_model
+
+    def failing_load(self, name):
+        if self.replica == 1 and max(server_versions(server)) == 2:
+            self.calls.append(("load", 2))
+            self.version = None
+            raise RuntimeError("out of memory")
+        load(self, name)
+
+    monkeypatch.setattr(StubTriton, "load_model", failing_load)
+    assert not ctrl.swap("/engines/new")
+
+    # the swapped replica unloads the new engine before the old one is loaded next to it
+    assert clients[0].calls == [("unload", 1), ("load", 2), ("unload", 2), ("load", 1)]
+    assert clients[1].calls == [
+        ("unload", 1),
+        ("load", 2),
+        ("unload", None),
+        ("load", 1),
+    ]
+    assert not clients[2].calls
+    for client in clients:
+        assert client.version == 1 and client.engine == "/engines/old"
+    assert not server.drained
+
+
+def test_swap_waits_for_a_replica_to_drain(controller):
+    ctrl, server, clients = controller()
+    server.refuse_drain = True
+    # a replica that cannot be drained is not unloaded
+    assert not ctrl.swap("/engines/new")
+    for client in clients:
+        assert not client.calls and client.version == 1
+    assert server.rendered == "/engines/old"
+
+
+def test_swap_rolls_back_when_not_ready(controller, monkeypatch):
+    ctrl, _, clients = controller()
+    monkeypatch.setattr(StubTriton, "is_model_ready", lambda *_: False)
+    # a server that never unloads or becomes ready times out instead of blocking the controller
+    assert not ctrl.swap("/engines/new")
+    assert clients[0].engine == "/engines/old"
+
+
+def test_check(controller):
+    engines = ["/engines/old", "/engines/new"]
+    ctrl, server, _ = controller(updates=lambda: engines.pop(0) if engines else None)
+
+    ctrl.check()  # the current engine is not swapped again
+    assert server.rendered == "/engines/old"
+    ctrl.check()
+    assert server.rendered == "/engines/new"
+    ctrl.check()  # nothing changed
+    assert server.rendered == "/engines/new"
+
+
+OPTS = types.SimpleNamespace(cache_key_fields=dict)
+
+
+class StubModel:
+    """The parts of Model the update detector uses, with an engine cache entry per weights hash."""
+
+    def __init__(self, cache: str) -> None:
+        self.cache = cache
+        self.hash = "old"
+        self.format = "HFACE"
+        self.engine_dir = self.select_engine({})
+
+    def refresh_hash(self) -> None:
+        pass
+
+    def select_engine(self, _) -> str:
+        self.engine_dir = os.path.join(self.cache, f"trt-{self.hash}")
+        os.makedirs(self.engine_dir, exist_ok=True)
+        return self.engine_dir
+
+    def conversion_is_needed(self) -> bool:
+        return not os.path.isfile(os.path.join(self.engine_dir, "hash"))
+
+    def adopt_engine(self, engine_dir: str, model_format: str) -> None:
+        self.engine_dir, self.format = engine_dir, model_format
+
+
+def test_weights_update(tmp_path, monkeypatch):
+    model = StubModel(str(tmp_path))
+    builds: typing.List[typing.Optional[str]] = []
+
+    def convert(model, _):
+        builds.append(os.environ.get("CUDA_VISIBLE_DEVICES"))
+        with open(os.path.join(model.engine_dir, "hash"), "w", encoding="ASCII") as f:
+            f.write(model.hash)
+
+    monkeypatch.setattr(hotswap, "convert", convert)
+    monkeypatch.setenv("CUDA_VISIBLE_DEVICES", "0,1,2")
+    updates = EngineUpdates(model, OPTS, build_devices=["2"])
+
+    assert updates() is None
+    model.hash = "new"
+    assert updates() == str(tmp_path / "trt-new")
+    # the engine is built on the GPU that no replica serves on
+    assert builds == ["2"] and os.environ["CUDA_VISIBLE_DEVICES"] == "0,1,2"
+
+
+def test_weights_update_failure(tmp_path, monkeypatch):
+    model = StubModel(str(tmp_path))
+    builds: typing.List[str] = []
+
+    def convert(model, _):
+        builds.append(model.hash)
+        raise RuntimeError("out of memory")
+
+    monkeypatch.setattr(hotswap, "convert", convert)
+    updates = EngineUpdates(model, OPTS, build_devices=["2"])
+
+    model.hash = "new"
+    with pytest.raises(RuntimeError):
+        updates()
+    # the partial engine is removed and the served one is kept
+    assert sorted(os.listdir(tmp_path)) == ["trt-old"]
+    assert model.engine_dir == str(tmp_path / "trt-old")
+
+    # the same weights are not built again
+    assert updates() is None and builds == ["new"]
+    assert sorted(os.listdir(tmp_path)) == ["trt-old"]
+    model.hash = "newer"
+    with pytest.raises(RuntimeError):
+        updates()
+    assert builds == ["new", "newer"]
+
+
+def test_weights_not_watched_without_build_devices(tmp_path, monkeypatch):
+    model = StubModel(str(tmp_path))
+    monkeypatch.setattr(hotswap, "convert", lambda *_: pytest.fail("converted"))
+    model.hash = "new"
+    assert EngineUpdates(model, OPTS)() is None
@@ -0,0 +1,142 @@
+# SPDX-FileCopyrightText: Copyright (c) 2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Tests for the Triton launch commands of data parallel replicas, which do not need GPUs."""
+import types
+
+import pytest
+
+from model_server import server as server_module
+from model_server.balancer import LoadBalancer
+from model_server.errors import ModelServerException
+from model_server.model import ModelFormats
+from model_server.server import (
+    ModelServer,
+    mpi_command,
+    replica_env,
+    replica_ports,
+    triton_server_args,
+)
+
+
+def _flag(args, name):
+    return args[args.index(name) + 1]
+
+
+def test_replica_ports_do_not_overlap():
+    ports = [port for replica in range(8) for port in replica_ports(replica).values()]
+    assert len(ports) == len(set(ports))
+
+
+def test_single_server_args():
+    args = triton_server_args(1, "/repo", http=False)
+    assert _flag(args, "--allow-http") == "false"
+    assert _flag(args, "--allow-grpc") == "true"
+    assert _flag(args, "--model-repository") == "/repo"
+    assert "--http-port" not in args
+    assert args[-1] == "--backend-config=python,shm-region-prefix-name=prefix1_"
+
+
+def test_replica_server_args():
+    args = triton_server_args(0, "/repo", http=False, replica=2)
+    ports = replica_ports(2)
+    # replicas always serve http, it is polled for readiness
+    assert _flag(args, "--allow-http") == "true"
+    assert _flag(args, "--http-port") == str(ports["http"])
+    assert _flag(args, "--grpc-port") == str(ports["grpc"])
+    assert _flag(args, "--metrics-port") == str(ports["metrics"])
+    assert args[-1].endswith("shm-region-prefix-name=replica2_prefix0_")
+
+
+def test_mpi_command():
+    cmd = mpi_command([["--a"], ["--b"]])
+    assert cmd[0].endswith("mpirun")
+    assert cmd.count(":") == 2
+    assert cmd[1:4] == ["-n", "1", cmd[3]] and cmd[3].endswith("tritonserver")
+    assert cmd.index("--a") < cmd.index("--b")
+
+
+def test_replica_env():
+    env = {"PATH": "/bin", "CUDA_VISIBLE_DEVICES": "4,5,6,7"}
+    assert replica_env(env, 1, 2, 8)["CUDA_VISIBLE_DEVICES"] == "6,7"
+    assert replica_env({}, 3, 1, 4)["CUDA_VISIBLE_DEVICES"] == "3"
+    assert replica_env(env, 0, 2, 8)["PATH"] == "/bin"
+    # the server's environment is not modified
+    assert env["CUDA_VISIBLE_DEVICES"] == "4,5,6,7"
+
+
+def test_model_server_replica_cmd():
+    model = types.SimpleNamespace(
+        world_size=2, gpu_count=4, family="llama", format=ModelFormats.HUGGINGFACE
+    )
+    server = ModelServer(model, data_parallelism=2, explicit_model_control=True)
+
+    cmd = server.replica_cmd(1)
+    assert cmd.count(":") == 2
+    assert cmd.count("--http-port") == 2
+    http_ports = {cmd[idx + 1] for idx, arg in enumerate(cmd) if arg == "--http-port"}
+    assert http_ports == {str(replica_ports(1)["http"])}
+    assert "--model-control-mode=explicit" in cmd
+    assert server.control_urls == [
+        f"localhost:{replica_ports(0)['grpc']}",
+        f"localhost:{replica_ports(1)['grpc']}",
+    ]
+
+
+def test_balancer_skips_unavailable_backends():
+    backends = [("127.0.0.1", 9001), ("127.0.0.1", 9004)]
+    balancer = LoadBalancer(("127.0.0.1", 8001), backends)
+    # pylint: disable=protected-access
+    assert not balancer._ranked_backends()
+
+    balancer.set_available(1, True)
+    assert balancer._ranked_backends() == [backends[1]]
+    balancer.set_available(0, True)
+    assert sorted(balancer._ranked_backends()) == backends
+    balancer.set_available(1, False)
+    assert balancer._ranked_backends() == [backends[0]]
+
+
+def test_drain(monkeypatch):
+    monkeypatch.setattr(server_module, "_DRAIN_POLL_SECONDS", 0)
+    model = types.SimpleNamespace(
+        world_size=1, gpu_count=2, family="llama", format=ModelFormats.HUGGINGFACE
+    )
+    server = ModelServer(model, data_parallelism=2, explicit_model_control=True)
+    backends = [("127.0.0.1", 9001), ("127.0.0.1", 9004)]
+    balancer = LoadBalancer(("127.0.0.1", 8001), backends)
+    # pylint: disable=protected-access
+    server._replica_balancers = [balancer]
+    balancer.set_available(0, True)
+    balancer.set_available(1, True)
+
+    # a replica is only drained while another one serves
+    server._ready = {0}
+    with pytest.raises(ModelServerException, match="no other replica"):
+        server.drain(0, timeout=1)
+    server._ready = {0, 1}
+
+    # open connections that do not finish in time give the replica back
+    balancer._open[backends[0]] = 1
+    with pytest.raises(ModelServerException, match="still open"):
+        server.drain(0, timeout=0)
+    assert not server._draining
+
+    balancer._open[backends[0]] = 0
+    server.drain(0, timeout=1)
+    assert balancer._ranked_backends() == [backends[1]]
+    assert server._draining == {0}
+    server.resume(0)
+    assert not server._draining
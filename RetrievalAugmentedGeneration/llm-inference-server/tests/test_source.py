@@ -0,0 +1,175 @@
+# SPDX-FileCopyrightText: Copyright (c) 2023 NVIDIA CORPORATION & AFFILIATES. All rights reserved.
+# SPDX-License-Identifier: Apache-2.0
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+# http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+
+"""Tests for fetching models from remote storage.
+
+The S3 tests run against an in-process S3 stub. To run them against a local MinIO instead, set
+MODEL_SERVER_TEST_S3_ENDPOINT to its URL along with AWS_ACCESS_KEY_ID and AWS_SECRET_ACCESS_KEY.
+"""
+import hashlib
+import os
+import typing
+import uuid
+
+import pytest
+
+from model_server.errors import ModelServerException
+from model_server.source import (
+    SOURCE_MANIFEST_FILE,
+    ModelSource,
+    RemoteObject,
+    S3Source,
+    fetch_model,
+)
+
+_CHUNK_SIZE = 1024
+_FILES = {
+    "config.json": b'{"model_type": "llama"}',
+    "empty.txt": b"",
+    "weights/model.safetensors": os.urandom(5 * _CHUNK_SIZE + 17),
+}
+
+
+class MemorySource(ModelSource):
+    """A model source serving files from memory, optionally failing on some ranges."""
+
+    def __init__(self, files: typing.Dict[str, bytes]) -> None:
+        self.files = files
+        self.reads: typing.List[typing.Tuple[str, int, int]] = []
+        self.fail_at: typing.Optional[int] = None
+
+    def list_objects(self) -> typing.List[RemoteObject]:
+        return [
+            RemoteObject(
+                path=path, size=len(data), sha256=hashlib.sha256(data).hexdigest()
+            )
+            for path, data in self.files.items()
+        ]
+
+    def read_range(
+        self, obj: RemoteObject, start: int, end: int
+    ) -> typing.Iterator[bytes]:
+        assert 0 <= start < end <= obj.size, "invalid range"
+        if self.fail_at is not None and start == self.fail_at:
+            raise OSError("connection reset")
+        self.reads.append((obj.path, start, end))
+        yield self.files[obj.path][start:end]
+
+
+def _assert_fetched(dest: str, files: typing.Dict[str, bytes]) -> None:
+    for path, data in files.items():
+        with open(os.path.join(dest, path), "rb") as fetched:
+            assert fetched.read() == data
+    leftovers = [name for _, _, names in os.walk(dest) for name in names]
+    assert not [name for name in leftovers if name.endswith((".part", ".part.json"))]
+
+
+def test_fetch_model(tmp_path):
+    source = MemorySource(_FILES)
+    fetch_model(source, str(tmp_path), workers=4, chunk_size=_CHUNK_SIZE)
+
+    _assert_fetched(str(tmp_path), _FILES)
+    assert os.path.isfile(tmp_path / SOURCE_MANIFEST_FILE)
+    # the empty file is created without reading from the source
+    assert not [read for read in source.reads if read[0] == "empty.txt"]
+
+
+def test_fetch_model_skips_cached_files(tmp_path):
+    fetch_model(MemorySource(_FILES), str(tmp_path), chunk_size=_CHUNK_SIZE)
+    source = MemorySource(_FILES)
+    fetch_model(source, str(tmp_path), chunk_size=_CHUNK_SIZE)
+    assert not source.reads
+
+
+def test_fetch_model_resumes(tmp_path):
+    source = MemorySource(_FILES)
+    source.fail_at = 3 * _CHUNK_SIZE
+    with pytest.raises(ModelServerException):
+        fetch_model(source, str(tmp_path), workers=1, chunk_size=_CHUNK_SIZE)
+
+    source.fail_at = None
+    source.reads.clear()
+    fetch_model(source, str(tmp_path), workers=1, chunk_size=_CHUNK_SIZE)
+    _assert_fetched(str(tmp_path), _FILES)
+    # only the chunks that did not complete are read again
+    weights = [start for path, start, _ in source.reads if path.startswith("weights")]
+    assert 0 not in weights and 3 * _CHUNK_SIZE in weights
+
+
+def test_fetch_model_checksum_mismatch(tmp_path):
+    source = MemorySource(_FILES)
+    listing = source.list_objects()
+    listing[0].sha256 = "0" * 64
+    source.list_objects = lambda: listing  # type: ignore[method-assign]
+
+    with pytest.raises(ModelServerException, match="Checksum mismatch"):
+        fetch_model(source, str(tmp_path), chunk_size=_CHUNK_SIZE)
+    assert not os.path.exists(tmp_path / "config.json")
+
+
+@pytest.mark.parametrize(
+    "path", ["../escaped.txt", "weights/../../escaped.txt", "/tmp/escaped.txt"]
+)
+def test_fetch_model_rejects_paths_outside_dest(tmp_path, path):
+    dest = tmp_path / "model"
+    dest.mkdir()
+    source = MemorySource({path: b"data"})
+
+    with pytest.raises(ModelServerException, match="outside of the model directory"):
+        fetch_model(source, str(dest), chunk_size=_CHUNK_SIZE)
+    assert not source.reads
+    assert not os.path.exists(tmp_path / "escaped.txt")
+
+
+@pytest.fixture(name="s3_bucket")
+def fixture_s3_bucket(monkeypatch):
+    """Yield the endpoint and name of a bucket holding _FILES under the model/ prefix."""
+    boto3 = pytest.importorskip("boto3")
+    endpoint = os.environ.get("MODEL_SERVER_TEST_S3_ENDPOINT")
+    if endpoint:
+        context: typing.Any = None
+    else:
+        moto = pytest.importorskip("moto")
+        monkeypatch.setenv("AWS_ACCESS_KEY_ID", "testing")
+        monkeypatch.setenv("AWS_SECRET_ACCESS_KEY", "testing")
+        monkeypatch.setenv("AWS_DEFAULT_REGION", "us-east-1")
+        context = moto.mock_aws()
+        context.start()
+
+    bucket = f"model-server-test-{uuid.uuid4().hex[:8]}"
+    client = boto3.client("s3", endpoint_url=endpoint)
+    client.create_bucket(Bucket=bucket)
+    for path, data in _FILES.items():
+        client.put_object(Bucket=bucket, Key=f"model/{path}", Body=data)
+    yield endpoint, bucket
+
+    for path in _FILES:
+        client.delete_object(Bucket=bucket, Key=f"model/{path}")
+    client.delete_bucket(Bucket=bucket)
+    if context is not None:
+        context.stop()
+
+
+def test_s3_source(s3_bucket, tmp_path):
+    endpoint, bucket = s3_bucket
+    source = S3Source(f"s3://{bucket}/model", endpoint_url=endpoint)
+
+    objects = {obj.path: obj for obj in source.list_objects()}
+    assert sorted(objects) == sorted(_FILES)
+    # single part uploads carry their md5 in the etag
+    assert objects["config.json"].md5 == hashlib.md5(_FILES["config.json"]).hexdigest()
+
+    fetch_model(source, str(tmp_path), workers=4, chunk_size=_CHUNK_SIZE)
+    _assert_fetched(str(tmp_path), _FILES)
@@ -29,6 +29,12 @@ import (
 type HelmPipelineSpec struct {
 	// Orchard: A planned and managed group of Helm trees.
 	Pipeline helmer.Pipeline `json:"pipeline"`
+	// Parallelism limits how many packages are installed at the same time,
+	// packages are only installed concurrently if they do not depend on each other.
+	// +kubebuilder:validation:Optional
+	// +kubebuilder:validation:Minimum=1
+	// +kubebuilder:default=1
+	Parallelism int `json:"parallelism,omitempty"`
 	// +kubebuilder:validation:Optional
 	ManagementState operatorv1.ManagementState `json:"managementState,omitempty"` // INSERT ADDITIONAL SPEC FIELDS - desired state of cluster
 }
@@ -2,18 +2,19 @@ package clients
 
 import (
 	"context"
+	"errors"
 	"fmt"
+	"sync"
 
 	buildv1 "github.com/openshift/api/build/v1"
 	configv1 "github.com/openshift/api/config/v1"
 	clientconfigv1 "github.com/openshift/client-go/config/clientset/versioned/typed/config/v1"
-	"k8s.io/cli-runtime/pkg/genericclioptions"
 
 	v1 "k8s.io/api/core/v1"
 	apierrors "k8s.io/apimachinery/pkg/api/errors"
 	metav1 "k8s.io/apimachinery/pkg/apis/meta/v1"
 	"k8s.io/apimachinery/pkg/runtime/schema"
-	"k8s.io/client-go/discovery"
+	"k8s.io/client-go/discovery/cached/memory"
 	"k8s.io/client-go/kubernetes"
 	restclient "k8s.io/client-go/rest"
 	"k8s.io/client-go/tools/record"
@@ -31,6 +32,9 @@ const (
 var (
 	// TODO need to remove this global variable
 	Namespace string
+
+	kubeClientsMutex sync.Mutex
+	kubeClients      = make(map[*restclient.Config]ClientsInterface)
 )
 
 type ClientsInterface interface {
@@ -57,10 +61,28 @@ type k8sClients struct {
 	clientset       kubernetes.Clientset
 	configV1Client  clientconfigv1.ConfigV1Client
 	eventRecorder   record.EventRecorder
-	cachedDiscovery discovery.CachedDiscoveryInterface
+	cachedDiscovery *ttlDiscovery
 	restConfig      *restclient.Config
 }
 
+// CachedKubeClientsFromRestConf returns the clients created for the rest
+// config, creating them on first use. The clients are safe for concurrent
+// use and are shared by every reconcile.
+func CachedKubeClientsFromRestConf(restConfig *restclient.Config) (ClientsInterface, error) {
+	kubeClientsMutex.Lock()
+	defer kubeClientsMutex.Unlock()
+
+	if k, ok := kubeClients[restConfig]; ok {
+		return k, nil
+	}
+	k, err := NewKubeClientsFromRestConf(restConfig)
+	if err != nil {
+		return nil, err
+	}
+	kubeClients[restConfig] = k
+	return k, nil
+}
+
 func NewKubeClientsFromRestConf(restConfig *restclient.Config) (ClientsInterface, error) {
 	kubeClientSet, err := getKubeClientSet(restConfig)
 	if err != nil {
@@ -70,7 +92,7 @@ func NewKubeClientsFromRestConf(restConfig *restclient.Config) (ClientsInterface
 	if err != nil {
 		panic(err)
 	}
-	cachedDiscoveryClient, err := getCachedDiscoveryClient()
+	cachedDiscoveryClient, err := getSharedDiscovery(restConfig)
 	if err != nil {
 		panic(err)
 	}
@@ -99,7 +121,7 @@ func NewClients(runtimeClient client.Client, restConfig *restclient.Config, even
 	if err != nil {
 		return nil, err
 	}
-	cachedDiscoveryClient, err := getCachedDiscoveryClient()
+	cachedDiscoveryClient, err := getSharedDiscovery(restConfig)
 	if err != nil {
 		return nil, err
 	}
@@ -154,7 +176,7 @@ func (k *k8sClients) Invalidate() {
 }
 
 func (k *k8sClients) ServerGroups() (*metav1.APIGroupList, error) {
-	return k.cachedDiscovery.ServerGroups()
+	return k.cachedDiscovery.fresh().ServerGroups()
 }
 
 func (k *k8sClients) StatusUpdate(ctx context.Context, obj client.Object) error {
@@ -166,16 +188,8 @@ func (k *k8sClients) CreateOrUpdate(ctx context.Context, obj client.Object, fn c
 }
 
 func (k *k8sClients) HasResource(resource schema.GroupVersionResource) (bool, error) {
-	dclient, err := discovery.NewDiscoveryClientForConfig(k.restConfig)
-	if err != nil {
-		return false, fmt.Errorf("Cannot retrieve a DiscoveryClient: %w", err)
-	}
-	if dclient == nil {
-		return false, nil
-	}
-
-	resources, err := dclient.ServerResourcesForGroupVersion(resource.GroupVersion().String())
-	if apierrors.IsNotFound(err) {
+	resources, err := k.cachedDiscovery.fresh().ServerResourcesForGroupVersion(resource.GroupVersion().String())
+	if apierrors.IsNotFound(err) || errors.Is(err, memory.ErrCacheNotFound) {
 		// entire group is missing
 		return false, nil
 	}
@@ -245,8 +259,3 @@ func getKubeClientSet(restConfig *restclient.Config) (*kubernetes.Clientset, err
 func getConfigClient(restConfig *restclient.Config) (*clientconfigv1.ConfigV1Client, error) {
 	return clientconfigv1.NewForConfig(restConfig)
 }
-
-func getCachedDiscoveryClient() (discovery.CachedDiscoveryInterface, error) {
-	var config genericclioptions.ConfigFlags
-	return config.ToDiscoveryClient()
-}
@@ -0,0 +1,68 @@
+package clients
+
+import (
+	"sync"
+	"time"
+
+	"k8s.io/client-go/discovery"
+	"k8s.io/client-go/discovery/cached/memory"
+	restclient "k8s.io/client-go/rest"
+)
+
+// DiscoveryTTL is how long the discovered API groups and resources of a
+// cluster are used before they are fetched again
+var DiscoveryTTL = 5 * time.Minute
+
+var (
+	discoveryMutex sync.Mutex
+	discoveries    = make(map[*restclient.Config]*ttlDiscovery)
+)
+
+// ttlDiscovery is an in-memory discovery cache that invalidates itself once
+// it is older than its TTL, so CRDs installed by charts are picked up
+type ttlDiscovery struct {
+	discovery.CachedDiscoveryInterface
+	mutex     sync.Mutex
+	ttl       time.Duration
+	refreshed time.Time
+}
+
+// fresh returns the cache, invalidated first if it expired
+func (d *ttlDiscovery) fresh() discovery.CachedDiscoveryInterface {
+	d.mutex.Lock()
+	defer d.mutex.Unlock()
+	if time.Since(d.refreshed) > d.ttl {
+		d.CachedDiscoveryInterface.Invalidate()
+		d.refreshed = time.Now()
+	}
+	return d.CachedDiscoveryInterface
+}
+
+func (d *ttlDiscovery) Invalidate() {
+	d.mutex.Lock()
+	defer d.mutex.Unlock()
+	d.CachedDiscoveryInterface.Invalidate()
+	d.refreshed = time.Now()
+}
+
+// getSharedDiscovery returns the discovery cache of the cluster, shared by
+// every client created from the same rest config
+func getSharedDiscovery(restConfig *restclient.Config) (*ttlDiscovery, error) {
+	discoveryMutex.Lock()
+	defer discoveryMutex.Unlock()
+
+	if d, ok := discoveries[restConfig]; ok {
+		return d, nil
+	}
+	dclient, err := discovery.NewDiscoveryClientForConfig(restConfig)
+	if err != nil {
+		return nil, err
+	}
+	d := &ttlDiscovery{
+		CachedDiscoveryInterface: memory.NewMemCacheClient(dclient),
+		ttl:                      DiscoveryTTL,
+		refreshed:                time.Now(),
+	}
+	discoveries[restConfig] = d
+	return d, nil
+}
@@ -0,0 +1,58 @@
+package helmer
+
+import (
+	"fmt"
+	"sync"
+
+	helmclient "github.com/mittwald/go-helm-client"
+	"k8s.io/client-go/rest"
+	"k8s.io/klog/v2"
+)
+
+// clientKey identifies a Helm client, a client is bound to the namespace it
+// installs releases in
+type clientKey struct {
+	restConf  *rest.Config
+	namespace string
+}
+
+var (
+	helmClientsMutex sync.Mutex
+	helmClients      = make(map[clientKey]helmclient.Client)
+)
+
+// cachedHelmClient returns the Helm client for the namespace, creating it on
+// first use so reconciles do not set up a client per package every time.
+// A client loads its repository config once and keeps it in memory, so every
+// cached client gets a repository config and cache of its own, otherwise its
+// writes would drop the repositories other clients added in the meantime.
+func cachedHelmClient(restConf *rest.Config, namespace string) (helmclient.Client, error) {
+
+	helmClientsMutex.Lock()
+	defer helmClientsMutex.Unlock()
+
+	key := clientKey{restConf: restConf, namespace: namespace}
+	if c, ok := helmClients[key]; ok {
+		return c, nil
+	}
+
+	suffix := fmt.Sprintf("%s-%d", namespace, len(helmClients))
+	opt := &helmclient.RestConfClientOptions{
+		Options: &helmclient.Options{
+			Namespace:        namespace, // Change this to the namespace you wish to install the chart in.
+			RepositoryCache:  "/tmp/.helmcache-" + suffix,
+			RepositoryConfig: "/tmp/.helmrepo-" + suffix,
+			Debug:            true,
+			Linting:          false, // Change this to false if you don't want linting.
+			DebugLog:         klog.Infof,
+		},
+		RestConfig: restConf,
+	}
+
+	c, err := helmclient.NewClientFromRestConf(opt)
+	if err != nil {
+		return nil, err
+	}
+	helmClients[key] = c
+	return c, nil
+}
@@ -0,0 +1,115 @@
+package helmer
+
+import (
+	"github.com/pkg/errors"
+)
+
+type packageResult struct {
+	idx int
+	err error
+}
+
+// pipelineGraph returns for each package the number of packages it depends on
+// and the packages that depend on it, or an error if a dependency is unknown
+// or the dependencies form a cycle.
+func pipelineGraph(pipeline Pipeline) ([]int, [][]int, error) {
+
+	index := make(map[string]int, len(pipeline))
+	for i := range pipeline {
+		name := pipeline[i].PackageName()
+		if _, ok := index[name]; ok {
+			return nil, nil, errors.Errorf("\n[pipelineGraph]\tpackage %s is defined more than once", name)
+		}
+		index[name] = i
+	}
+
+	pending := make([]int, len(pipeline))
+	dependents := make([][]int, len(pipeline))
+	for i := range pipeline {
+		for _, dep := range pipeline[i].DependsOn {
+			j, ok := index[dep]
+			if !ok {
+				return nil, nil, errors.Errorf("\n[pipelineGraph]\tpackage %s depends on unknown package %s", pipeline[i].PackageName(), dep)
+			}
+			pending[i]++
+			dependents[j] = append(dependents[j], i)
+		}
+	}
+
+	// Kahn's algorithm, every package is visited once unless there is a cycle
+	visited := 0
+	remaining := append([]int(nil), pending...)
+	var ready []int
+	for i, n := range remaining {
+		if n == 0 {
+			ready = append(ready, i)
+		}
+	}
+	for len(ready) > 0 {
+		i := ready[0]
+		ready = ready[1:]
+		visited++
+		for _, d := range dependents[i] {
+			if remaining[d]--; remaining[d] == 0 {
+				ready = append(ready, d)
+			}
+		}
+	}
+	if visited != len(pipeline) {
+		return nil, nil, errors.New("\n[pipelineGraph]\tpackage dependencies form a cycle")
+	}
+	return pending, dependents, nil
+}
+
+// RunPipeline calls run for every package of the pipeline once all packages
+// it depends on have succeeded, with at most parallelism calls at a time.
+// Ready packages start in pipeline order, so a parallelism of one installs
+// a pipeline without dependencies in sequence. After the first failure no
+// new package is started and the error is returned once the running ones
+// have finished.
+func RunPipeline(pipeline Pipeline, parallelism int, run func(pkg *HelmPackage) error) error {
+
+	pending, dependents, err := pipelineGraph(pipeline)
+	if err != nil {
+		return err
+	}
+	if parallelism < 1 {
+		parallelism = 1
+	}
+
+	var ready []int
+	for i, n := range pending {
+		if n == 0 {
+			ready = append(ready, i)
+		}
+	}
+
+	results := make(chan packageResult)
+	running := 0
+	var firstErr error
+	for running > 0 || (firstErr == nil && len(ready) > 0) {
+		for firstErr == nil && len(ready) > 0 && running < parallelism {
+			i := ready[0]
+			ready = ready[1:]
+			running++
+			go func(i int) {
+				results <- packageResult{idx: i, err: run(&pipeline[i])}
+			}(i)
+		}
+
+		res := <-results
+		running--
+		if res.err != nil {
+			if firstErr == nil {
+				firstErr = errors.Wrapf(res.err, "\n[RunPipeline]\tpackage %s failed", pipeline[res.idx].PackageName())
+			}
+			continue
+		}
+		for _, d := range dependents[res.idx] {
+			if pending[d]--; pending[d] == 0 {
+				ready = append(ready, d)
+			}
+		}
+	}
+	return firstErr
+}
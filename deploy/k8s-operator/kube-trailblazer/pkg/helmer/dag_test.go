@@ -0,0 +1,186 @@
+package helmer
+
+import (
+	"sync"
+	"sync/atomic"
+	"time"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+	"github.com/pkg/errors"
+)
+
+// recorder is a package run function that records the order packages were
+// started in and how many of them ran at the same time
+type recorder struct {
+	mutex    sync.Mutex
+	started  []string
+	done     map[string]bool
+	running  int32
+	peak     int32
+	duration time.Duration
+	fail     map[string]bool
+}
+
+func newRecorder() *recorder {
+	return &recorder{done: make(map[string]bool), fail: make(map[string]bool)}
+}
+
+func (r *recorder) run(pkg *HelmPackage) error {
+	defer GinkgoRecover()
+
+	r.mutex.Lock()
+	for _, dep := range pkg.DependsOn {
+		Expect(r.done).To(HaveKey(dep), "%s started before %s", pkg.PackageName(), dep)
+	}
+	r.started = append(r.started, pkg.PackageName())
+	r.mutex.Unlock()
+
+	n := atomic.AddInt32(&r.running, 1)
+	for {
+		peak := atomic.LoadInt32(&r.peak)
+		if n <= peak || atomic.CompareAndSwapInt32(&r.peak, peak, n) {
+			break
+		}
+	}
+	time.Sleep(r.duration)
+	atomic.AddInt32(&r.running, -1)
+
+	if r.fail[pkg.PackageName()] {
+		return errors.New("install failed")
+	}
+	r.mutex.Lock()
+	r.done[pkg.PackageName()] = true
+	r.mutex.Unlock()
+	return nil
+}
+
+func (r *recorder) startedPackages() []string {
+	r.mutex.Lock()
+	defer r.mutex.Unlock()
+	return append([]string(nil), r.started...)
+}
+
+var _ = Describe("dag_RunPipeline", func() {
+
+	// etcd and minio feed milvus, the chain server needs milvus and triton
+	rag := Pipeline{
+		{Name: "etcd"},
+		{Name: "minio"},
+		{Name: "milvus", DependsOn: []string{"etcd", "minio"}},
+		{Name: "triton"},
+		{Name: "chain-server", DependsOn: []string{"milvus", "triton"}},
+	}
+
+	DescribeTable("should reject an invalid pipeline without running a package",
+		func(pipeline Pipeline, message string) {
+			r := newRecorder()
+
+			err := RunPipeline(pipeline, 4, r.run)
+
+			Expect(err).To(HaveOccurred())
+			Expect(err.Error()).To(ContainSubstring(message))
+			Expect(r.startedPackages()).To(BeEmpty())
+		},
+		Entry("with a cycle",
+			Pipeline{
+				{Name: "a", DependsOn: []string{"c"}},
+				{Name: "b", DependsOn: []string{"a"}},
+				{Name: "c", DependsOn: []string{"b"}},
+				{Name: "d"},
+			}, "cycle"),
+		Entry("with a package depending on itself",
+			Pipeline{{Name: "a", DependsOn: []string{"a"}}}, "cycle"),
+		Entry("with an unknown dependency",
+			Pipeline{{Name: "a"}, {Name: "b", DependsOn: []string{"c"}}}, "unknown package c"),
+		Entry("with a duplicate name",
+			Pipeline{{Name: "a"}, {ChartSpec: chartSpec{ChartName: "a"}}}, "more than once"),
+	)
+
+	It("should succeed on an empty pipeline", func() {
+		Expect(RunPipeline(nil, 1, newRecorder().run)).To(Succeed())
+	})
+
+	It("should run every package after its dependencies", func() {
+		r := newRecorder()
+
+		Expect(RunPipeline(rag, 8, r.run)).To(Succeed())
+		Expect(r.startedPackages()).To(ConsistOf("etcd", "minio", "milvus", "triton", "chain-server"))
+	})
+
+	It("should not run more packages at a time than the parallelism", func() {
+		var pipeline Pipeline
+		for _, name := range []string{"a", "b", "c", "d", "e", "f", "g"} {
+			pipeline = append(pipeline, HelmPackage{Name: name})
+		}
+		r := newRecorder()
+		r.duration = 20 * time.Millisecond
+
+		Expect(RunPipeline(pipeline, 3, r.run)).To(Succeed())
+		Expect(r.startedPackages()).To(HaveLen(len(pipeline)))
+		Expect(atomic.LoadInt32(&r.peak)).To(BeEquivalentTo(3))
+	})
+
+	It("should treat a parallelism below one as one", func() {
+		r := newRecorder()
+		r.duration = 5 * time.Millisecond
+
+		Expect(RunPipeline(rag, 0, r.run)).To(Succeed())
+		Expect(atomic.LoadInt32(&r.peak)).To(BeEquivalentTo(1))
+	})
+
+	It("should install in pipeline order with a parallelism of one", func() {
+		r := newRecorder()
+
+		Expect(RunPipeline(rag, 1, r.run)).To(Succeed())
+		Expect(r.startedPackages()).To(Equal([]string{"etcd", "minio", "triton", "milvus", "chain-server"}))
+
+		var sequence Pipeline
+		for _, name := range []string{"c", "a", "b"} {
+			sequence = append(sequence, HelmPackage{Name: name})
+		}
+		r = newRecorder()
+		Expect(RunPipeline(sequence, 1, r.run)).To(Succeed())
+		Expect(r.startedPackages()).To(Equal([]string{"c", "a", "b"}))
+	})
+
+	It("should not start a package after a failure", func() {
+		r := newRecorder()
+		r.fail["minio"] = true
+
+		err := RunPipeline(rag, 1, r.run)
+
+		Expect(err).To(HaveOccurred())
+		Expect(err.Error()).To(ContainSubstring("package minio failed"))
+		Expect(r.startedPackages()).To(Equal([]string{"etcd", "minio"}))
+	})
+
+	It("should wait for running packages after a failure", func() {
+		var pipeline Pipeline
+		for _, name := range []string{"fails", "slow", "next"} {
+			pipeline = append(pipeline, HelmPackage{Name: name})
+		}
+		failed := make(chan struct{})
+		var slowDone int32
+
+		err := RunPipeline(pipeline, 2, func(pkg *HelmPackage) error {
+			defer GinkgoRecover()
+			switch pkg.PackageName() {
+			case "fails":
+				close(failed)
+				return errors.New("install failed")
+			case "slow":
+				// finish well after the failure has been seen
+				<-failed
+				time.Sleep(50 * time.Millisecond)
+				atomic.StoreInt32(&slowDone, 1)
+				return nil
+			}
+			Fail("package " + pkg.PackageName() + " started after a failure")
+			return nil
+		})
+
+		Expect(err).To(HaveOccurred())
+		Expect(atomic.LoadInt32(&slowDone)).To(BeEquivalentTo(1))
+	})
+})
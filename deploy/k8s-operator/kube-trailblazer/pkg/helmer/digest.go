@@ -0,0 +1,114 @@
+package helmer
+
+import (
+	"context"
+	"os"
+	"sort"
+
+	"github.com/nvidia/kube-trailblazer/pkg/storage"
+	"github.com/nvidia/kube-trailblazer/pkg/utils"
+	"github.com/pkg/errors"
+	"helm.sh/helm/v3/pkg/chart"
+	"helm.sh/helm/v3/pkg/release"
+	"k8s.io/apimachinery/pkg/types"
+	"k8s.io/klog/v2"
+)
+
+// DigestConfigMap holds, in the namespace of the releases, the digest of the
+// chart and values each release was last successfully deployed from
+const DigestConfigMap = "trailblazer-release-digests"
+
+type pendingDigest struct {
+	namespace string
+	release   string
+	digest    string
+}
+
+// releaseDigest returns a digest of the chart version, templates and the
+// merged values of the release, and of the rendered manifests if
+// HELMER_DIGEST_MANIFESTS=1 is set
+func (h *Helmer) releaseDigest(rootChart *chart.Chart) (string, error) {
+
+	spec := h.Package.ChartSpec
+	parts := [][]byte{
+		[]byte(spec.Namespace),
+		[]byte(spec.ReleaseName),
+		[]byte(rootChart.Name()),
+		[]byte(rootChart.Metadata.Version),
+		[]byte(spec.ValuesYaml),
+	}
+
+	// Charts served from a file repo change without a version bump
+	templates := append([]*chart.File(nil), rootChart.Templates...)
+	sort.Slice(templates, func(i, j int) bool { return templates[i].Name < templates[j].Name })
+	for _, template := range templates {
+		parts = append(parts, []byte(template.Name), template.Data)
+	}
+
+	if os.Getenv("HELMER_DIGEST_MANIFESTS") == "1" {
+		manifests, err := h.Client.TemplateChart(spec.DeepCopy(), nil)
+		if err != nil {
+			return "", errors.Wrapf(err, "\n[releaseDigest]\tcannot render release %s", spec.ReleaseName)
+		}
+		parts = append(parts, manifests)
+	}
+	return utils.SHA256(parts...), nil
+}
+
+func (h *Helmer) digestConfigMap(namespace string) types.NamespacedName {
+	return types.NamespacedName{Namespace: namespace, Name: DigestConfigMap}
+}
+
+// isUpToDate returns true if the release is deployed and was deployed from
+// the chart and values with the given digest
+func (h *Helmer) isUpToDate(digest string) bool {
+
+	spec := h.Package.ChartSpec
+	stored, err := storage.NewStorage(h.KubeClient).CheckConfigMapEntry(context.TODO(), spec.ReleaseName, h.digestConfigMap(spec.Namespace))
+	if err != nil || stored != digest {
+		return false
+	}
+
+	// The release may have been removed or failed behind our back
+	chartRelease, err := h.Client.GetRelease(spec.ReleaseName)
+	if err != nil || chartRelease.Info == nil {
+		return false
+	}
+	return chartRelease.Info.Status == release.StatusDeployed
+}
+
+// addDigest records the digest of a release that was just installed or upgraded
+func (h *Helmer) addDigest(digest string) {
+	h.Changed = true
+	h.digests = append(h.digests, pendingDigest{
+		namespace: h.Package.ChartSpec.Namespace,
+		release:   h.Package.ChartSpec.ReleaseName,
+		digest:    digest,
+	})
+}
+
+// StoreDigests stores the digests of the releases this Helmer installed or
+// upgraded, call it once their chart tests passed
+func (h *Helmer) StoreDigests() error {
+
+	store := storage.NewStorage(h.KubeClient)
+	for _, d := range h.digests {
+		err := store.UpdateConfigMapEntry(context.TODO(), d.release, d.digest, h.digestConfigMap(d.namespace))
+		if err != nil {
+			return errors.Wrapf(err, "\n[StoreDigests]\tcannot store digest for release %s", d.release)
+		}
+	}
+	h.digests = nil
+	return nil
+}
+
+// forgetDigest removes the digest of the uninstalled release, so it is
+// installed again if it comes back
+func (h *Helmer) forgetDigest() {
+
+	spec := h.Package.ChartSpec
+	err := storage.NewStorage(h.KubeClient).DeleteConfigMapEntry(context.TODO(), spec.ReleaseName, h.digestConfigMap(spec.Namespace))
+	if err != nil {
+		klog.Infof("[forgetDigest]\tcannot remove digest for release %s: %v", spec.ReleaseName, err)
+	}
+}
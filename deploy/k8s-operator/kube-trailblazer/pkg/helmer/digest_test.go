@@ -0,0 +1,195 @@
+package helmer
+
+import (
+	"context"
+
+	"github.com/golang/mock/gomock"
+	helmclient "github.com/mittwald/go-helm-client"
+	"github.com/nvidia/kube-trailblazer/pkg/clients"
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+	"github.com/pkg/errors"
+	"helm.sh/helm/v3/pkg/chart"
+	"helm.sh/helm/v3/pkg/release"
+	v1 "k8s.io/api/core/v1"
+	k8serrors "k8s.io/apimachinery/pkg/api/errors"
+	"k8s.io/apimachinery/pkg/types"
+)
+
+// fakeHelmClient answers GetRelease with a fixed release, any other call of
+// the Helm client interface panics
+type fakeHelmClient struct {
+	helmclient.Client
+	release *release.Release
+	err     error
+	calls   int
+}
+
+func (c *fakeHelmClient) GetRelease(name string) (*release.Release, error) {
+	c.calls++
+	return c.release, c.err
+}
+
+func digestChart(version string, templates ...*chart.File) *chart.Chart {
+	return &chart.Chart{
+		Metadata:  &chart.Metadata{Name: "rag-llm-pipeline", Version: version},
+		Templates: templates,
+	}
+}
+
+func deployedRelease(status release.Status) *release.Release {
+	return &release.Release{Name: "rag", Info: &release.Info{Status: status}}
+}
+
+var _ = Describe("digest", func() {
+	const digest = "4a5e1e4baab89f3a32518a88c31bc87f618f76673e2cc77ab2127b7afdeda33b"
+
+	var (
+		ctrl       *gomock.Controller
+		mockClient *clients.MockClientsInterface
+		helmClient *fakeHelmClient
+		h          *Helmer
+		nsn        = types.NamespacedName{Namespace: "rag", Name: DigestConfigMap}
+		notFound   = k8serrors.NewNotFound(v1.Resource("configmap"), DigestConfigMap)
+		cmMatcher  = gomock.AssignableToTypeOf(&v1.ConfigMap{})
+		deployment = &chart.File{Name: "templates/deployment.yaml", Data: []byte("kind: Deployment")}
+		service    = &chart.File{Name: "templates/service.yaml", Data: []byte("kind: Service")}
+	)
+
+	BeforeEach(func() {
+		ctrl = gomock.NewController(GinkgoT())
+		mockClient = clients.NewMockClientsInterface(ctrl)
+		helmClient = &fakeHelmClient{}
+		h = &Helmer{KubeClient: mockClient, Client: helmClient}
+		h.Package.ChartSpec.Namespace = "rag"
+		h.Package.ChartSpec.ReleaseName = "rag"
+		h.Package.ChartSpec.ValuesYaml = "replicas: 1"
+	})
+
+	AfterEach(func() {
+		ctrl.Finish()
+	})
+
+	// storedDigest makes the digest ConfigMap hold data
+	storedDigest := func(data map[string]string) {
+		mockClient.
+			EXPECT().
+			Get(context.TODO(), nsn, cmMatcher).
+			Do(func(_ context.Context, _ types.NamespacedName, cm *v1.ConfigMap) {
+				cm.Data = data
+			})
+	}
+
+	Context("releaseDigest", func() {
+		It("should be stable and not depend on the template order", func() {
+			first, err := h.releaseDigest(digestChart("0.1.0", deployment, service))
+			Expect(err).NotTo(HaveOccurred())
+			second, err := h.releaseDigest(digestChart("0.1.0", service, deployment))
+			Expect(err).NotTo(HaveOccurred())
+
+			Expect(first).To(HaveLen(64))
+			Expect(second).To(Equal(first))
+		})
+
+		It("should change with the chart, values and release", func() {
+			base, err := h.releaseDigest(digestChart("0.1.0", deployment))
+			Expect(err).NotTo(HaveOccurred())
+			digests := map[string]bool{base: true}
+			add := func(d string, err error) {
+				Expect(err).NotTo(HaveOccurred())
+				Expect(digests).NotTo(HaveKey(d))
+				digests[d] = true
+			}
+
+			add(h.releaseDigest(digestChart("0.2.0", deployment)))
+			add(h.releaseDigest(digestChart("0.1.0", deployment, service)))
+			add(h.releaseDigest(digestChart("0.1.0",
+				&chart.File{Name: deployment.Name, Data: []byte("kind: Deployment\nreplicas: 2")})))
+
+			h.Package.ChartSpec.ValuesYaml = "replicas: 2"
+			add(h.releaseDigest(digestChart("0.1.0", deployment)))
+
+			h.Package.ChartSpec.Namespace = "other"
+			add(h.releaseDigest(digestChart("0.1.0", deployment)))
+
+			h.Package.ChartSpec.ReleaseName = "other"
+			add(h.releaseDigest(digestChart("0.1.0", deployment)))
+		})
+	})
+
+	Context("isUpToDate", func() {
+		It("should be false without a digest ConfigMap", func() {
+			mockClient.
+				EXPECT().
+				Get(context.TODO(), nsn, cmMatcher).
+				Return(notFound)
+
+			Expect(h.isUpToDate(digest)).To(BeFalse())
+			Expect(helmClient.calls).To(BeZero())
+		})
+
+		It("should be false if the stored digest differs", func() {
+			storedDigest(map[string]string{"rag": "outdated", "other": digest})
+
+			Expect(h.isUpToDate(digest)).To(BeFalse())
+			Expect(helmClient.calls).To(BeZero())
+		})
+
+		It("should be true if the digest matches and the release is deployed", func() {
+			storedDigest(map[string]string{"rag": digest})
+			helmClient.release = deployedRelease(release.StatusDeployed)
+
+			Expect(h.isUpToDate(digest)).To(BeTrue())
+		})
+
+		It("should be false if the release is not deployed", func() {
+			storedDigest(map[string]string{"rag": digest})
+			helmClient.release = deployedRelease(release.StatusFailed)
+
+			Expect(h.isUpToDate(digest)).To(BeFalse())
+		})
+
+		It("should be false if the release is gone", func() {
+			storedDigest(map[string]string{"rag": digest})
+			helmClient.err = errors.New("release: not found")
+
+			Expect(h.isUpToDate(digest)).To(BeFalse())
+		})
+	})
+
+	Context("StoreDigests", func() {
+		It("should create the digest ConfigMap", func() {
+			h.addDigest(digest)
+			mockClient.
+				EXPECT().
+				Get(context.TODO(), nsn, cmMatcher).
+				Return(notFound)
+			mockClient.
+				EXPECT().
+				Create(context.TODO(), cmMatcher).
+				Do(func(_ context.Context, cm *v1.ConfigMap) {
+					Expect(cm.Namespace).To(Equal("rag"))
+					Expect(cm.Name).To(Equal(DigestConfigMap))
+					Expect(cm.Data).To(Equal(map[string]string{"rag": digest}))
+				})
+
+			Expect(h.Changed).To(BeTrue())
+			Expect(h.StoreDigests()).To(Succeed())
+			// stored digests are not written again
+			Expect(h.StoreDigests()).To(Succeed())
+		})
+
+		It("should keep the digests of other releases", func() {
+			h.addDigest(digest)
+			storedDigest(map[string]string{"other": "unchanged"})
+			mockClient.
+				EXPECT().
+				Update(context.TODO(), cmMatcher).
+				Do(func(_ context.Context, cm *v1.ConfigMap) {
+					Expect(cm.Data).To(Equal(map[string]string{"rag": digest, "other": "unchanged"}))
+				})
+
+			Expect(h.StoreDigests()).To(Succeed())
+		})
+	})
+})
@@ -7,6 +7,8 @@ import (
 	"log"
 	"os"
 	"reflect"
+	"sort"
+	"sync"
 
 	apierrors "k8s.io/apimachinery/pkg/api/errors"
 
@@ -32,30 +34,23 @@ const (
 	FilterOwnedLabel = "app.trailblazer.nvidia.com/owned-by"
 )
 
+// repoMutex serializes repository updates, packages of a pipeline may be
+// reconciled concurrently and packages in one namespace share a Helm client.
+var repoMutex sync.Mutex
+
 func (h *Helmer) GetClientsWithRestConf(restConf *rest.Config) error {
 
 	var err error
 
-	opt := &helmclient.RestConfClientOptions{
-		Options: &helmclient.Options{
-			Namespace:        h.Package.ChartSpec.Namespace, // Change this to the namespace you wish to install the chart in.
-			RepositoryCache:  "/tmp/.helmcache",
-			RepositoryConfig: "/tmp/.helmrepo",
-			Debug:            true,
-			Linting:          false, // Change this to false if you don't want linting.
-			DebugLog:         klog.Infof,
-		},
-		RestConfig: restConf,
-	}
-
-	h.Client, err = helmclient.NewClientFromRestConf(opt)
+	h.Client, err = cachedHelmClient(restConf, h.Package.ChartSpec.Namespace)
 	if err != nil {
 		return errors.Wrap(err, "\n[GGetClientWithRestConf]\tcannot create client from restConfig")
 	}
-	h.KubeClient, err = clients.NewKubeClientsFromRestConf(restConf)
+	h.KubeClient, err = clients.CachedKubeClientsFromRestConf(restConf)
 	if err != nil {
 		return errors.Wrapf(err, "\n[GGetClientWithRestConf]\tcannot create kubeClients from restConfig")
 	}
+	h.restConf = restConf
 	return nil
 }
 
@@ -345,11 +340,24 @@ func (h *Helmer) install(rootChart *chart.Chart, rootValues *chartutil.Values) e
 
 	h.Package.ChartSpec.ValuesYaml = vals
 
+	// Reconciles are triggered by any owned object, most of them change
+	// nothing, so skip the upgrade if the release is already deployed
+	// from the same chart and values.
+	digest, err := h.releaseDigest(rootChart)
+	if err != nil {
+		return errors.Wrapf(err, "\n[Install]\tcannot compute digest for %v", rootChart.Name())
+	}
+	if h.isUpToDate(digest) {
+		klog.Infof("[Install]\trelease %s is up to date, skipping upgrade", h.Package.ChartSpec.ReleaseName)
+		return nil
+	}
+
 	chartSpec := h.Package.ChartSpec.DeepCopy()
 	chartRelease, err := h.Client.InstallOrUpgradeChart(context.TODO(), chartSpec, &h.Options)
 	if err != nil {
 		return errors.Wrapf(err, "\n[Install]\tchart failed with %v", rootChart.Name())
 	}
+	h.addDigest(digest)
 
 	err = h.setReleaseOwnerReference(chartRelease)
 	if err != nil {
@@ -412,7 +420,11 @@ func (h *Helmer) installDependency(childChart *chart.Chart, childValues *chartut
 	}
 
 	// TODO: add generic client which can handle "all" situations
-	err = c.GetClientsWithKubeConf("", "default")
+	if h.restConf != nil {
+		err = c.GetClientsWithRestConf(h.restConf)
+	} else {
+		err = c.GetClientsWithKubeConf("", "default")
+	}
 	if err != nil {
 		return errors.Wrapf(err, "\n[installDependency]\tcannot get client with kubeConf")
 	}
@@ -423,6 +435,8 @@ func (h *Helmer) installDependency(childChart *chart.Chart, childValues *chartut
 	if err != nil {
 		return errors.Wrapf(err, "\n[installDependency]\tcannot install chart: %s", childChart.Name())
 	}
+	h.Changed = h.Changed || c.Changed
+	h.digests = append(h.digests, c.digests...)
 	return nil
 }
 
@@ -461,6 +475,8 @@ func (h *Helmer) AddOrUpdateRepo() error {
 	var repoEntry repo.Entry
 
 	h.Package.RepoEntry.DeepCopyInto(&repoEntry)
+	repoMutex.Lock()
+	defer repoMutex.Unlock()
 	if err := h.Client.AddOrUpdateChartRepo(repoEntry); err != nil {
 		return errors.Wrapf(err, "[AddOrUpdateChartRepo] failed with repo entry %v", h.Package.RepoEntry)
 	}
@@ -492,57 +508,91 @@ func ReconcileDelete(pipeline Pipeline, restConf *rest.Config) error {
 		if err != nil {
 			return errors.Wrapf(err, "\n[ReconcileDelete]\tcannot uninstall release %s", h.Package.ChartSpec.ReleaseName)
 		}
+		h.forgetDigest()
 	}
 	return nil
 }
 
-func ReconcileCreate(pipeline Pipeline, restConf *rest.Config) ([]*release.Release, error) {
+func reconcilePackage(pkg *HelmPackage, restConf *rest.Config) ([]*release.Release, error) {
+	// For each chart we create an Helmer instance with its own settings
+	// this makes it easier to decouple each chart for processing and clients
+	// that do not interfere with each other.
+	h, err := NewWithPackage(pkg)
+	if err != nil {
+		return nil, errors.Wrapf(err, "\n[reconcilePackage]\tcannot create new Helmer with Package %s", pkg.ChartSpec.ChartName)
+	}
 
-	var releases []*release.Release
+	err = h.GetClientsWithRestConf(restConf)
+	if err != nil {
+		return nil, errors.Wrapf(err, "\n[reconcilePackage]\tcannot get clients for Package %s", h.Package.ChartSpec.ReleaseName)
+	}
+	err = h.AddOrUpdateRepo()
+	if err != nil {
+		return nil, err
+	}
 
-	for _, pkg := range UpdatePipelineWithDefaultChartSpec(pipeline) {
-		// For each chart we create an Helmer instance with its own settings
-		// this makes it easier to decouple each chart for processing and clients
-		// that do not interfere with each other.
-		h, err := NewWithPackage(&pkg)
-		if err != nil {
-			panic(err)
+	err = h.Lint()
+	if err != nil {
+		return nil, err
+	}
+	err = h.InstallOrUpgradePackage()
+	if err != nil {
+		return nil, err
+	}
+	if !h.Changed {
+		// Nothing was upgraded, the tests passed when the digests were stored
+		return h.ListDeployedReleases()
+	}
+	ok, err := h.RunChartTests()
+	if !ok {
+		klog.Infof("[Reconcile]\tchart tests failed for %s", h.Package.ChartSpec.ReleaseName)
+		if err == nil {
+			err = errors.Errorf("\n[reconcilePackage]\tchart tests failed for %s", h.Package.ChartSpec.ReleaseName)
 		}
+		return nil, err
+	}
+	if err != nil {
+		klog.Infof("[Reconcile]\terror executing tests for %s", h.Package.ChartSpec.ReleaseName)
+		return nil, nil
+	}
+	err = h.StoreDigests()
+	if err != nil {
+		return nil, err
+	}
+	return h.ListDeployedReleases()
+}
 
-		err = h.GetClientsWithRestConf(restConf)
-		if err != nil {
-			panic(err)
-		}
-		err = h.AddOrUpdateRepo()
-		if err != nil {
-			return nil, err
-		}
+// ReconcileCreate installs or upgrades the packages of the pipeline, each one
+// after the packages it depends on and at most parallelism at a time.
+func ReconcileCreate(pipeline Pipeline, parallelism int, restConf *rest.Config) ([]*release.Release, error) {
 
-		err = h.Lint()
-		if err != nil {
-			return nil, err
-		}
-		err = h.InstallOrUpgradePackage()
+	var mu sync.Mutex
+	releases := make(map[string]*release.Release)
+
+	err := RunPipeline(UpdatePipelineWithDefaultChartSpec(pipeline), parallelism, func(pkg *HelmPackage) error {
+		pkgReleases, err := reconcilePackage(pkg, restConf)
 		if err != nil {
-			return nil, err
+			return err
 		}
-		ok, err := h.RunChartTests()
-		if !ok {
-			klog.Infof("[Reconcile]\tchart tests failed for %s", h.Package.ChartSpec.ReleaseName)
-			return nil, err
+		mu.Lock()
+		defer mu.Unlock()
+		for _, r := range pkgReleases {
+			releases[r.Namespace+"/"+r.Name] = r
 		}
-		if err != nil {
-			klog.Infof("[Reconcile]\terror executing tests for %s", h.Package.ChartSpec.ReleaseName)
+		return nil
+	})
+	if err != nil {
+		return nil, err
+	}
 
-		}
-		if err == nil {
-			releases, err = h.ListDeployedReleases()
-			if err != nil {
-				return nil, err
-			}
-		}
+	out := make([]*release.Release, 0, len(releases))
+	for _, r := range releases {
+		out = append(out, r)
 	}
-	return releases, nil
+	sort.Slice(out, func(i, j int) bool {
+		return out[i].Namespace+"/"+out[i].Name < out[j].Namespace+"/"+out[j].Name
+	})
+	return out, nil
 }
 
 // UpdateGrapshWithDefaultChartSpec updates a HelmPackage with default ChartSpec values
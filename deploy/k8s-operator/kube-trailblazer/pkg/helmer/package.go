@@ -47,6 +47,10 @@ func NewHelmPackageWithDefaultChartSpec() *HelmPackage {
 
 func (in *HelmPackage) DeepCopyInto(out *HelmPackage) {
 	*out = *in
+	if in.DependsOn != nil {
+		out.DependsOn = make([]string, len(in.DependsOn))
+		copy(out.DependsOn, in.DependsOn)
+	}
 	out.RepoEntry = in.RepoEntry
 	out.ChartSpec = in.ChartSpec
 	out.ChartValues = in.ChartValues
@@ -60,3 +64,11 @@ func (in *HelmPackage) DeepCopy() *HelmPackage {
 	in.DeepCopyInto(out)
 	return out
 }
+
+// PackageName returns the name other packages use to depend on this one
+func (in *HelmPackage) PackageName() string {
+	if in.Name != "" {
+		return in.Name
+	}
+	return in.ChartSpec.ChartName
+}
@@ -1,68 +1,162 @@
 package helmer
 
 import (
+	"bufio"
 	"bytes"
-	"errors"
-	"fmt"
-	"os"
-	"os/exec"
+	"io"
+
+	"github.com/pkg/errors"
+	"k8s.io/apimachinery/pkg/apis/meta/v1/unstructured"
+	utilyaml "k8s.io/apimachinery/pkg/util/yaml"
+	"sigs.k8s.io/yaml"
+)
+
+const (
+	// FilterOwnedValue is the value of FilterOwnedLabel on every rendered object
+	FilterOwnedValue = "HelmOrchard"
+	// PackageAnnotation names the pipeline package an object was rendered for
+	PackageAnnotation = "app.trailblazer.nvidia.com/package"
 )
 
-func check(e error) {
-	if e != nil {
-		panic(e)
+// labelPath is a field of a kind that gets the common labels, create adds
+// the field if the object does not have it. Fields below a list are applied
+// to each element of the list at path.
+type labelPath struct {
+	kind   string
+	path   []string
+	inList []string
+	create bool
+}
+
+// commonLabelPaths are the label and selector fields kustomize's commonLabels
+// sets besides metadata.labels. The objects rendered so far carry the labels
+// in their selectors, which are immutable, so the same fields have to be set.
+var commonLabelPaths = []labelPath{
+	{kind: "ReplicationController", path: []string{"spec", "selector"}, create: true},
+	{kind: "ReplicationController", path: []string{"spec", "template", "metadata", "labels"}, create: true},
+	{kind: "Deployment", path: []string{"spec", "selector", "matchLabels"}, create: true},
+	{kind: "Deployment", path: []string{"spec", "template", "metadata", "labels"}, create: true},
+	{kind: "ReplicaSet", path: []string{"spec", "selector", "matchLabels"}, create: true},
+	{kind: "ReplicaSet", path: []string{"spec", "template", "metadata", "labels"}, create: true},
+	{kind: "DaemonSet", path: []string{"spec", "selector", "matchLabels"}, create: true},
+	{kind: "DaemonSet", path: []string{"spec", "template", "metadata", "labels"}, create: true},
+	{kind: "StatefulSet", path: []string{"spec", "selector", "matchLabels"}, create: true},
+	{kind: "StatefulSet", path: []string{"spec", "template", "metadata", "labels"}, create: true},
+	{kind: "StatefulSet", path: []string{"spec", "volumeClaimTemplates"}, inList: []string{"metadata", "labels"}, create: true},
+	{kind: "Service", path: []string{"spec", "selector"}, create: true},
+	{kind: "Job", path: []string{"spec", "selector", "matchLabels"}},
+	{kind: "Job", path: []string{"spec", "template", "metadata", "labels"}, create: true},
+	{kind: "CronJob", path: []string{"spec", "jobTemplate", "spec", "selector", "matchLabels"}},
+	{kind: "CronJob", path: []string{"spec", "jobTemplate", "metadata", "labels"}, create: true},
+	{kind: "CronJob", path: []string{"spec", "jobTemplate", "spec", "template", "metadata", "labels"}, create: true},
+	{kind: "PodDisruptionBudget", path: []string{"spec", "selector", "matchLabels"}},
+	{kind: "NetworkPolicy", path: []string{"spec", "podSelector", "matchLabels"}},
+}
+
+// addLabels merges labels into the map at path, returns false if the map
+// does not exist and create is not set
+func addLabels(obj map[string]interface{}, path []string, labels map[string]string, create bool) (bool, error) {
+
+	current := make(map[string]string, len(labels))
+	// Charts render empty fields as null
+	if value, found, _ := unstructured.NestedFieldNoCopy(obj, path...); found && value != nil {
+		existing, _, err := unstructured.NestedStringMap(obj, path...)
+		if err != nil {
+			return false, err
+		}
+		current = existing
+	} else if !create {
+		return false, nil
+	}
+	for k, v := range labels {
+		current[k] = v
 	}
+	return true, unstructured.SetNestedStringMap(obj, current, path...)
 }
 
-func mkdir(path string) error {
-	if _, err := os.Stat(path); errors.Is(err, os.ErrNotExist) {
-		err := os.MkdirAll(path, os.ModePerm)
+// setCommonLabels sets labels on the object's metadata and on the selector
+// and template fields of its kind
+func setCommonLabels(obj *unstructured.Unstructured, labels map[string]string) error {
+
+	if _, err := addLabels(obj.Object, []string{"metadata", "labels"}, labels, true); err != nil {
+		return err
+	}
+	for _, lp := range commonLabelPaths {
+		if lp.kind != obj.GetKind() {
+			continue
+		}
+		if lp.inList == nil {
+			if _, err := addLabels(obj.Object, lp.path, labels, lp.create); err != nil {
+				return err
+			}
+			continue
+		}
+		items, found, err := unstructured.NestedSlice(obj.Object, lp.path...)
 		if err != nil {
 			return err
 		}
+		if !found {
+			continue
+		}
+		for _, item := range items {
+			if m, ok := item.(map[string]interface{}); ok {
+				if _, err := addLabels(m, lp.inList, labels, lp.create); err != nil {
+					return err
+				}
+			}
+		}
+		if err := unstructured.SetNestedSlice(obj.Object, items, lp.path...); err != nil {
+			return err
+		}
 	}
 	return nil
 }
 
+// Run implements the Helm post-renderer, it labels every rendered object as
+// owned by the operator and annotates it with the package it belongs to
 func (h *Helmer) Run(renderedManifests *bytes.Buffer) (modifiedManifests *bytes.Buffer, err error) {
 
-	kustomizePath := "/kustomize/"
-	chart := h.Package.ReleaseName + "-" + h.Package.ChartSpec.Version
-	basePath := kustomizePath + chart + "/base/"
-
-	err = mkdir(basePath)
-	check(err)
+	labels := map[string]string{FilterOwnedLabel: FilterOwnedValue}
+	pkgName := h.Package.PackageName()
 
-	var kustomization bytes.Buffer
+	reader := utilyaml.NewYAMLReader(bufio.NewReader(renderedManifests))
+	modifiedManifests = &bytes.Buffer{}
 
-	manifests := bytes.Split(renderedManifests.Bytes(), []byte("---"))
-	if len(manifests[0]) == 0 {
-		manifests = manifests[1:]
-	}
-
-	kustomization.WriteString("resources:\n")
-	for i, manifest := range manifests {
-		// this cannot error per docs
-		name := fmt.Sprintf("resource-%d.yaml", i)
-		err := os.WriteFile(basePath+name, manifest, 0644)
-		check(err)
-		fmt.Fprintf(&kustomization, " - %s\n", name)
-	}
-
-	kustomization.WriteString("\n")
-	kustomization.WriteString("commonLabels:\n")
-	kustomization.WriteString("  app.trailblazer.nvidia.com/owned-by: HelmOrchard\n")
-
-	err = os.WriteFile(basePath+"kustomization.yaml", kustomization.Bytes(), 0644)
-	check(err)
+	for {
+		doc, err := reader.Read()
+		if err == io.EOF {
+			break
+		}
+		if err != nil {
+			return nil, errors.Wrapf(err, "\n[Run]\tcannot read rendered manifests of %s", pkgName)
+		}
 
-	kustomize := exec.Command("kustomize", "build", basePath)
-	out, err := kustomize.Output()
-	check(err)
+		obj := &unstructured.Unstructured{}
+		// Keeps integers as int64, unlike a plain JSON round trip
+		if err := utilyaml.Unmarshal(doc, &obj.Object); err != nil {
+			return nil, errors.Wrapf(err, "\n[Run]\tcannot parse rendered manifest of %s", pkgName)
+		}
+		// Documents holding only comments or whitespace
+		if len(obj.Object) == 0 {
+			continue
+		}
 
-	// otherwise, print the output from running the command
-	//klog.Info("Output: ", string(out))
-	renderedManifests = bytes.NewBuffer(out)
+		if err := setCommonLabels(obj, labels); err != nil {
+			return nil, errors.Wrapf(err, "\n[Run]\tcannot label %s %s", obj.GetKind(), obj.GetName())
+		}
+		annotations := obj.GetAnnotations()
+		if annotations == nil {
+			annotations = make(map[string]string, 1)
+		}
+		annotations[PackageAnnotation] = pkgName
+		obj.SetAnnotations(annotations)
 
-	return renderedManifests, nil
+		out, err := yaml.Marshal(obj.Object)
+		if err != nil {
+			return nil, errors.Wrapf(err, "\n[Run]\tcannot serialize %s %s", obj.GetKind(), obj.GetName())
+		}
+		modifiedManifests.WriteString("---\n")
+		modifiedManifests.Write(out)
+	}
+	return modifiedManifests, nil
 }
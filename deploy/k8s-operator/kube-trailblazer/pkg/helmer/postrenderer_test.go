@@ -0,0 +1,423 @@
+package helmer
+
+import (
+	"bytes"
+	"strings"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+	"k8s.io/apimachinery/pkg/apis/meta/v1/unstructured"
+)
+
+// renderedDocuments splits post-rendered manifests into their documents
+func renderedDocuments(manifests string) []string {
+	var docs []string
+	for _, doc := range strings.Split(manifests, "---\n") {
+		if strings.TrimSpace(doc) != "" {
+			docs = append(docs, doc)
+		}
+	}
+	return docs
+}
+
+// The expected manifests are the output of kustomize build with
+//
+//	commonLabels:
+//	  app.trailblazer.nvidia.com/owned-by: HelmOrchard
+//
+// plus the package annotation the post-renderer adds
+var _ = Describe("postrenderer_Run", func() {
+
+	DescribeTable("should label rendered objects like kustomize commonLabels",
+		func(rendered string, expected []string) {
+			h := &Helmer{Package: HelmPackage{Name: "rag"}}
+
+			out, err := h.Run(bytes.NewBufferString(rendered))
+
+			Expect(err).NotTo(HaveOccurred())
+			docs := renderedDocuments(out.String())
+			Expect(docs).To(HaveLen(len(expected)))
+			for i := range expected {
+				Expect(docs[i]).To(MatchYAML(expected[i]))
+			}
+		},
+		Entry("a Deployment", `
+apiVersion: apps/v1
+kind: Deployment
+metadata:
+  name: chain-server
+  labels:
+    app: chain-server
+spec:
+  replicas: 2
+  selector:
+    matchLabels:
+      app: chain-server
+  template:
+    metadata:
+      labels:
+        app: chain-server
+    spec:
+      containers:
+      - name: chain-server
+        image: chain-server:latest
+        ports:
+        - containerPort: 8081
+`, []string{`
+apiVersion: apps/v1
+kind: Deployment
+metadata:
+  name: chain-server
+  labels:
+    app: chain-server
+    app.trailblazer.nvidia.com/owned-by: HelmOrchard
+  annotations:
+    app.trailblazer.nvidia.com/package: rag
+spec:
+  replicas: 2
+  selector:
+    matchLabels:
+      app: chain-server
+      app.trailblazer.nvidia.com/owned-by: HelmOrchard
+  template:
+    metadata:
+      labels:
+        app: chain-server
+        app.trailblazer.nvidia.com/owned-by: HelmOrchard
+    spec:
+      containers:
+      - name: chain-server
+        image: chain-server:latest
+        ports:
+        - containerPort: 8081
+`}),
+		Entry("a StatefulSet with volumeClaimTemplates", `
+apiVersion: apps/v1
+kind: StatefulSet
+metadata:
+  name: milvus
+  annotations:
+    owner: rag
+spec:
+  serviceName: milvus
+  selector:
+    matchLabels:
+      app: milvus
+  template:
+    metadata:
+      labels:
+        app: milvus
+    spec:
+      containers:
+      - name: milvus
+        image: milvusdb/milvus:v2.3.1
+  volumeClaimTemplates:
+  - metadata:
+      name: data
+    spec:
+      accessModes: [ReadWriteOnce]
+      resources:
+        requests:
+          storage: 10Gi
+  - metadata:
+      name: logs
+      labels:
+        tier: logs
+    spec:
+      accessModes: [ReadWriteOnce]
+      resources:
+        requests:
+          storage: 1Gi
+`, []string{`
+apiVersion: apps/v1
+kind: StatefulSet
+metadata:
+  name: milvus
+  labels:
+    app.trailblazer.nvidia.com/owned-by: HelmOrchard
+  annotations:
+    owner: rag
+    app.trailblazer.nvidia.com/package: rag
+spec:
+  serviceName: milvus
+  selector:
+    matchLabels:
+      app: milvus
+      app.trailblazer.nvidia.com/owned-by: HelmOrchard
+  template:
+    metadata:
+      labels:
+        app: milvus
+        app.trailblazer.nvidia.com/owned-by: HelmOrchard
+    spec:
+      containers:
+      - name: milvus
+        image: milvusdb/milvus:v2.3.1
+  volumeClaimTemplates:
+  - metadata:
+      name: data
+      labels:
+        app.trailblazer.nvidia.com/owned-by: HelmOrchard
+    spec:
+      accessModes: [ReadWriteOnce]
+      resources:
+        requests:
+          storage: 10Gi
+  - metadata:
+      name: logs
+      labels:
+        tier: logs
+        app.trailblazer.nvidia.com/owned-by: HelmOrchard
+    spec:
+      accessModes: [ReadWriteOnce]
+      resources:
+        requests:
+          storage: 1Gi
+`}),
+		Entry("a Service with a null selector", `
+apiVersion: v1
+kind: Service
+metadata:
+  name: triton
+  labels: null
+spec:
+  selector: null
+  ports:
+  - name: grpc
+    port: 8001
+    targetPort: 8001
+`, []string{`
+apiVersion: v1
+kind: Service
+metadata:
+  name: triton
+  labels:
+    app.trailblazer.nvidia.com/owned-by: HelmOrchard
+  annotations:
+    app.trailblazer.nvidia.com/package: rag
+spec:
+  selector:
+    app.trailblazer.nvidia.com/owned-by: HelmOrchard
+  ports:
+  - name: grpc
+    port: 8001
+    targetPort: 8001
+`}),
+		Entry("a Job, whose selector is only added to when set", `
+apiVersion: batch/v1
+kind: Job
+metadata:
+  name: ingest
+spec:
+  backoffLimit: 4
+  template:
+    spec:
+      restartPolicy: Never
+      containers:
+      - name: ingest
+        image: ingest:latest
+---
+apiVersion: batch/v1
+kind: Job
+metadata:
+  name: ingest-manual
+spec:
+  manualSelector: true
+  selector:
+    matchLabels:
+      job: ingest-manual
+  template:
+    metadata:
+      labels:
+        job: ingest-manual
+    spec:
+      restartPolicy: Never
+      containers:
+      - name: ingest
+        image: ingest:latest
+`, []string{`
+apiVersion: batch/v1
+kind: Job
+metadata:
+  name: ingest
+  labels:
+    app.trailblazer.nvidia.com/owned-by: HelmOrchard
+  annotations:
+    app.trailblazer.nvidia.com/package: rag
+spec:
+  backoffLimit: 4
+  template:
+    metadata:
+      labels:
+        app.trailblazer.nvidia.com/owned-by: HelmOrchard
+    spec:
+      restartPolicy: Never
+      containers:
+      - name: ingest
+        image: ingest:latest
+`, `
+apiVersion: batch/v1
+kind: Job
+metadata:
+  name: ingest-manual
+  labels:
+    app.trailblazer.nvidia.com/owned-by: HelmOrchard
+  annotations:
+    app.trailblazer.nvidia.com/package: rag
+spec:
+  manualSelector: true
+  selector:
+    matchLabels:
+      job: ingest-manual
+      app.trailblazer.nvidia.com/owned-by: HelmOrchard
+  template:
+    metadata:
+      labels:
+        job: ingest-manual
+        app.trailblazer.nvidia.com/owned-by: HelmOrchard
+    spec:
+      restartPolicy: Never
+      containers:
+      - name: ingest
+        image: ingest:latest
+`}),
+		Entry("a CronJob", `
+apiVersion: batch/v1
+kind: CronJob
+metadata:
+  name: reindex
+spec:
+  schedule: "0 3 * * *"
+  jobTemplate:
+    spec:
+      template:
+        spec:
+          restartPolicy: OnFailure
+          containers:
+          - name: reindex
+            image: reindex:latest
+`, []string{`
+apiVersion: batch/v1
+kind: CronJob
+metadata:
+  name: reindex
+  labels:
+    app.trailblazer.nvidia.com/owned-by: HelmOrchard
+  annotations:
+    app.trailblazer.nvidia.com/package: rag
+spec:
+  schedule: "0 3 * * *"
+  jobTemplate:
+    metadata:
+      labels:
+        app.trailblazer.nvidia.com/owned-by: HelmOrchard
+    spec:
+      template:
+        metadata:
+          labels:
+            app.trailblazer.nvidia.com/owned-by: HelmOrchard
+        spec:
+          restartPolicy: OnFailure
+          containers:
+          - name: reindex
+            image: reindex:latest
+`}),
+		Entry("a kind without selectors", `
+apiVersion: v1
+kind: ConfigMap
+metadata:
+  name: prompts
+data:
+  replicas: "3"
+  selector: none
+`, []string{`
+apiVersion: v1
+kind: ConfigMap
+metadata:
+  name: prompts
+  labels:
+    app.trailblazer.nvidia.com/owned-by: HelmOrchard
+  annotations:
+    app.trailblazer.nvidia.com/package: rag
+data:
+  replicas: "3"
+  selector: none
+`}),
+		Entry("empty and comment only documents", `
+---
+# Source: rag/templates/disabled.yaml
+---
+
+---
+# Source: rag/templates/service.yaml
+apiVersion: v1
+kind: Service
+metadata:
+  name: frontend
+spec:
+  selector:
+    app: frontend
+  ports:
+  - port: 8090
+---
+# Source: rag/templates/trailing.yaml
+`, []string{`
+apiVersion: v1
+kind: Service
+metadata:
+  name: frontend
+  labels:
+    app.trailblazer.nvidia.com/owned-by: HelmOrchard
+  annotations:
+    app.trailblazer.nvidia.com/package: rag
+spec:
+  selector:
+    app: frontend
+    app.trailblazer.nvidia.com/owned-by: HelmOrchard
+  ports:
+  - port: 8090
+`}),
+		Entry("nothing rendered", "", nil),
+	)
+
+	It("should fail on manifests that are not YAML", func() {
+		h := &Helmer{Package: HelmPackage{Name: "rag"}}
+
+		_, err := h.Run(bytes.NewBufferString("kind: [Deployment\n"))
+
+		Expect(err).To(HaveOccurred())
+	})
+})
+
+var _ = Describe("postrenderer_setCommonLabels", func() {
+
+	It("should not overwrite other labels of a selector", func() {
+		obj := &unstructured.Unstructured{Object: map[string]interface{}{
+			"kind": "NetworkPolicy",
+			"spec": map[string]interface{}{
+				"podSelector": map[string]interface{}{
+					"matchLabels": map[string]interface{}{"app": "milvus"},
+				},
+			},
+		}}
+
+		Expect(setCommonLabels(obj, map[string]string{"owner": "test"})).To(Succeed())
+
+		labels, _, err := unstructured.NestedStringMap(obj.Object, "spec", "podSelector", "matchLabels")
+		Expect(err).NotTo(HaveOccurred())
+		Expect(labels).To(Equal(map[string]string{"app": "milvus", "owner": "test"}))
+	})
+
+	It("should not add a selector kustomize does not create", func() {
+		obj := &unstructured.Unstructured{Object: map[string]interface{}{
+			"kind": "PodDisruptionBudget",
+			"spec": map[string]interface{}{"minAvailable": int64(1)},
+		}}
+
+		Expect(setCommonLabels(obj, map[string]string{"owner": "test"})).To(Succeed())
+
+		_, found, _ := unstructured.NestedFieldNoCopy(obj.Object, "spec", "selector")
+		Expect(found).To(BeFalse())
+		Expect(obj.GetLabels()).To(Equal(map[string]string{"owner": "test"}))
+	})
+})
@@ -0,0 +1,14 @@
+package helmer
+
+import (
+	"testing"
+
+	. "github.com/onsi/ginkgo/v2"
+	. "github.com/onsi/gomega"
+)
+
+func TestHelmer(t *testing.T) {
+	RegisterFailHandler(Fail)
+
+	RunSpecs(t, "Helmer Suite")
+}
@@ -7,6 +7,7 @@ import (
 	"github.com/mittwald/go-helm-client/values"
 	"github.com/nvidia/kube-trailblazer/pkg/clients"
 	"helm.sh/helm/v3/pkg/chartutil"
+	"k8s.io/client-go/rest"
 )
 
 // Type Guard asserting that Helmer satisfies the Helmer interface.
@@ -19,6 +20,12 @@ type Helmer struct {
 	Options    helmclient.GenericHelmOptions `json:"helmOptions"`
 	KubeClient clients.ClientsInterface      `json:"kubeClient"`
 	Debug      bool                          `json:"debug"`
+	// Changed is set once a release of the package has been installed or upgraded
+	Changed bool `json:"changed"`
+	// digests of the upgraded releases, stored once the chart tests passed
+	digests []pendingDigest
+	// restConf the clients were created from, reused for child charts
+	restConf *rest.Config
 }
 
 // Entry represents a collection of parameters for chart repository, since
@@ -135,6 +142,14 @@ type chartSpec struct {
 // A shelter of vines or branches or of latticework covered with climbing
 // shrubs or vines, also latin for tree
 type HelmPackage struct {
+	// Name identifies the package in the dependsOn lists of other packages,
+	// it defaults to the chart name.
+	// +kubebuilder:validation:Optional
+	Name string `json:"name,omitempty"`
+	// DependsOn lists the packages that have to be installed before this one.
+	// Packages that do not depend on each other are installed concurrently.
+	// +kubebuilder:validation:Optional
+	DependsOn []string  `json:"dependsOn,omitempty"`
 	RepoEntry repoEntry `json:"repoEntry"`
 	ChartSpec chartSpec `json:"chartSpec"`
 	// +kubebuilder:validation:Optional
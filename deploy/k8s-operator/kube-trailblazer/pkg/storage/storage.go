@@ -3,10 +3,12 @@ package storage
 import (
 	"context"
 
-	"github.com/openshift-psap/special-resource-operator/pkg/clients"
+	"github.com/nvidia/kube-trailblazer/pkg/clients"
 	v1 "k8s.io/api/core/v1"
 	apierrors "k8s.io/apimachinery/pkg/api/errors"
+	metav1 "k8s.io/apimachinery/pkg/apis/meta/v1"
 	"k8s.io/apimachinery/pkg/types"
+	"k8s.io/client-go/util/retry"
 	ctrl "sigs.k8s.io/controller-runtime"
 	"sigs.k8s.io/controller-runtime/pkg/client"
 )
@@ -36,10 +38,34 @@ func (s *storage) CheckConfigMapEntry(ctx context.Context, key string, ins types
 	return cm.Data[key], nil
 }
 
+// UpdateConfigMapEntry sets the entry, creating the ConfigMap if needed.
+// Concurrent reconciles may update the same ConfigMap, so the update is
+// retried on conflicts.
 func (s *storage) UpdateConfigMapEntry(ctx context.Context, key string, value string, ins types.NamespacedName) error {
+	err := retry.RetryOnConflict(retry.DefaultRetry, func() error {
+		return s.setConfigMapEntry(ctx, key, value, ins)
+	})
+	if err != nil {
+		ctrl.LoggerFrom(ctx).Error(err, "Failed to update configmap to update an entry", "namespacedName", ins, "key", key, "value", value)
+	}
+	return err
+}
+
+func (s *storage) setConfigMapEntry(ctx context.Context, key string, value string, ins types.NamespacedName) error {
 	cm, err := s.getConfigMap(ctx, ins.Namespace, ins.Name)
+	if apierrors.IsNotFound(err) {
+		cm = &v1.ConfigMap{
+			ObjectMeta: metav1.ObjectMeta{Namespace: ins.Namespace, Name: ins.Name},
+			Data:       map[string]string{key: value},
+		}
+		err = s.kubeClient.Create(ctx, cm)
+		if apierrors.IsAlreadyExists(err) {
+			// Created concurrently, get and update it instead
+			return apierrors.NewConflict(v1.Resource("configmaps"), ins.Name, err)
+		}
+		return err
+	}
 	if err != nil {
-		ctrl.LoggerFrom(ctx).Error(err, "Failed to get configmap to update an entry", "namespacedName", ins, "key", key, "value", value)
 		return err
 	}
 
@@ -49,11 +75,7 @@ func (s *storage) UpdateConfigMapEntry(ctx context.Context, key string, value st
 
 	if cm.Data[key] != value {
 		cm.Data[key] = value
-
-		if err = s.updateObject(ctx, cm); err != nil {
-			ctrl.LoggerFrom(ctx).Error(err, "Failed to update configmap to update an entry", "namespacedName", ins, "key", key, "value", value)
-			return err
-		}
+		return s.updateObject(ctx, cm)
 	}
 
 	return nil
@@ -82,14 +104,13 @@ func (s *storage) getConfigMap(ctx context.Context, namespace string, name strin
 	cm := &v1.ConfigMap{}
 	dep := types.NamespacedName{Namespace: namespace, Name: name}
 
-	err := s.kubeClient.Get(ctx, dep, cm)
-
-	if apierrors.IsNotFound(err) {
-		ctrl.LoggerFrom(ctx).Error(err, "Failed to get configmap", "cmNamespace", namespace, "cmName", name)
+	// A missing ConfigMap is expected before the first entry is stored,
+	// callers decide whether it is an error
+	if err := s.kubeClient.Get(ctx, dep, cm); err != nil {
 		return nil, err
 	}
 
-	return cm, err
+	return cm, nil
 }
 
 func (s *storage) updateObject(ctx context.Context, cm client.Object) error {
@@ -5,10 +5,10 @@ import (
 	"testing"
 
 	"github.com/golang/mock/gomock"
+	"github.com/nvidia/kube-trailblazer/pkg/clients"
+	"github.com/nvidia/kube-trailblazer/pkg/storage"
 	. "github.com/onsi/ginkgo/v2"
 	. "github.com/onsi/gomega"
-	"github.com/openshift-psap/special-resource-operator/pkg/clients"
-	"github.com/openshift-psap/special-resource-operator/pkg/storage"
 	v1 "k8s.io/api/core/v1"
 	k8serrors "k8s.io/apimachinery/pkg/api/errors"
 	"k8s.io/apimachinery/pkg/types"
@@ -23,6 +23,8 @@ var (
 	ctrl       *gomock.Controller
 	mockClient *clients.MockClientsInterface
 	notFound   = k8serrors.NewNotFound(v1.Resource("configmap"), resourceName)
+	conflict   = k8serrors.NewConflict(v1.Resource("configmap"), resourceName, nil)
+	exists     = k8serrors.NewAlreadyExists(v1.Resource("configmap"), resourceName)
 	nsn        = types.NamespacedName{Namespace: namespaceName, Name: resourceName}
 	cmMatcher  = gomock.AssignableToTypeOf(&v1.ConfigMap{})
 )
@@ -82,11 +84,76 @@ var _ = Describe("storage_CheckConfigMapEntry", func() {
 })
 
 var _ = Describe("UpdateConfigMapEntry", func() {
-	It("should return an error when the ConfigMap does not exist", func() {
+	It("should create the ConfigMap when it does not exist", func() {
+		gomock.InOrder(
+			mockClient.EXPECT().
+				Get(context.TODO(), nsn, &v1.ConfigMap{}).
+				Return(notFound),
+			mockClient.EXPECT().
+				Create(context.TODO(), cmMatcher).
+				Do(func(_ context.Context, cm *v1.ConfigMap) {
+					Expect(cm.Namespace).To(Equal(namespaceName))
+					Expect(cm.Name).To(Equal(resourceName))
+					Expect(cm.Data).To(Equal(map[string]string{"any-key": "any-value"}))
+				}),
+		)
+
+		err := storage.NewStorage(mockClient).UpdateConfigMapEntry(context.TODO(), "any-key", "any-value", nsn)
+		Expect(err).NotTo(HaveOccurred())
+	})
+
+	It("should update the ConfigMap when it was created concurrently", func() {
+		gomock.InOrder(
+			mockClient.EXPECT().
+				Get(context.TODO(), nsn, &v1.ConfigMap{}).
+				Return(notFound),
+			mockClient.EXPECT().
+				Create(context.TODO(), cmMatcher).
+				Return(exists),
+			mockClient.EXPECT().
+				Get(context.TODO(), nsn, &v1.ConfigMap{}).
+				Do(func(_ context.Context, _ types.NamespacedName, cm *v1.ConfigMap) {
+					cm.Data = map[string]string{"other-key": "other-value"}
+				}),
+			mockClient.EXPECT().
+				Update(context.TODO(), cmMatcher).
+				Do(func(_ context.Context, cm *v1.ConfigMap) {
+					Expect(cm.Data).To(Equal(map[string]string{"any-key": "any-value", "other-key": "other-value"}))
+				}),
+		)
+
+		err := storage.NewStorage(mockClient).UpdateConfigMapEntry(context.TODO(), "any-key", "any-value", nsn)
+		Expect(err).NotTo(HaveOccurred())
+	})
+
+	It("should get the ConfigMap again and retry on a conflict", func() {
+		gomock.InOrder(
+			mockClient.EXPECT().
+				Get(context.TODO(), nsn, &v1.ConfigMap{}),
+			mockClient.EXPECT().
+				Update(context.TODO(), cmMatcher).
+				Return(conflict),
+			mockClient.EXPECT().
+				Get(context.TODO(), nsn, &v1.ConfigMap{}).
+				Do(func(_ context.Context, _ types.NamespacedName, cm *v1.ConfigMap) {
+					cm.Data = map[string]string{"other-key": "other-value"}
+				}),
+			mockClient.EXPECT().
+				Update(context.TODO(), cmMatcher).
+				Do(func(_ context.Context, cm *v1.ConfigMap) {
+					Expect(cm.Data).To(Equal(map[string]string{"any-key": "any-value", "other-key": "other-value"}))
+				}),
+		)
+
+		err := storage.NewStorage(mockClient).UpdateConfigMapEntry(context.TODO(), "any-key", "any-value", nsn)
+		Expect(err).NotTo(HaveOccurred())
+	})
+
+	It("should return other errors without retrying", func() {
 		mockClient.
 			EXPECT().
 			Get(context.TODO(), nsn, &v1.ConfigMap{}).
-			Return(notFound)
+			Return(k8serrors.NewForbidden(v1.Resource("configmap"), resourceName, nil))
 
 		err := storage.NewStorage(mockClient).UpdateConfigMapEntry(context.TODO(), "any-key", "any-value", nsn)
 		Expect(err).To(HaveOccurred())
@@ -1,6 +1,8 @@
 package utils
 
 import (
+	"crypto/sha256"
+	"encoding/hex"
 	"fmt"
 	"hash/fnv"
 
@@ -15,3 +17,14 @@ func FNV64a(s string) (string, error) {
 	}
 	return fmt.Sprintf("%x", h.Sum64()), nil
 }
+
+// SHA256 returns the hex encoded SHA-256 digest of the parts
+func SHA256(parts ...[]byte) string {
+	h := sha256.New()
+	for _, part := range parts {
+		// prefix each part with its length so parts cannot run into each other
+		fmt.Fprintf(h, "%d:", len(part))
+		h.Write(part)
+	}
+	return hex.EncodeToString(h.Sum(nil))
+}